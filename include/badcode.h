@@ -76,6 +76,9 @@ typedef enum bcStatus_t
   BC_NOT_DEFINED,        /**< Variable is not defined */
   BC_PARSE_NOT_FINISHED, /**< More input expected */
   BC_EMPTY_EXPR,         /**< Empty expression */
+  BC_TOO_MANY_LOCALS,    /**< There are too many local variables or arguments in function */
+  BC_IO_ERROR,           /**< Failed to read or write file */
+  BC_CLOSED,             /**< Channel is closed */
   BC_STATUS_TOTAL        /**< Total status codes */
 } bcStatus_t;
 
@@ -103,6 +106,32 @@ bcStatus_t bcCoreNew(BC_CORE* pCore);
  */
 BCAPI void bcCoreDelete(BC_CORE core);
 
+/**
+ * Create copy of core.
+ * 
+ * Child shares global variables with parent, and any of them defines own 
+ * copy of variable on first write. Own variables of parent are frozen into 
+ * its base environment on the way, see bcCoreFreeze, so fork walks every 
+ * variable defined or written since last freeze together with its value, 
+ * and every variable bound to host storage, which child binds too. Other 
+ * variables are shared at once, so forking core again without writes in 
+ * between doesn't depend on number of variables.
+ * 
+ * Each fork after writes adds one environment to chain of parent, and name 
+ * not found in core is searched in each of them. Names used by compiled code 
+ * are looked up once per core and remembered, so mostly first access of 
+ * child and first write pay for chain length.
+ * 
+ * Stack, result and unfinished statement of parent are not copied. Child 
+ * can be used on other thread than parent.
+ * 
+ * @param parent[in] valid core, which is not executing code
+ * @param pChild[out] pointer to store new core
+ * 
+ * @return BC_OK if completed successfully, error code otherwise.
+ */
+BCAPI bcStatus_t bcCoreFork(BC_CORE parent, BC_CORE* pChild);
+
 /**
  * Execute code on given core.
  * 
@@ -114,6 +143,621 @@ BCAPI void bcCoreDelete(BC_CORE core);
  */
 BCAPI bcStatus_t bcCoreExecute(BC_CORE core, const char* code, char** endp);
 
+/**
+ * Feed chunk of source stream to core.
+ * 
+ * Chunks can be split anywhere and need no '\0' at the end. Every complete
+ * line is passed to parser as soon as it is available, and statements are
+ * executed, when they are complete. Statement, which ends block, is complete
+ * when first line after block is fed. Core keeps incomplete line and 
+ * unfinished block whole, so memory grows with longest line and block, but
+ * not with stream length. Streamed lines don't go through code cache.
+ * 
+ * @param core[in] valid core to execute code on
+ * @param data[in] chunk of source
+ * @param len[in] chunk length
+ * @param pUsed[out,opt] if not NULL, set to number of characters consumed, 
+ *    which is less than len only on errors. Line with error is consumed.
+ * 
+ * @return BC_OK if all statements completed successfully, error code of 
+ *    first failed line otherwise. Feeding can continue after error.
+ */
+BCAPI bcStatus_t bcCoreFeed(BC_CORE core, const char* data, size_t len, size_t* pUsed);
+
+/**
+ * End source stream fed to core.
+ * 
+ * Last line is executed even without newline, and all blocks left open are 
+ * closed. Core can be fed new stream afterwards.
+ * 
+ * @param core[in] valid core
+ * 
+ * @return BC_OK if execution completed successfully, error code otherwise.
+ */
+BCAPI bcStatus_t bcCoreFeedEnd(BC_CORE core);
+
+/**
+ * Read value of host variable.
+ * 
+ * @param[in] user user data passed to bcCoreBindAccessors
+ * @param[out] pValue pointer to store new value, which is freed by caller
+ */
+typedef bcStatus_t (*bcGetter_t)(void* user, BC_VALUE* pValue);
+
+/**
+ * Write value of host variable.
+ * 
+ * @param[in] user user data passed to bcCoreBindAccessors
+ * @param[in] value new value, which is not kept by setter
+ */
+typedef bcStatus_t (*bcSetter_t)(void* user, const BC_VALUE value);
+
+/**
+ * Bind global variable to host integer.
+ * 
+ * Scripts read and write storage directly, so host never boxes values to 
+ * pass them. Assigned values are converted to integer. Previous value or 
+ * binding of variable is replaced.
+ * 
+ * @param[in] core valid core
+ * @param[in] name variable name
+ * @param[in] storage host storage, which must outlive binding
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcCoreBindInteger(BC_CORE core, const char* name, int64_t* storage);
+
+/**
+ * Bind global variable to host number.
+ * 
+ * Same as bcCoreBindInteger, but assigned values are converted to number.
+ */
+BCAPI bcStatus_t bcCoreBindNumber(BC_CORE core, const char* name, double* storage);
+
+/**
+ * Bind global variable to host getter and setter.
+ * 
+ * @param[in] core valid core
+ * @param[in] name variable name
+ * @param[in] get getter, called on every read
+ * @param[in] set setter, called on every write, or NULL for read-only 
+ *    variable, assignment of which fails with BC_NOT_IMPLEMENTED
+ * @param[in] user user data passed to accessors
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcCoreBindAccessors(BC_CORE core, const char* name, bcGetter_t get, bcSetter_t set, void* user);
+
+/**
+ * Remove binding of global variable.
+ * 
+ * Variable keeps last value read from host storage.
+ * 
+ * @param[in] core valid core
+ * @param[in] name name of bound variable
+ * 
+ * @return
+ *    BC_OK binding removed
+ *    BC_NOT_DEFINED variable is not defined
+ *    BC_INVALID_ARG variable is not bound
+ */
+BCAPI bcStatus_t bcCoreUnbind(BC_CORE core, const char* name);
+
+/**
+ * Frozen global variables, shared by cores.
+ */
+typedef struct bcEnv_t* BC_ENV;
+
+/**
+ * Freeze global variables of core into environment.
+ * 
+ * Globals are moved from core to new environment, which becomes base 
+ * environment of core. Environment never changes, so it can be used by 
+ * cores on other threads at the same time, and their reads take no locks. 
+ * Core writes to variable of base environment define its own variable, 
+ * which hides base one. Variables bound to host storage stay in core.
+ * 
+ * If core already has base environment, it becomes base of new one.
+ * 
+ * @param[in] core valid core
+ * @param[out] pEnv pointer to store new environment, which must be freed 
+ *    with bcEnvDelete
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcCoreFreeze(BC_CORE core, BC_ENV* pEnv);
+
+/**
+ * Set base environment of core.
+ * 
+ * Own variables of core are kept and hide variables of environment.
+ * 
+ * @param[in] core valid core
+ * @param[in] env environment, or NULL to remove base environment
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcCoreSetEnv(BC_CORE core, BC_ENV env);
+
+/**
+ * Release environment.
+ * 
+ * Environment is freed, when it is not used by any core.
+ */
+BCAPI void bcEnvDelete(BC_ENV env);
+
+/**
+ * Global variables shared by processes.
+ */
+typedef struct bcStore_t* BC_STORE;
+
+/**
+ * Create named shared memory store.
+ * 
+ * Creating process is the only writer of store, other processes open it 
+ * read-only. Store keeps integers, numbers and strings, which are read in
+ * place by every process, so store memory is not duplicated by readers.
+ * Written data is never freed, so store is created again to compact it.
+ * 
+ * @param[in] name POSIX shared memory name, like "/name"
+ * @param[in] size segment size, including names and values
+ * @param[out] pStore pointer to store new store
+ * 
+ * @return
+ *    BC_OK store created
+ *    BC_IO_ERROR segment can't be created, or already exists
+ *    BC_NOT_IMPLEMENTED shared memory isn't supported on this platform
+ */
+BCAPI bcStatus_t bcStoreCreate(const char* name, size_t size, BC_STORE* pStore);
+
+/**
+ * Open store created by other process for reading.
+ * 
+ * @return
+ *    BC_OK store opened
+ *    BC_IO_ERROR segment can't be opened
+ *    BC_MALFORMED_CODE segment is not valid store, or created by other version
+ *    BC_NOT_IMPLEMENTED shared memory isn't supported on this platform
+ */
+BCAPI bcStatus_t bcStoreOpen(const char* name, BC_STORE* pStore);
+
+/**
+ * Set variable of store. Readers see new value on their next read, and 
+ * values read before stay valid.
+ * 
+ * @param[in] store store created by this process
+ * @param[in] name variable name
+ * @param[in] value integer, number or string
+ * 
+ * @return
+ *    BC_OK value stored
+ *    BC_OVERFLOW store is full
+ *    BC_NOT_IMPLEMENTED value type can't be stored, or store is opened
+ *       read-only
+ */
+BCAPI bcStatus_t bcStoreSet(BC_STORE store, const char* name, const BC_VALUE value);
+
+/**
+ * Read variable of store without locks.
+ * 
+ * Value is not copied and belongs to store, it must not be used after 
+ * store is deleted. Value can be freed with bcValueCleanup as usual.
+ * 
+ * @return value, or NULL if it is not defined
+ */
+BCAPI BC_VALUE bcStoreGet(const BC_STORE store, const char* name);
+
+/**
+ * Unmap store. Segment is kept, until it is unlinked.
+ */
+BCAPI void bcStoreDelete(BC_STORE store);
+
+/**
+ * Remove store name. Processes, which opened store, keep it.
+ */
+BCAPI bcStatus_t bcStoreUnlink(const char* name);
+
+/**
+ * Set store of core.
+ * 
+ * Store variables are visible to core as global variables, which it 
+ * doesn't define. They are read from store every time, so writer updates
+ * are seen by scripts. Core writes define own variables of core.
+ * 
+ * @param[in] core valid core
+ * @param[in] store store, which must outlive core and values read by it, 
+ *    or NULL
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcCoreSetStore(BC_CORE core, BC_STORE store);
+
+/**
+ * Bounded queue of values, which passes them between cores on different
+ * threads.
+ */
+typedef struct bcChannel_t* BC_CHANNEL;
+
+/**
+ * Create channel.
+ * 
+ * @param[in] capacity maximum number of values in channel
+ * @param[out] pChannel pointer to store new channel
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcChannelNew(size_t capacity, BC_CHANNEL* pChannel);
+
+/**
+ * Drop host reference to channel. Channel and values left in it are freed,
+ * when functions defined by bcCoreBindChannel are deleted too.
+ */
+BCAPI void bcChannelDelete(BC_CHANNEL channel);
+
+/**
+ * Close channel. Waiting senders and receivers are woken up, values left 
+ * in channel are still received.
+ */
+BCAPI void bcChannelClose(BC_CHANNEL channel);
+
+/**
+ * Send value, waiting while channel is full.
+ * 
+ * Value reference is moved to channel, and value is not copied. Integer, 
+ * number or string without other references is passed as is, other values
+ * become shared between threads.
+ * 
+ * @param[in] channel valid channel
+ * @param[in] value value, which reference is taken on success
+ * 
+ * @return
+ *    BC_OK value sent
+ *    BC_CLOSED channel is closed, value reference is kept by caller
+ */
+BCAPI bcStatus_t bcChannelSend(BC_CHANNEL channel, BC_VALUE value);
+
+/**
+ * Receive value, waiting while channel is empty.
+ * 
+ * @param[in] channel valid channel
+ * @param[out] pValue pointer to store received value, which is freed by
+ *    caller
+ * 
+ * @return
+ *    BC_OK value received
+ *    BC_CLOSED channel is closed and has no values
+ */
+BCAPI bcStatus_t bcChannelReceive(BC_CHANNEL channel, BC_VALUE* pValue);
+
+/**
+ * Define global functions, which send to and receive from channel.
+ * 
+ * Send function takes value and returns 1, receive function takes no 
+ * arguments and returns received value. Both wait like bcChannelSend and
+ * bcChannelReceive, and fail with BC_CLOSED on closed channel.
+ * 
+ * @param[in] core valid core
+ * @param[in] send name of send function, or NULL
+ * @param[in] receive name of receive function, or NULL
+ * @param[in] channel channel, which is kept alive by defined functions
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcCoreBindChannel(BC_CORE core, const char* send, const char* receive, BC_CHANNEL channel);
+
+/**
+ * Compiled program.
+ */
+typedef struct bcProgram_t* BC_PROGRAM;
+
+/**
+ * Compile whole program once, to execute it many times.
+ * 
+ * Unlike bcCoreExecute, source is not fed line by line: all blocks are
+ * closed at the end of source.
+ * 
+ * @param[in] code whole program source
+ * @param[out] pProgram pointer to store compiled program
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcProgramCompile(const char* code, BC_PROGRAM* pProgram);
+
+/**
+ * Free compiled program.
+ */
+BCAPI void bcProgramDelete(BC_PROGRAM program);
+
+/**
+ * Execute compiled program on core.
+ * 
+ * Same program can be executed on any number of cores, but not from 
+ * several threads at the same time, unless it is executed by pool.
+ * 
+ * @param[in] core valid core
+ * @param[in] program compiled program
+ */
+BCAPI bcStatus_t bcCoreExecuteProgram(BC_CORE core, const BC_PROGRAM program);
+
+/**
+ * Save compiled program to file.
+ * 
+ * @param[in] program compiled or loaded program
+ * @param[in] path output file path
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcProgramSave(const BC_PROGRAM program, const char* path);
+
+/**
+ * Load program saved by bcProgramSave.
+ * 
+ * File is memory mapped and program is executed directly from it. Loaded
+ * program can be used as compiled one.
+ * 
+ * @param[in] path image file path
+ * @param[out] pProgram pointer to store loaded program
+ * 
+ * @return
+ *    BC_OK program loaded
+ *    BC_IO_ERROR file can't be read
+ *    BC_MALFORMED_CODE file is not valid image, or saved by other version
+ */
+BCAPI bcStatus_t bcProgramLoad(const char* path, BC_PROGRAM* pProgram);
+
+/**
+ * Save global variables of core, including functions and environment ones,
+ * to image file.
+ * 
+ * Values of host-bound globals are saved as they are now. Native functions
+ * are not saved, host registers them again.
+ * 
+ * @param[in] core valid core
+ * @param[in] path output file path
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcCoreSave(const BC_CORE core, const char* path);
+
+/**
+ * Define global variables saved by bcCoreSave.
+ * 
+ * File is memory mapped and every global is loaded from it on first use,
+ * so large images are restored without reading them whole. Image is
+ * unmapped when all its globals are loaded or deleted.
+ * 
+ * @param[in] core valid core
+ * @param[in] path image file path
+ * 
+ * @return
+ *    BC_OK globals defined
+ *    BC_IO_ERROR file can't be read
+ *    BC_MALFORMED_CODE file is not valid core image, or saved by other version
+ */
+BCAPI bcStatus_t bcCoreLoad(BC_CORE core, const char* path);
+
+/**
+ * Pool of worker threads, which execute programs on cores.
+ */
+typedef struct bcPool_t* BC_POOL;
+
+/**
+ * Submitted program execution.
+ */
+typedef struct bcJob_t* BC_JOB;
+
+/**
+ * Called by worker thread, when job is completed.
+ * 
+ * @param[in] user user data passed to bcPoolSubmit
+ * @param[in] core core, which executed program, its result can be read here
+ * @param[in] status execution status
+ */
+typedef void (*bcJobCallback_t)(void* user, BC_CORE core, bcStatus_t status);
+
+/**
+ * Start worker threads.
+ * 
+ * Every worker keeps its own queue of cores and takes work from others, 
+ * when its queue is empty. Core is returned to worker, which executed it
+ * last, so its data stays in the same processor cache.
+ * 
+ * @param[in] threads number of threads, 0 for one per processor
+ * @param[out] pPool pointer to store new pool
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcPoolNew(size_t threads, BC_POOL* pPool);
+
+/**
+ * Wait for all submitted jobs and stop worker threads.
+ */
+BCAPI void bcPoolDelete(BC_POOL pool);
+
+/**
+ * Submit program execution on core.
+ * 
+ * Jobs of the same core are executed one by one in submission order, jobs
+ * of different cores run in parallel. Core must not be used by host until
+ * its jobs are completed. Core can have jobs in one pool at a time.
+ * 
+ * Cores executed by different workers must not refer to the same values,
+ * unless values are frozen, see bcValueFreeze. E.g. constants of program,
+ * which host executed on several cores, are such values, so submit that
+ * program too. Program is shared with bcCodeStreamShare on first
+ * submit, then it can be executed by any number of threads.
+ * 
+ * @param[in] pool valid pool
+ * @param[in] core core, which must outlive its jobs
+ * @param[in] program program, which must outlive its jobs
+ * @param[in] callback completion callback, or NULL
+ * @param[in] user user data for callback
+ * @param[out] pJob pointer to store job to wait for, or NULL
+ * 
+ * @return
+ *    BC_OK job is scheduled
+ *    BC_INVALID_ARG core has jobs, which are not completed, in other pool
+ *    BC_CLOSED pool is being deleted
+ */
+BCAPI bcStatus_t bcPoolSubmit(BC_POOL pool, BC_CORE core, const BC_PROGRAM program, bcJobCallback_t callback, void* user, BC_JOB* pJob);
+
+/**
+ * Wait for job completion.
+ * 
+ * @param[in] job job returned by bcPoolSubmit
+ * 
+ * @return program execution status
+ */
+BCAPI bcStatus_t bcJobWait(BC_JOB job);
+
+/**
+ * Free job returned by bcPoolSubmit. Job, which isn't completed, still runs.
+ */
+BCAPI void bcJobDelete(BC_JOB job);
+
+/**
+ * Script, which can be reloaded without compiling it again.
+ */
+typedef struct bcScript_t* BC_SCRIPT;
+
+/**
+ * Compile script.
+ * 
+ * Script is compiled like whole program, but every top-level statement is
+ * kept separately. Statement begins on line without indentation and 
+ * continues on indented lines and after line continuation.
+ * 
+ * @param[in] code whole script source
+ * @param[out] pScript pointer to store compiled script
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcScriptCompile(const char* code, BC_SCRIPT* pScript);
+
+/**
+ * Replace script source.
+ * 
+ * New source is compared with previous one by top-level statements. Code of
+ * statements found in previous source is reused, and only new or edited 
+ * statements are compiled. Script is not changed, if new source can't be 
+ * compiled.
+ * 
+ * Script must not be executed by other threads during reload.
+ * 
+ * @param[in] script script to reload
+ * @param[in] code new script source
+ * @param[out] pCompiled if not NULL, set to number of compiled statements
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcScriptReload(BC_SCRIPT script, const char* code, size_t* pCompiled);
+
+/**
+ * Free compiled script.
+ */
+BCAPI void bcScriptDelete(BC_SCRIPT script);
+
+/**
+ * Execute statements of script on core.
+ * 
+ * Execution stops on first failed statement.
+ * 
+ * @param[in] core valid core
+ * @param[in] script compiled script
+ */
+BCAPI bcStatus_t bcCoreExecuteScript(BC_CORE core, const BC_SCRIPT script);
+
+/**
+ * Compiled code cache statistics.
+ */
+typedef struct bcCacheStats_t
+{
+  uint64_t hits;      /**< Statements taken from cache */
+  uint64_t misses;    /**< Statements not found in cache */
+  uint64_t evictions; /**< Entries removed from cache */
+  size_t entries;     /**< Entries in cache */
+  size_t size;        /**< Approximate memory used by cache */
+  size_t limit;       /**< Cache memory limit */
+} bcCacheStats_t;
+
+/**
+ * Set memory limit of process-wide compiled code cache.
+ * 
+ * Cache is off by default. When enabled, bcCoreExecute keeps compiled
+ * statements in cache, shared by all cores and threads. Entries not used
+ * recently are removed to fit the limit.
+ * 
+ * Cached code is compiled whole, so bodies of if statements in multi-line
+ * code are compiled eagerly, even if they never run.
+ * 
+ * @param[in] limit memory limit in bytes, 0 disables cache
+ */
+BCAPI bcStatus_t bcCacheSetLimit(size_t limit);
+
+/**
+ * Remove all entries from compiled code cache.
+ */
+BCAPI void bcCacheClear(void);
+
+/**
+ * Get compiled code cache statistics.
+ * 
+ * Hits and misses are counted per thread group without ordering, so they may
+ * lag behind lookups running in other threads at same time.
+ * 
+ * @param[out] pStats pointer to store statistics
+ */
+BCAPI bcStatus_t bcCacheStatistics(bcCacheStats_t* pStats);
+
+/**
+ * Ahead-of-time compiled program, loaded from shared library.
+ */
+typedef struct bcNativeProgram_t* BC_NATIVE_PROGRAM;
+
+/**
+ * Compile program to C source.
+ * 
+ * Generated source depends only on C standard headers, build it as shared 
+ * library and load with bcNativeProgramLoad.
+ * 
+ * @param[in] code whole program source
+ * @param[in] output stream to write C source to
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcCompileToC(const char* code, FILE* output);
+
+/**
+ * Load program compiled with bcCompileToC.
+ * 
+ * @param[in] path path to shared library
+ * @param[out] pProgram pointer to store loaded program
+ * 
+ * @return
+ *    BC_OK program loaded
+ *    BC_INVALID_ARG library can't be loaded
+ *    BC_NOT_DEFINED library doesn't export program entry points
+ *    BC_MALFORMED_CODE program built for other runtime version
+ *    BC_NOT_IMPLEMENTED native programs aren't supported on this platform
+ */
+BCAPI bcStatus_t bcNativeProgramLoad(const char* path, BC_NATIVE_PROGRAM* pProgram);
+
+/**
+ * Unload native program.
+ * 
+ * Functions defined by program are native code of library, so library is
+ * unloaded, when program and all its function values are deleted.
+ */
+BCAPI void bcNativeProgramDelete(BC_NATIVE_PROGRAM program);
+
+/**
+ * Execute native program on core.
+ * 
+ * @param[in] core valid core
+ * @param[in] program loaded native program
+ */
+BCAPI bcStatus_t bcCoreExecuteNative(BC_CORE core, const BC_NATIVE_PROGRAM program);
+
 /**
  * Get value on top of stack.
  * 
@@ -129,6 +773,122 @@ BCAPI bcStatus_t bcCoreResult(const BC_CORE core, BC_VALUE* pVal);
  */
 BCAPI bcStatus_t bcCorePop(BC_CORE core);
 
+//
+// Scalar functions exchange values with core without boxing them on host
+// side. Integer and number boxes popped by host are kept by core and reused
+// by following pushes, so host evaluating expressions in loop doesn't 
+// allocate.
+//
+
+/**
+ * Push integer on stack.
+ * 
+ * @param[in] core valid core
+ * @param[in] value value to push
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcCorePushInteger(BC_CORE core, int64_t value);
+
+/**
+ * Push number on stack.
+ */
+BCAPI bcStatus_t bcCorePushNumber(BC_CORE core, double value);
+
+/**
+ * Push string on stack.
+ * 
+ * String is copied, so it needs no '\0' at the end.
+ * 
+ * @param[in] core valid core
+ * @param[in] data string characters
+ * @param[in] len string length
+ */
+BCAPI bcStatus_t bcCorePushString(BC_CORE core, const char* data, size_t len);
+
+/**
+ * Call global function with arguments pushed on stack.
+ * 
+ * Arguments are pushed in order, first argument first. They are replaced
+ * by returned value, which also becomes result of core, so it is read by 
+ * bcCorePop* or bcCoreResult* functions. Arguments are removed from stack,
+ * even if call fails.
+ * 
+ * @param[in] core valid core
+ * @param[in] name function name
+ * @param[in] argCount number of pushed arguments
+ * 
+ * @return
+ *    BC_OK function returned
+ *    BC_NOT_DEFINED function is not defined
+ *    BC_INVALID_ID global is not function
+ *    BC_INVALID_ARG function takes other number of arguments
+ *    BC_UNDERFLOW less than argCount values on stack
+ */
+BCAPI bcStatus_t bcCoreCallFunction(BC_CORE core, const char* name, size_t argCount);
+
+/**
+ * Pop value from stack as integer.
+ * 
+ * Value is removed from stack, even if it can't be converted.
+ * 
+ * @param[in] core valid core
+ * @param[out] pValue pointer to store value
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcCorePopInteger(BC_CORE core, int64_t* pValue);
+
+/**
+ * Pop value from stack as number.
+ * 
+ * Value is removed from stack, even if it can't be converted.
+ */
+BCAPI bcStatus_t bcCorePopNumber(BC_CORE core, double* pValue);
+
+/**
+ * Get string on top of stack without copying it.
+ * 
+ * @param[in] core valid core
+ * @param[out] pData pointer to store string, which is valid until value is 
+ *    popped, string is '\0' terminated
+ * @param[out] pLen pointer to store string length
+ * 
+ * @return
+ *    BC_OK string found
+ *    BC_UNDERFLOW stack is empty
+ *    BC_CANT_CONVERT value is not string
+ */
+BCAPI bcStatus_t bcCoreTopString(const BC_CORE core, const char** pData, size_t* pLen);
+
+/**
+ * Get result of last executed statement as integer.
+ * 
+ * @param[in] core valid core
+ * @param[out] pValue pointer to store result
+ * 
+ * @return
+ *    BC_OK result converted
+ *    BC_NOT_DEFINED there is no result
+ *    BC_CANT_CONVERT result can't be converted
+ */
+BCAPI bcStatus_t bcCoreResultInteger(const BC_CORE core, int64_t* pValue);
+
+/**
+ * Get result of last executed statement as number.
+ */
+BCAPI bcStatus_t bcCoreResultNumber(const BC_CORE core, double* pValue);
+
+/**
+ * Get result string of last executed statement without copying it.
+ * 
+ * @param[in] core valid core
+ * @param[out] pData pointer to store string, which is valid until next 
+ *    statement sets result
+ * @param[out] pLen pointer to store string length
+ */
+BCAPI bcStatus_t bcCoreResultString(const BC_CORE core, const char** pData, size_t* pLen);
+
 /**
  * Box an integer.
  * 
@@ -182,6 +942,33 @@ BCAPI BC_VALUE bcValueCopy(const BC_VALUE val);
  */
 BCAPI bcStatus_t bcValueCleanup(BC_VALUE value);
 
+/**
+ * How frozen value is shared.
+ */
+typedef enum bcFreezeMode_t
+{
+  BC_FREEZE_SHARED,   /**< Reference counters are updated atomically */
+  BC_FREEZE_IMMORTAL  /**< Values are never freed, counters are not updated */
+} bcFreezeMode_t;
+
+/**
+ * Make value and values it refers to immutable, so they can be used by 
+ * several threads at once.
+ * 
+ * Code of functions and code blocks is compiled and prepared like code 
+ * of programs executed by pool. Values, which were frozen before, are not 
+ * changed. Other values keep cheap non-atomic reference counters.
+ * 
+ * Must be called before value is visible to other threads.
+ * 
+ * @param[in,out] value valid value
+ * @param[in] mode BC_FREEZE_SHARED or BC_FREEZE_IMMORTAL, immortal values
+ *   stay in memory until process exits
+ * 
+ * @return BC_OK if completed sucessfuly, error code otherwise
+ */
+BCAPI bcStatus_t bcValueFreeze(BC_VALUE value, bcFreezeMode_t mode);
+
 /**
  * Get stored value as integer.
  * 
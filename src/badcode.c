@@ -31,11 +31,28 @@ bcStatus_t bcCoreNew(BC_CORE* pCore)
     return status;
   }
 
+  status = bcFrameStackInit(&result->frames, BC_CORE_FRAME_STACK_SIZE);
+  if (status != BC_OK)
+  {
+    bcValueStackCleanup(&result->stack);
+    free(result);
+    return status;
+  }
+
   result->globalCap = BC_CORE_GLOBAL_INITIAL_CAP;
   result->globalSize = 0;
   result->globals = (BC_GLOBAL*) calloc(BC_CORE_GLOBAL_INITIAL_CAP, sizeof(BC_GLOBAL));
+  result->globalTableSize = 0;
+  result->globalTable = NULL;
+  result->slotTag = bcCoreSlotTag();
+  result->slotSize = 0;
+  result->slotCap = 0;
+  result->slots = NULL;
+  result->slotTableSize = 0;
+  result->slotTable = NULL;
   if (result->globals == NULL)
   {
+    bcFrameStackCleanup(&result->frames);
     bcValueStackCleanup(&result->stack);
     free(result);
     return BC_NO_MEMORY;
@@ -45,7 +62,27 @@ bcStatus_t bcCoreNew(BC_CORE* pCore)
 
   memset(result->parseContext.indentStack, 0, sizeof(result->parseContext.indentStack));
   result->parseContext.indentTop = result->parseContext.indentStack;
+  result->parseContext.arena = NULL;
+  result->parseContext.source = NULL;
+  result->parseContext.chunk = 0;
+  result->parseContext.chunks = NULL;
+  result->parseContext.tree = NULL;
+  result->parseContext.compile = 0;
+  memset(&result->parseContext.code, 0, sizeof(bcCodeStream_t));
+  result->parseContext.depth = 0;
+  result->parseContext.status = BC_OK;
   result->result = NULL;
+  result->feed = NULL;
+  result->feedSize = 0;
+  result->feedCap = 0;
+  result->env = NULL;
+  result->store = NULL;
+  result->pool = NULL;
+  result->poolHead = NULL;
+  result->poolTail = NULL;
+  result->poolLast = NULL;
+  result->poolWorker = SIZE_MAX;
+  result->spareSize = 0;
 
   *pCore = result;
   return BC_OK;
@@ -60,40 +97,445 @@ void bcCoreDelete(BC_CORE core)
       bcValueCleanup(core->result);
     }
 
+    bcParseContextCleanup(&core->parseContext);
+    free(core->feed);
+
     for (BC_GLOBAL* cursor = core->globals, *end = core->globals + core->globalSize; cursor != end; ++cursor)
     {
       bcGlobalDelete(*cursor);
     }
     free(core->globals);
+    free(core->globalTable);
+    for (uint32_t i = 0; i < core->slotSize; ++i)
+    {
+      free(core->slots[i].name);
+    }
+    free(core->slots);
+    free(core->slotTable);
+    bcEnvDelete(core->env);
+
+    for (size_t i = 0; i < core->spareSize; ++i)
+    {
+      free(core->spare[i]);
+    }
 
+    bcFrameStackCleanup(&core->frames);
     bcValueStackCleanup(&core->stack);
     free(core);
   }
 }
 
-static bcStatus_t bcCodeStreamExecute(BC_CORE core, const bcCodeStream_t* codeStream)
+BCAPI bcStatus_t bcCoreFork(BC_CORE parent, BC_CORE* pChild)
+{
+  if ((parent == NULL) || (pChild == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  BC_CORE child;
+  bcStatus_t status = bcCoreNew(&child);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  status = bcCoreForkGlobals(parent, child);
+  if (status != BC_OK)
+  {
+    bcCoreDelete(child);
+    return status;
+  }
+
+  child->store = parent->store;
+  *pChild = child;
+  return BC_OK;
+}
+
+/**
+ * Cleanup all values on stack above newTop. Empty frame slots are skipped.
+ */
+static void bcCoreDropValues(BC_CORE core, BC_VALUE* newTop)
+{
+  while (core->stack.top > newTop)
+  {
+    --core->stack.top;
+    if (*core->stack.top != NULL)
+    {
+      bcValueCleanup(*core->stack.top);
+    }
+  }
+}
+
+/**
+ * Check that function with given argument count can be called.
+ * 
+ * Function is expected on stack right before arguments.
+ */
+static bcStatus_t bcCoreCallCheck(BC_CORE core, uint8_t argCount, const bcFunc_t** pFunc)
+{
+  if ((core->stack.top - core->stack.bottom) < (argCount + 1))
+  {
+    return BC_UNDERFLOW;
+  }
+
+  const bcFunc_t* func = (const bcFunc_t*) core->stack.top[-argCount-1];
+  if ((func == NULL) || (func->head.type != BC_FUNC))
+  {
+    return BC_INVALID_ID;
+  }
+
+  if (func->argCount != argCount)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  if ((size_t)(core->stack.top - core->stack.bottom) + (func->slotCount - func->argCount) > core->stack.total)
+  {
+    return BC_OVERFLOW;
+  }
+
+  *pFunc = func;
+  return BC_OK;
+}
+
+/**
+ * Reserve empty frame slots for function local variables.
+ */
+static void bcCoreReserveSlots(BC_CORE core, const bcFunc_t* func)
+{
+  for (size_t slot = func->argCount; slot < func->slotCount; ++slot)
+  {
+    *core->stack.top = NULL;
+    ++core->stack.top;
+  }
+}
+
+/**
+ * Replace called function, its frame slots and temporaries with value on top
+ * of stack.
+ */
+static void bcCoreReturn(BC_CORE core, BC_VALUE* base)
+{
+  BC_VALUE result = core->stack.top[-1];
+  --core->stack.top;
+  bcCoreDropValues(core, base - 1);
+  *core->stack.top = result;
+  ++core->stack.top;
+}
+
+/**
+ * Remove if-statement body frames, up to function call frame.
+ * 
+ * @return NULL if code is not called from function, call frame otherwise
+ */
+static const bcFrame_t* bcCoreCallFrame(BC_CORE core, const bcFrame_t* entry)
+{
+  while (core->frames.top != entry)
+  {
+    if (core->frames.top[-1].call != 0)
+    {
+      return core->frames.top - 1;
+    }
+    bcFrameStackPop(&core->frames);
+  }
+  return NULL;
+}
+
+bcStatus_t bcCoreOpPush(BC_CORE core, const bcCodeStream_t* codeStream, uint8_t conID)
+{
+  BC_VALUE con;
+  bcStatus_t status = bcCodeStreamConstant(codeStream, conID, &con);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+  return bcValueStackPush(&core->stack, con);
+}
+
+bcStatus_t bcCoreOpPop(BC_CORE core)
+{
+  return bcValueStackPop(&core->stack);
+}
+
+bcStatus_t bcCoreOpBinary(BC_CORE core, uint8_t opcode)
+{
+  if ((core->stack.top - core->stack.bottom) < 2)
+  {
+    return BC_UNDERFLOW;
+  }
+
+  BC_VALUE result;
+
+  bcStatus_t status = bcValueBinaryOperator(
+    core->stack.top[-2],
+    core->stack.top[-1],
+    opcode,
+    &result
+  );
+
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  bcValueStackPop(&core->stack);
+  bcValueStackPop(&core->stack);
+  bcValueStackPush(&core->stack, result);
+  bcValueCleanup(result);
+  return BC_OK;
+}
+
+bcStatus_t bcCoreOpSet(BC_CORE core)
+{
+  if ((core->stack.top - core->stack.bottom) < 2)
+  {
+    return BC_UNDERFLOW;
+  }
+
+  BC_VALUE id = core->stack.top[-2];
+  if (id->type != BC_STRING)
+  {
+    return BC_INVALID_ID;
+  }
+
+  BC_VALUE result = bcValueCopy(core->stack.top[-1]);
+
+  bcStatus_t status = bcCoreSetGlobal(core, ((bcString_t*)id)->data, core->stack.top[-1]);
+  if (status != BC_OK)
+  {
+    bcValueCleanup(result);
+    return status;
+  }
+  bcValueStackPop(&core->stack);
+  bcValueStackPop(&core->stack);
+  bcValueStackPush(&core->stack, result);
+  bcValueCleanup(result);
+  return BC_OK;
+}
+
+bcStatus_t bcCoreOpStoreGlobal(BC_CORE core, const bcCodeStream_t* codeStream, uint8_t conID)
+{
+  if ((core->stack.top - core->stack.bottom) < 1)
+  {
+    return BC_UNDERFLOW;
+  }
+
+  uint32_t slot;
+  bcStatus_t status = bcCoreGlobalSlot(core, codeStream, conID, &slot);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  BC_GLOBAL global = bcCoreSlotGlobal(core, slot);
+  if ((global == NULL) || global->frozen)
+  { // first assignment defines own variable of core
+    return bcCoreSetGlobal(core, core->slots[slot].name, core->stack.top[-1]);
+  }
+
+  // value is left on stack as assignment result
+  return bcGlobalStore(global, core->stack.top[-1]);
+}
+
+bcStatus_t bcCoreOpUnary(BC_CORE core, uint8_t opcode)
 {
-  for(const uint8_t* cursor = codeStream->opcodes, *end = codeStream->opcodes + codeStream->opSize; cursor != end; ++cursor)
+  if ((core->stack.top - core->stack.bottom) < 1)
   {
+    return BC_UNDERFLOW;
+  }
+
+  BC_VALUE result;
+
+  bcStatus_t status = bcValueUnaryOperator(
+    core->stack.top[-1],
+    opcode,
+    &result
+  );
+
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  bcValueStackPop(&core->stack);
+  bcValueStackPush(&core->stack, result);
+  bcValueCleanup(result);
+  return BC_OK;
+}
+
+bcStatus_t bcCoreOpValue(BC_CORE core)
+{
+  if ((core->stack.top - core->stack.bottom) < 1)
+  {
+    return BC_UNDERFLOW;
+  }
+
+  BC_VALUE id = core->stack.top[-1];
+  if (id->type != BC_STRING)
+  {
+    return BC_INVALID_ID;
+  }
+
+  BC_VALUE result = bcCoreGetGlobal(core, ((bcString_t*)id)->data);
+  if (result == NULL)
+  {
+    return BC_NOT_DEFINED;
+  }
+
+  bcValueStackPop(&core->stack);
+  bcValueStackPush(&core->stack, result);
+  bcValueCleanup(result);
+  return BC_OK;
+}
+
+bcStatus_t bcCoreOpLoadGlobal(BC_CORE core, const bcCodeStream_t* codeStream, uint8_t conID)
+{
+  uint32_t slot;
+  bcStatus_t status = bcCoreGlobalSlot(core, codeStream, conID, &slot);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  BC_GLOBAL global = bcCoreSlotGlobal(core, slot);
+  if (global == NULL)
+  {
+    if (core->store == NULL)
+    {
+      return BC_NOT_DEFINED;
+    }
+    return bcCorePushStoreGlobal(core, core->slots[slot].name);
+  }
+  return bcCorePushGlobal(core, global);
+}
+
+bcStatus_t bcCoreOpResult(BC_CORE core)
+{
+  if ((core->stack.top - core->stack.bottom) < 1)
+  {
+    return BC_UNDERFLOW;
+  }
+  if (core->result != NULL)
+  {
+    bcValueCleanup(core->result);
+  }
+  core->result = bcValueCopy(core->stack.top[-1]);
+  return bcValueStackPop(&core->stack);
+}
+
+bcStatus_t bcCoreOpCondition(BC_CORE core, int64_t* pValue)
+{
+  if ((core->stack.top - core->stack.bottom) < 1)
+  {
+    return BC_UNDERFLOW;
+  }
+
+  bcStatus_t status = bcValueAsInteger(core->stack.top[-1], pValue);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  return bcValueStackPop(&core->stack);
+}
+
+bcStatus_t bcCoreOpLoadLocal(BC_CORE core, BC_VALUE* base, uint8_t slot)
+{
+  if (base + slot >= core->stack.top)
+  {
+    return BC_MALFORMED_CODE;
+  }
+
+  if (base[slot] == NULL)
+  {
+    return BC_NOT_DEFINED;
+  }
+
+  return bcValueStackPush(&core->stack, base[slot]);
+}
+
+bcStatus_t bcCoreOpStoreLocal(BC_CORE core, BC_VALUE* base, uint8_t slot)
+{
+  if (base + slot >= core->stack.top - 1)
+  {
+    return BC_MALFORMED_CODE;
+  }
+
+  BC_VALUE oldValue = base[slot];
+  base[slot] = bcValueCopy(core->stack.top[-1]);
+  if (oldValue != NULL)
+  {
+    bcValueCleanup(oldValue);
+  }
+  return BC_OK;
+}
+
+/**
+ * Execute code stream.
+ * 
+ * @param core[in] valid core
+ * @param codeStream[in] code stream to execute
+ * @param base[in] first frame slot of code stream
+ * @param called[in] not 0, if code stream is function body called from C
+ */
+static bcStatus_t bcCodeStreamRun(BC_CORE core, const bcCodeStream_t* codeStream, BC_VALUE* base, int called)
+{
+  // Continue execution from opcode after cursor
+  #define BC_RESUME() \
+    ++cursor; \
+    if (cursor == end) \
+    { \
+      return BC_HALT_EXPECTED; \
+    } \
+    goto BC_DISPATCH
+
+  // Continue execution from first opcode of code stream
+  #define BC_ENTER(CODE) \
+    codeStream = (CODE); \
+    cursor = codeStream->opcodes; \
+    end = codeStream->opcodes + codeStream->opSize; \
+    goto BC_DISPATCH
+
+  const bcFrame_t* entry = core->frames.top;
+  const uint8_t* cursor = codeStream->opcodes;
+  const uint8_t* end = codeStream->opcodes + codeStream->opSize;
+
+  for(; cursor != end; ++cursor)
+  {
+BC_DISPATCH:
     switch (*cursor)
     {
     case BC_HALT:
-      return BC_OK;
-    case BC_PSH:
       {
-        ++cursor;
-        if (cursor == end)
+        if (core->frames.top == entry)
         {
+          return BC_OK;
+        }
+
+        // if-statement body ends, continue code after it
+        const bcFrame_t* frame = core->frames.top - 1;
+        if (frame->call != 0)
+        { // functions must end with BC_RTN
           return BC_MALFORMED_CODE;
         }
 
-        uint8_t conID = *cursor;
-        if (conID >= codeStream->conSize)
+        codeStream = frame->code;
+        cursor = frame->cursor;
+        end = codeStream->opcodes + codeStream->opSize;
+        base = frame->base;
+        bcFrameStackPop(&core->frames);
+        BC_RESUME();
+      }
+      break;
+    case BC_PSH:
+      {
+        ++cursor;
+        if (cursor == end)
         {
-          return BC_CONST_NOT_FOUND;
+          return BC_MALFORMED_CODE;
         }
 
-        bcStatus_t status = bcValueStackPush(&core->stack, codeStream->cons[conID]);
+        bcStatus_t status = bcCoreOpPush(core, codeStream, *cursor);
         if (status != BC_OK)
         {
           return status;
@@ -101,9 +543,8 @@ static bcStatus_t bcCodeStreamExecute(BC_CORE core, const bcCodeStream_t* codeSt
       }
       break;
     case BC_POP:
-    CASE_BC_POP:
       {
-        bcStatus_t status = bcValueStackPop(&core->stack);
+        bcStatus_t status = bcCoreOpPop(core);
         if (status != BC_OK)
         {
           return status;
@@ -129,55 +570,20 @@ static bcStatus_t bcCodeStreamExecute(BC_CORE core, const bcCodeStream_t* codeSt
     case BC_BLS:
     case BC_BRS:
       {
-        if ((core->stack.top - core->stack.bottom) < 2)
-        {
-          return BC_UNDERFLOW;
-        }
-
-        BC_VALUE result;
-
-        bcStatus_t status = bcValueBinaryOperator(
-          core->stack.top[-2],
-          core->stack.top[-1],
-          *cursor,
-          &result
-        );
-
+        bcStatus_t status = bcCoreOpBinary(core, *cursor);
         if (status != BC_OK)
         {
           return status;
         }
-
-        bcValueStackPop(&core->stack);
-        bcValueStackPop(&core->stack);
-        bcValueStackPush(&core->stack, result);
-        bcValueCleanup(result);
       }
       break;
     case BC_SET:
       {
-        if ((core->stack.top - core->stack.bottom) < 2)
-        {
-          return BC_UNDERFLOW;
-        }
-
-        BC_VALUE id = core->stack.top[-2];
-        if (id->type != BC_STRING)
-        {
-          return BC_INVALID_ID;
-        }
-
-        BC_VALUE result = bcValueCopy(core->stack.top[-1]);
-
-        bcStatus_t status = bcCoreSetGlobal(core, ((bcString_t*)id)->data, core->stack.top[-1]);
+        bcStatus_t status = bcCoreOpSet(core);
         if (status != BC_OK)
         {
           return status;
         }
-        bcValueStackPop(&core->stack);
-        bcValueStackPop(&core->stack);
-        bcValueStackPush(&core->stack, result);
-        bcValueCleanup(result);
       }
       break;
     case BC_NEG:
@@ -187,51 +593,20 @@ static bcStatus_t bcCodeStreamExecute(BC_CORE core, const bcCodeStream_t* codeSt
     case BC_NUM:
     case BC_STR:
       {
-        if ((core->stack.top - core->stack.bottom) < 1)
-        {
-          return BC_UNDERFLOW;
-        }
-
-        BC_VALUE result;
-
-        bcStatus_t status = bcValueUnaryOperator(
-          core->stack.top[-1],
-          *cursor,
-          &result
-        );
-
+        bcStatus_t status = bcCoreOpUnary(core, *cursor);
         if (status != BC_OK)
         {
           return status;
         }
-
-        bcValueStackPop(&core->stack);
-        bcValueStackPush(&core->stack, result);
-        bcValueCleanup(result);
       }
       break;
     case BC_VAL:
       {
-        if ((core->stack.top - core->stack.bottom) < 1)
-        {
-          return BC_UNDERFLOW;
-        }
-
-        BC_VALUE id = core->stack.top[-1];
-        if (id->type != BC_STRING)
-        {
-          return BC_INVALID_ID;
-        }
-
-        BC_VALUE result = bcCoreGetGlobal(core, ((bcString_t*)id)->data);
-        if (result == NULL)
+        bcStatus_t status = bcCoreOpValue(core);
+        if (status != BC_OK)
         {
-          return BC_NOT_DEFINED;
+          return status;
         }
-
-        bcValueStackPop(&core->stack);
-        bcValueStackPush(&core->stack, result);
-        bcValueCleanup(result);
       }
       break;
     case BC_IFS:
@@ -242,55 +617,222 @@ static bcStatus_t bcCodeStreamExecute(BC_CORE core, const bcCodeStream_t* codeSt
           return BC_MALFORMED_CODE;
         }
 
-        if ((core->stack.top - core->stack.bottom) < 1)
-        {
-          return BC_UNDERFLOW;
+        int64_t value;
+        bcStatus_t status = bcCoreOpCondition(core, &value);
+        if (status != BC_OK)
+        {
+          return status;
         }
 
-        int64_t value;
+        if (value == 0)
+        {
+          BC_RESUME();
+        }
 
-        bcStatus_t status = bcValueAsInteger(core->stack.top[-1], &value);
+        BC_VALUE body;
+        status = bcCodeStreamConstant(codeStream, *cursor, &body);
         if (status != BC_OK)
         {
           return status;
         }
 
-        bcValueStackPop(&core->stack);
+        bcCode_t* code = (bcCode_t*) body;
+        if (code->head.type != BC_CODE)
+        {
+          return BC_MALFORMED_CODE;
+        }
 
-        if (value != 0)
+        status = bcCodeCompile(code);
+        if (status != BC_OK)
         {
-          uint8_t conID = *cursor;
-          if (conID >= codeStream->conSize)
-          {
-            return BC_CONST_NOT_FOUND;
-          }
+          return status;
+        }
+
+        bcFrame_t frame = { codeStream, cursor, base, 0 };
+        status = bcFrameStackPush(&core->frames, &frame);
+        if (status != BC_OK)
+        {
+          return status;
+        }
+
+        BC_ENTER(&code->code);
+      }
+      break;
+    case BC_RET:
+      {
+        bcStatus_t status = bcCoreOpResult(core);
+        if (status != BC_OK)
+        {
+          return status;
+        }
+      }
+      break;
+    case BC_LDL:
+      {
+        ++cursor;
+        if (cursor == end)
+        {
+          return BC_MALFORMED_CODE;
+        }
 
-          bcCode_t* code = (bcCode_t*) codeStream->cons[conID];
-          if (code->head.type != BC_CODE)
+        bcStatus_t status = bcCoreOpLoadLocal(core, base, *cursor);
+        if (status != BC_OK)
+        {
+          return status;
+        }
+      }
+      break;
+    case BC_STL:
+      {
+        ++cursor;
+        if (cursor == end)
+        {
+          return BC_MALFORMED_CODE;
+        }
+
+        bcStatus_t status = bcCoreOpStoreLocal(core, base, *cursor);
+        if (status != BC_OK)
+        {
+          return status;
+        }
+      }
+      break;
+    case BC_LDG:
+      {
+        ++cursor;
+        if (cursor == end)
+        {
+          return BC_MALFORMED_CODE;
+        }
+
+        bcStatus_t status = bcCoreOpLoadGlobal(core, codeStream, *cursor);
+        if (status != BC_OK)
+        {
+          return status;
+        }
+      }
+      break;
+    case BC_STG:
+      {
+        ++cursor;
+        if (cursor == end)
+        {
+          return BC_MALFORMED_CODE;
+        }
+
+        bcStatus_t status = bcCoreOpStoreGlobal(core, codeStream, *cursor);
+        if (status != BC_OK)
+        {
+          return status;
+        }
+      }
+      break;
+    case BC_CLL:
+      {
+        ++cursor;
+        if (cursor == end)
+        {
+          return BC_MALFORMED_CODE;
+        }
+
+        const bcFunc_t* func;
+        bcStatus_t status = bcCoreCallCheck(core, *cursor, &func);
+        if (status != BC_OK)
+        {
+          return status;
+        }
+
+        if (func->native != NULL)
+        { // native function is executed by C code
+          status = bcCoreCall(core, *cursor);
+          if (status != BC_OK)
           {
-            return BC_MALFORMED_CODE;
+            return status;
           }
+          BC_RESUME();
+        }
+
+        bcFrame_t frame = { codeStream, cursor, base, 1 };
+        status = bcFrameStackPush(&core->frames, &frame);
+        if (status != BC_OK)
+        {
+          return status;
+        }
+
+        base = core->stack.top - func->argCount;
+        bcCoreReserveSlots(core, func);
+        BC_ENTER(&func->code);
+      }
+      break;
+    case BC_TCL:
+      {
+        ++cursor;
+        if (cursor == end)
+        {
+          return BC_MALFORMED_CODE;
+        }
 
-          status = bcCodeStreamExecute(core, &code->code);
+        const bcFunc_t* func;
+        bcStatus_t status = bcCoreCallCheck(core, *cursor, &func);
+        if (status != BC_OK)
+        {
+          return status;
+        }
+
+        if ((bcCoreCallFrame(core, entry) == NULL) && (called == 0))
+        {
+          return BC_MALFORMED_CODE;
+        }
+
+        if (func->native != NULL)
+        { // native function result is returned as is
+          status = bcCoreCall(core, *cursor);
           if (status != BC_OK)
           {
             return status;
           }
+          goto CASE_BC_RTN;
         }
+
+        // Replace current function, its slots and temporaries with called 
+        // function and its arguments. Call frame stays the same.
+        BC_VALUE* callee = core->stack.top - func->argCount - 1;
+        BC_VALUE* oldCallee = base - 1;
+        for (BC_VALUE* cursorValue = oldCallee; cursorValue != callee; ++cursorValue)
+        {
+          if (*cursorValue != NULL)
+          {
+            bcValueCleanup(*cursorValue);
+          }
+        }
+        memmove(oldCallee, callee, (func->argCount + 1) * sizeof(BC_VALUE));
+        core->stack.top = base + func->argCount;
+        bcCoreReserveSlots(core, func);
+        BC_ENTER(&func->code);
       }
       break;
-    case BC_RET:
+    case BC_RTN:
+    CASE_BC_RTN:
       {
-        if ((core->stack.top - core->stack.bottom) < 1)
+        if ((core->stack.top - base) < 1)
         {
           return BC_UNDERFLOW;
         }
-        if (core->result != NULL)
-        {
-          bcValueCleanup(core->result);
+
+        const bcFrame_t* frame = bcCoreCallFrame(core, entry);
+        if (frame == NULL)
+        { // function called from C leaves result on top for caller
+          return (called != 0)? BC_OK : BC_MALFORMED_CODE;
         }
-        core->result = bcValueCopy(core->stack.top[-1]);
-        goto CASE_BC_POP;
+
+        bcCoreReturn(core, base);
+
+        codeStream = frame->code;
+        cursor = frame->cursor;
+        end = codeStream->opcodes + codeStream->opSize;
+        base = frame->base;
+        bcFrameStackPop(&core->frames);
+        BC_RESUME();
       }
       break;
     default:
@@ -299,53 +841,422 @@ static bcStatus_t bcCodeStreamExecute(BC_CORE core, const bcCodeStream_t* codeSt
     }
   }
   return BC_HALT_EXPECTED;
+
+  #undef BC_ENTER
+  #undef BC_RESUME
 }
 
-bcStatus_t bcCoreExecute(BC_CORE core, const char* code, char** endp)
+void bcCoreUnwind(BC_CORE core, bcFrame_t* frames, BC_VALUE* values)
 {
-  #define BC_CORE_RETURN(STATUS) coreResult = (STATUS); goto CORE_EXIT
+  core->frames.top = frames;
+  if (core->stack.top > values)
+  {
+    bcCoreDropValues(core, values);
+  }
+}
 
-  if ((core == NULL) || (code == NULL))
+static bcStatus_t bcCodeStreamExecute(BC_CORE core, const bcCodeStream_t* codeStream)
+{
+  bcFrame_t* frames = core->frames.top;
+  BC_VALUE* values = core->stack.top;
+
+  // top-level code has no frame slots
+  bcStatus_t status = bcCodeStreamRun(core, codeStream, core->stack.top, 0);
+  if (status != BC_OK)
+  { // unwind frames and values left by interrupted function calls
+    bcCoreUnwind(core, frames, values);
+  }
+  return status;
+}
+
+bcStatus_t bcCoreCall(BC_CORE core, uint8_t argCount)
+{
+  const bcFunc_t* func;
+  bcStatus_t status = bcCoreCallCheck(core, argCount, &func);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  BC_VALUE* base = core->stack.top - func->argCount;
+  bcCoreReserveSlots(core, func);
+
+  if (func->native != NULL)
+  {
+    status = func->native(core, base);
+  }
+  else
+  {
+    status = bcCodeStreamRun(core, &func->code, base, 1);
+  }
+
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  bcCoreReturn(core, base);
+  return BC_OK;
+}
+
+BCAPI bcStatus_t bcProgramCompile(const char* code, BC_PROGRAM* pProgram)
+{
+  if ((code == NULL) || (pProgram == NULL))
   {
     return BC_INVALID_ARG;
   }
 
   bcTree_t* tree = NULL;
-  bcStatus_t coreResult = bcParseString(code, &tree, endp, &core->parseContext);
-  if (coreResult != BC_OK)
+  bcStatus_t status = bcParseProgram(code, &tree);
+  if (status != BC_OK)
   {
-    return coreResult;
+    return status;
   }
 
-  if (tree->root == NULL)
+  bcProgram_t* program = (bcProgram_t*) malloc(sizeof(bcProgram_t));
+  if (program == NULL)
   {
     bcTreeCleanup(tree);
-    return BC_EMPTY_EXPR;
+    return BC_NO_MEMORY;
   }
 
-  bcCodeStream_t codeStream;
-  coreResult = bcCodeStreamInit(&codeStream);
-  if (coreResult != BC_OK)
+  program->image = NULL;
+  program->shared = 0;
+  status = bcCodeStreamInit(&program->code);
+  if (status != BC_OK)
   {
+    free(program);
     bcTreeCleanup(tree);
+    return status;
+  }
+
+  status = bcCodeStreamCompile(&program->code, tree);
+  bcTreeCleanup(tree);
+  if (status != BC_OK)
+  {
+    bcProgramDelete(program);
+    return status;
+  }
+
+  *pProgram = program;
+  return BC_OK;
+}
+
+BCAPI void bcProgramDelete(BC_PROGRAM program)
+{
+  if (program != NULL)
+  {
+    bcCodeStreamCleanup(&program->code);
+    bcImageRelease(program->image);
+    free(program);
+  }
+}
+
+BCAPI bcStatus_t bcCoreExecuteProgram(BC_CORE core, const BC_PROGRAM program)
+{
+  if ((core == NULL) || (program == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+  return bcCodeStreamExecute(core, &program->code);
+}
+
+BCAPI bcStatus_t bcCoreExecuteScript(BC_CORE core, const BC_SCRIPT script)
+{
+  if ((core == NULL) || (script == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  for (size_t i = 0; i < script->count; ++i)
+  {
+    bcStatus_t status = bcCodeStreamExecute(core, &script->statements[i].code);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+  }
+  return BC_OK;
+}
+
+bcStatus_t bcCoreExecute(BC_CORE core, const char* code, char** endp)
+{
+  if ((core == NULL) || (code == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  // only statements, which don't continue unfinished one, can be cached
+  int cacheable = (core->parseContext.context == NULL)
+    && (core->parseContext.indentTop == core->parseContext.indentStack);
+  int newline = core->parseContext.newline;
+
+  bcCacheEntry_t* entry = NULL;
+  if (cacheable)
+  {
+    entry = bcCacheAcquire(code, newline);
+  }
+
+  if (entry != NULL)
+  {
+    core->parseContext.newline = entry->newlineAfter;
+    if (endp != NULL)
+    {
+      *endp = (char*) code + entry->consumed;
+    }
+
+    bcStatus_t coreResult = bcCodeStreamExecute(core, &entry->code);
+    bcCacheRelease(entry);
     return coreResult;
   }
 
-  coreResult = bcCodeStreamCompile(&codeStream, tree);
+  bcCodeStream_t codeStream;
+  char* end = (char*) code;
+  bcStatus_t coreResult = bcParseCompile(code, &codeStream, &end, &core->parseContext);
+  if ((coreResult == BC_OK) || (coreResult == BC_EMPTY_EXPR))
+  {
+    if (endp != NULL)
+    {
+      *endp = end;
+    }
+  }
+
   if (coreResult != BC_OK)
   {
-    bcTreeCleanup(tree);
-    bcCodeStreamCleanup(&codeStream);
     return coreResult;
   }
 
-  bcTreeCleanup(tree);
+  if (cacheable)
+  {
+    entry = bcCacheInsert(code, (size_t) (end - code), newline, core->parseContext.newline, &codeStream);
+    if (entry != NULL)
+    {
+      coreResult = bcCodeStreamExecute(core, &entry->code);
+      bcCacheRelease(entry);
+      return coreResult;
+    }
+  }
 
   coreResult = bcCodeStreamExecute(core, &codeStream);
   bcCodeStreamCleanup(&codeStream);
   return coreResult;
 }
 
+/**
+ * Make room for size characters and '\0' in streamed source line buffer.
+ */
+static bcStatus_t bcCoreFeedReserve(BC_CORE core, size_t size)
+{
+  if (size < core->feedCap)
+  {
+    return BC_OK;
+  }
+
+  size_t cap = (core->feedCap == 0)? BC_CORE_FEED_INITIAL_CAP : core->feedCap;
+  while (cap <= size)
+  {
+    if (cap > SIZE_MAX/2)
+    {
+      return BC_NO_MEMORY;
+    }
+    cap *= 2;
+  }
+
+  char* feed = (char*) realloc(core->feed, cap);
+  if (feed == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  core->feed = feed;
+  core->feedCap = cap;
+  return BC_OK;
+}
+
+/**
+ * Execute complete line of streamed source.
+ */
+static bcStatus_t bcCoreFeedLine(BC_CORE core)
+{
+  core->feed[core->feedSize] = '\0';
+  core->feedSize = 0;
+
+  // streamed lines are seldom repeated, so they skip code cache
+  bcCodeStream_t codeStream;
+  bcStatus_t status = bcParseCompile(core->feed, &codeStream, NULL, &core->parseContext);
+  if ((status == BC_PARSE_NOT_FINISHED) || (status == BC_EMPTY_EXPR))
+  { // statement continues on next line, or line is empty
+    return BC_OK;
+  }
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  status = bcCodeStreamExecute(core, &codeStream);
+  bcCodeStreamCleanup(&codeStream);
+  return status;
+}
+
+BCAPI bcStatus_t bcCoreFeed(BC_CORE core, const char* data, size_t len, size_t* pUsed)
+{
+  if ((core == NULL) || ((data == NULL) && (len != 0)))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcStatus_t status = BC_OK;
+  const char* cursor = data;
+  const char* end = data + len;
+  while ((status == BC_OK) && (cursor != end))
+  {
+    const char* newline = (const char*) memchr(cursor, '\n', (size_t) (end - cursor));
+    const char* lineEnd = (newline != NULL)? newline + 1 : end;
+    size_t size = (size_t) (lineEnd - cursor);
+
+    if (memchr(cursor, '\0', size) != NULL)
+    { // line can't be passed to parser, it is dropped
+      core->feedSize = 0;
+      cursor = lineEnd;
+      status = BC_MALFORMED_CODE;
+      break;
+    }
+
+    status = bcCoreFeedReserve(core, core->feedSize + size);
+    if (status != BC_OK)
+    {
+      break;
+    }
+
+    memcpy(core->feed + core->feedSize, cursor, size);
+    core->feedSize += size;
+    cursor = lineEnd;
+
+    if (newline != NULL)
+    {
+      status = bcCoreFeedLine(core);
+    }
+  }
+
+  if (pUsed != NULL)
+  {
+    *pUsed = (size_t) (cursor - data);
+  }
+  return status;
+}
+
+BCAPI bcStatus_t bcCoreFeedEnd(BC_CORE core)
+{
+  if (core == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcStatus_t status = BC_OK;
+  if (core->feedSize != 0)
+  { // last line has no newline
+    status = bcCoreFeedReserve(core, core->feedSize + 1);
+    if (status != BC_OK)
+    {
+      core->feedSize = 0;
+      return status;
+    }
+
+    core->feed[core->feedSize++] = '\n';
+    status = bcCoreFeedLine(core);
+  }
+
+  if ((status == BC_OK)
+    && ((core->parseContext.context != NULL) || (core->parseContext.indentTop != core->parseContext.indentStack)))
+  { // empty line closes all blocks left open
+    status = bcCoreExecute(core, "\n", NULL);
+    if (status == BC_PARSE_NOT_FINISHED)
+    {
+      bcParseContextCleanup(&core->parseContext);
+      core->parseContext.indentTop = core->parseContext.indentStack;
+      core->parseContext.newline = 1;
+      status = BC_MALFORMED_CODE;
+    }
+  }
+
+  if (status == BC_EMPTY_EXPR)
+  {
+    status = BC_OK;
+  }
+  return status;
+}
+
+bcStatus_t bcParseProgram(const char* code, bcTree_t** pTree)
+{
+  if ((code == NULL) || (pTree == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcParseContext_t parseContext;
+  parseContext.context = NULL;
+  parseContext.newline = 1;
+  memset(parseContext.indentStack, 0, sizeof(parseContext.indentStack));
+  parseContext.indentTop = parseContext.indentStack;
+  parseContext.arena = NULL;
+  parseContext.source = NULL;
+  parseContext.chunk = 0;
+  parseContext.chunks = NULL;
+  parseContext.tree = NULL;
+  parseContext.compile = 0;
+  memset(&parseContext.code, 0, sizeof(bcCodeStream_t));
+  parseContext.depth = 0;
+  parseContext.status = BC_OK;
+
+  bcTree_t* tree = NULL;
+  bcStatus_t status = bcParseString(code, &tree, NULL, &parseContext);
+  if (status == BC_PARSE_NOT_FINISHED)
+  { // empty line closes all blocks left open
+    status = bcParseString("\n", &tree, NULL, &parseContext);
+  }
+
+  if (status != BC_OK)
+  {
+    bcParseContextCleanup(&parseContext);
+    return status;
+  }
+
+  if (tree == NULL)
+  { // parser failed on syntax error
+    return BC_MALFORMED_CODE;
+  }
+
+  if (tree->root == BC_TREE_NONE)
+  {
+    bcTreeCleanup(tree);
+    return BC_EMPTY_EXPR;
+  }
+
+  *pTree = tree;
+  return BC_OK;
+}
+
+/**
+ * Release value popped by host. Last reference to integer or number box 
+ * keeps box for reuse.
+ */
+static void bcCoreReleaseBox(BC_CORE core, BC_VALUE value)
+{
+  if (value == NULL)
+  { // empty frame slot
+    return;
+  }
+
+  if ((value->refCount == 1)
+    && ((value->type == BC_INTEGER) || (value->type == BC_NUMBER))
+    && (core->spareSize < BC_CORE_SPARE_BOXES))
+  {
+    core->spare[core->spareSize++] = value;
+    return;
+  }
+  bcValueCleanup(value);
+}
+
 BCAPI bcStatus_t bcCoreTop(const BC_CORE core, BC_VALUE* val)
 {
   if ((core == NULL) || (val == NULL))
@@ -385,37 +1296,268 @@ BCAPI bcStatus_t bcCorePop(BC_CORE core)
     return BC_UNDERFLOW;
   }
 
-  bcValueCleanup(core->stack.top[-1]);
   --core->stack.top;
+  bcCoreReleaseBox(core, *core->stack.top);
   return BC_OK;
 }
 
-BC_VALUE bcValueCode(const bcTree_t* parseTree)
+/**
+ * Take spare box of given scalar type.
+ * 
+ * @return NULL if core has no spare box
+ */
+static BC_VALUE bcCoreSpareBox(BC_CORE core, bcDataType_t type)
 {
-  bcCode_t* result = (bcCode_t*) malloc(sizeof(bcCode_t));
-  if (result == NULL)
+  for (size_t i = core->spareSize; i-- > 0;)
   {
-    return NULL;
+    BC_VALUE box = core->spare[i];
+    if (box->type == type)
+    {
+      core->spare[i] = core->spare[--core->spareSize];
+      box->refCount = 1;
+      return box;
+    }
   }
+  return NULL;
+}
 
-  result->head.type = BC_CODE;
-  result->head.refCount = 1;
+static bcStatus_t bcCorePushBox(BC_CORE core, BC_VALUE box)
+{
+  if (box == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  if ((size_t) (core->stack.top - core->stack.bottom) >= core->stack.total)
+  {
+    bcCoreReleaseBox(core, box);
+    return BC_OVERFLOW;
+  }
+
+  // reference of new box is moved to stack
+  *core->stack.top++ = box;
+  return BC_OK;
+}
+
+BCAPI bcStatus_t bcCorePushInteger(BC_CORE core, int64_t value)
+{
+  if (core == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  BC_VALUE box = bcCoreSpareBox(core, BC_INTEGER);
+  if (box == NULL)
+  {
+    return bcCorePushBox(core, bcValueInteger(value));
+  }
+
+  ((bcInteger_t*) box)->data = value;
+  return bcCorePushBox(core, box);
+}
+
+BCAPI bcStatus_t bcCorePushNumber(BC_CORE core, double value)
+{
+  if (core == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  BC_VALUE box = bcCoreSpareBox(core, BC_NUMBER);
+  if (box == NULL)
+  {
+    return bcCorePushBox(core, bcValueNumber(value));
+  }
+
+  ((bcNumber_t*) box)->data = value;
+  return bcCorePushBox(core, box);
+}
+
+BCAPI bcStatus_t bcCorePushString(BC_CORE core, const char* data, size_t len)
+{
+  if ((core == NULL) || ((data == NULL) && (len != 0)))
+  {
+    return BC_INVALID_ARG;
+  }
+  return bcCorePushBox(core, bcValueStringSlice((data != NULL)? data : "", len));
+}
+
+BCAPI bcStatus_t bcCoreCallFunction(BC_CORE core, const char* name, size_t argCount)
+{
+  if ((core == NULL) || (name == NULL) || (argCount > UINT8_MAX))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  size_t size = (size_t) (core->stack.top - core->stack.bottom);
+  if (size < argCount)
+  {
+    return BC_UNDERFLOW;
+  }
+
+  BC_VALUE* args = core->stack.top - argCount;
+  if (size >= core->stack.total)
+  {
+    bcCoreDropValues(core, args);
+    return BC_OVERFLOW;
+  }
+
+  BC_VALUE func = bcCoreGetGlobal(core, name);
+  if (func == NULL)
+  {
+    bcCoreDropValues(core, args);
+    return BC_NOT_DEFINED;
+  }
 
-  bcStatus_t status = bcCodeStreamInit(&result->code);
+  // function is expected right before arguments
+  memmove(args + 1, args, argCount * sizeof(BC_VALUE));
+  *args = func;
+  ++core->stack.top;
+
+  bcFrame_t* frames = core->frames.top;
+  bcStatus_t status = bcCoreCall(core, (uint8_t) argCount);
   if (status != BC_OK)
   {
-    free(result);
+    bcCoreUnwind(core, frames, args);
+    return status;
+  }
+
+  if (core->result != NULL)
+  {
+    bcValueCleanup(core->result);
+  }
+  core->result = bcValueCopy(core->stack.top[-1]);
+  return BC_OK;
+}
+
+BCAPI bcStatus_t bcCorePopInteger(BC_CORE core, int64_t* pValue)
+{
+  if ((core == NULL) || (pValue == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  if (core->stack.top == core->stack.bottom)
+  {
+    return BC_UNDERFLOW;
+  }
+
+  --core->stack.top;
+  bcStatus_t status = bcValueAsInteger(*core->stack.top, pValue);
+  bcCoreReleaseBox(core, *core->stack.top);
+  return status;
+}
+
+BCAPI bcStatus_t bcCorePopNumber(BC_CORE core, double* pValue)
+{
+  if ((core == NULL) || (pValue == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  if (core->stack.top == core->stack.bottom)
+  {
+    return BC_UNDERFLOW;
+  }
+
+  --core->stack.top;
+  bcStatus_t status = bcValueAsNumber(*core->stack.top, pValue);
+  bcCoreReleaseBox(core, *core->stack.top);
+  return status;
+}
+
+/**
+ * Get string slice of value.
+ */
+static bcStatus_t bcValueStringView(const BC_VALUE value, const char** pData, size_t* pLen)
+{
+  if (value->type != BC_STRING)
+  {
+    return BC_CANT_CONVERT;
+  }
+
+  const bcString_t* str = (const bcString_t*) value;
+  *pData = str->data;
+  *pLen = str->len - 1;
+  return BC_OK;
+}
+
+BCAPI bcStatus_t bcCoreTopString(const BC_CORE core, const char** pData, size_t* pLen)
+{
+  if ((core == NULL) || (pData == NULL) || (pLen == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  if (core->stack.top == core->stack.bottom)
+  {
+    return BC_UNDERFLOW;
+  }
+  return bcValueStringView(core->stack.top[-1], pData, pLen);
+}
+
+BCAPI bcStatus_t bcCoreResultInteger(const BC_CORE core, int64_t* pValue)
+{
+  if ((core == NULL) || (pValue == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  if (core->result == NULL)
+  {
+    return BC_NOT_DEFINED;
+  }
+  return bcValueAsInteger(core->result, pValue);
+}
+
+BCAPI bcStatus_t bcCoreResultNumber(const BC_CORE core, double* pValue)
+{
+  if ((core == NULL) || (pValue == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  if (core->result == NULL)
+  {
+    return BC_NOT_DEFINED;
+  }
+  return bcValueAsNumber(core->result, pValue);
+}
+
+BCAPI bcStatus_t bcCoreResultString(const BC_CORE core, const char** pData, size_t* pLen)
+{
+  if ((core == NULL) || (pData == NULL) || (pLen == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  if (core->result == NULL)
+  {
+    return BC_NOT_DEFINED;
+  }
+  return bcValueStringView(core->result, pData, pLen);
+}
+
+BC_VALUE bcValueCode(bcTree_t* parseTree)
+{
+  if (parseTree == NULL)
+  {
     return NULL;
   }
 
-  status = bcCodeStreamCompile(&result->code, parseTree);
-  if (status != BC_OK)
+  bcCode_t* result = (bcCode_t*) malloc(sizeof(bcCode_t));
+  if (result == NULL)
   {
-    bcCodeStreamCleanup(&result->code);
-    free(result);
     return NULL;
   }
 
+  result->head.type = BC_CODE;
+  result->head.refCount = 1;
+
+  // code stream stays empty until first bcCodeCompile call
+  memset(&result->code, 0, sizeof(bcCodeStream_t));
+  result->tree = parseTree;
+
   return &result->head;
 }
 
@@ -455,6 +1597,12 @@ BCAPI const char* bcStatusString(bcStatus_t status)
       return "NOT_DEFINED";
     case BC_PARSE_NOT_FINISHED:
       return "PARSE_NOT_FINISHED";
+    case BC_TOO_MANY_LOCALS:
+      return "TOO_MANY_LOCALS";
+    case BC_IO_ERROR:
+      return "IO_ERROR";
+    case BC_CLOSED:
+      return "CLOSED";
     default:
       return "???";
   }
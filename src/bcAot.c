@@ -0,0 +1,779 @@
+/**
+ * Ahead-of-time compilation of BadCode programs to C.
+ *
+ * Compiled code stream is translated to C source, which calls runtime
+ * through table of function pointers, so generated code doesn't need
+ * BadCode headers or link time dependency. If bodies are inlined as C
+ * if statements, functions become static C functions, called natively
+ * through BC_FUNC values.
+ *
+ * Build generated file to shared library, and load it with
+ * bcNativeProgramLoad.
+ */
+#include <bcPrivate.h>
+#include <bcSync.h>
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+/**
+ * Version of runtime table, bumped on every incompatible change.
+ */
+#define BC_AOT_VERSION (3)
+
+/**
+ * Runtime table passed to generated code on load.
+ *
+ * Same declaration is pasted to every generated source, all functions
+ * return bcStatus_t as int.
+ */
+#define BC_AOT_API_DECLARATION \
+  typedef struct bcAotApi_t \
+  { \
+    int version; \
+    int (*push)(BC_CORE core, BC_VALUE value); \
+    int (*pop)(BC_CORE core); \
+    int (*binary)(BC_CORE core, int opcode); \
+    int (*unary)(BC_CORE core, int opcode); \
+    int (*set)(BC_CORE core); \
+    int (*value)(BC_CORE core); \
+    int (*result)(BC_CORE core); \
+    int (*loadLocal)(BC_CORE core, BC_VALUE* base, int slot); \
+    int (*storeLocal)(BC_CORE core, BC_VALUE* base, int slot); \
+    int (*loadGlobal)(BC_CORE core, BC_VALUE name); \
+    int (*storeGlobal)(BC_CORE core, BC_VALUE name); \
+    int (*condition)(BC_CORE core, int64_t* pValue); \
+    int (*call)(BC_CORE core, int argCount); \
+    BC_VALUE (*integer)(int64_t value); \
+    BC_VALUE (*number)(double value); \
+    BC_VALUE (*string)(const char* value); \
+    BC_VALUE (*function)(void* library, int argCount, int slotCount, int (*native)(BC_CORE core, BC_VALUE* base)); \
+    int (*release)(BC_VALUE value); \
+  } bcAotApi_t;
+
+#define BC_AOT_STRING(...) #__VA_ARGS__
+#define BC_AOT_EXPAND_STRING(...) BC_AOT_STRING(__VA_ARGS__)
+
+BC_AOT_API_DECLARATION
+
+/**
+ * Loaded shared library.
+ * 
+ * Library is kept loaded by programs and by function values, which scripts
+ * got from it, so functions outlive program. Constants of library are
+ * freed, when library is unloaded.
+ */
+typedef struct bcNativeLibrary_t
+{
+  int32_t refCount;     /**< Program and function references, updated atomically */
+  void* handle;
+  void (*cleanup)(void);
+} bcNativeLibrary_t;
+
+/**
+ * BC_FUNC with body in shared library.
+ * 
+ * Function constant of library holds no reference, and every function
+ * value pushed by generated code is a copy, which holds one.
+ */
+typedef struct bcAotFunc_t
+{
+  bcFunc_t func;
+  bcNativeLibrary_t* library;
+} bcAotFunc_t;
+
+/**
+ * Loaded native program.
+ */
+typedef struct bcNativeProgram_t
+{
+  bcNativeLibrary_t* library;
+  int (*main)(BC_CORE core);
+} bcNativeProgram_t;
+
+/**
+ * State of C emitter.
+ */
+typedef struct bcAotWriter_t
+{
+  FILE* output;
+  BC_VALUE* cons;
+  size_t conSize;
+  size_t conTotal;
+} bcAotWriter_t;
+
+static void bcNativeLibraryRelease(bcNativeLibrary_t* library)
+{
+  if (bcAtomicAdd32(&library->refCount, -1) != 0)
+  {
+    return;
+  }
+  library->cleanup();
+#ifndef _WIN32
+  dlclose(library->handle);
+#endif
+  free(library);
+}
+
+static void bcAotFinalize(bcFunc_t* func)
+{
+  bcNativeLibraryRelease(((bcAotFunc_t*) func)->library);
+}
+
+static bcAotFunc_t* bcAotFuncNew(bcNativeLibrary_t* library, size_t argCount, size_t slotCount, int (*native)(BC_CORE core, BC_VALUE* base))
+{
+  bcAotFunc_t* func = (bcAotFunc_t*) malloc(sizeof(bcAotFunc_t));
+  if (func == NULL)
+  {
+    return NULL;
+  }
+
+  func->func.head.type = BC_FUNC;
+  func->func.head.refCount = 1;
+  func->func.argCount = argCount;
+  func->func.slotCount = slotCount;
+  memset(&func->func.code, 0, sizeof(func->func.code));
+  func->func.native = native;
+  func->func.finalize = NULL;
+  func->library = library;
+  return func;
+}
+
+static int bcAotPush(BC_CORE core, BC_VALUE value)
+{
+  if (value->type != BC_FUNC)
+  {
+    return (int) bcValueStackPush(&core->stack, value);
+  }
+
+  // function value can outlive program, so it keeps library loaded
+  const bcAotFunc_t* constant = (const bcAotFunc_t*) value;
+  bcAotFunc_t* func = bcAotFuncNew(constant->library, constant->func.argCount, constant->func.slotCount, constant->func.native);
+  if (func == NULL)
+  {
+    return (int) BC_NO_MEMORY;
+  }
+  func->func.finalize = bcAotFinalize;
+  bcAtomicAdd32(&func->library->refCount, 1);
+
+  bcStatus_t status = bcValueStackPush(&core->stack, (BC_VALUE) func);
+  bcValueCleanup((BC_VALUE) func);
+  return (int) status;
+}
+
+static int bcAotPop(BC_CORE core)
+{
+  return (int) bcCoreOpPop(core);
+}
+
+static int bcAotBinary(BC_CORE core, int opcode)
+{
+  return (int) bcCoreOpBinary(core, (uint8_t) opcode);
+}
+
+static int bcAotUnary(BC_CORE core, int opcode)
+{
+  return (int) bcCoreOpUnary(core, (uint8_t) opcode);
+}
+
+static int bcAotSet(BC_CORE core)
+{
+  return (int) bcCoreOpSet(core);
+}
+
+static int bcAotValue(BC_CORE core)
+{
+  return (int) bcCoreOpValue(core);
+}
+
+static int bcAotResult(BC_CORE core)
+{
+  return (int) bcCoreOpResult(core);
+}
+
+static int bcAotLoadLocal(BC_CORE core, BC_VALUE* base, int slot)
+{
+  return (int) bcCoreOpLoadLocal(core, base, (uint8_t) slot);
+}
+
+static int bcAotStoreLocal(BC_CORE core, BC_VALUE* base, int slot)
+{
+  return (int) bcCoreOpStoreLocal(core, base, (uint8_t) slot);
+}
+
+//
+// Generated code has no code streams, so globals are accessed by name
+// constants instead of slots.
+//
+
+static int bcAotLoadGlobal(BC_CORE core, BC_VALUE name)
+{
+  BC_GLOBAL global = bcCoreFindGlobal(core, ((bcString_t*) name)->data);
+  if (global == NULL)
+  {
+    return (int) bcCorePushStoreGlobal(core, ((bcString_t*) name)->data);
+  }
+  return (int) bcCorePushGlobal(core, global);
+}
+
+static int bcAotStoreGlobal(BC_CORE core, BC_VALUE name)
+{
+  if ((core->stack.top - core->stack.bottom) < 1)
+  {
+    return (int) BC_UNDERFLOW;
+  }
+  return (int) bcCoreSetGlobal(core, ((bcString_t*) name)->data, core->stack.top[-1]);
+}
+
+static int bcAotCondition(BC_CORE core, int64_t* pValue)
+{
+  return (int) bcCoreOpCondition(core, pValue);
+}
+
+static int bcAotCall(BC_CORE core, int argCount)
+{
+  return (int) bcCoreCall(core, (uint8_t) argCount);
+}
+
+static BC_VALUE bcAotFunction(void* library, int argCount, int slotCount, int (*native)(BC_CORE core, BC_VALUE* base))
+{
+  return (BC_VALUE) bcAotFuncNew((bcNativeLibrary_t*) library, (size_t) argCount, (size_t) slotCount, native);
+}
+
+static int bcAotRelease(BC_VALUE value)
+{
+  return (int) bcValueCleanup(value);
+}
+
+static const bcAotApi_t bcAotRuntime =
+{
+  BC_AOT_VERSION,
+  bcAotPush,
+  bcAotPop,
+  bcAotBinary,
+  bcAotUnary,
+  bcAotSet,
+  bcAotValue,
+  bcAotResult,
+  bcAotLoadLocal,
+  bcAotStoreLocal,
+  bcAotLoadGlobal,
+  bcAotStoreGlobal,
+  bcAotCondition,
+  bcAotCall,
+  bcValueInteger,
+  bcValueNumber,
+  bcValueString,
+  bcAotFunction,
+  bcAotRelease,
+};
+
+static size_t bcAotFindConstant(const bcAotWriter_t* writer, const BC_VALUE value)
+{
+  for (size_t i = 0; i < writer->conSize; ++i)
+  {
+    if (writer->cons[i] == value)
+    {
+      return i;
+    }
+  }
+  return SIZE_MAX;
+}
+
+/**
+ * Collect constants of code stream and all nested streams.
+ *
+ * Lazy if bodies are compiled on the way, BC_CODE values never become
+ * constants of generated program.
+ */
+static bcStatus_t bcAotCollect(bcAotWriter_t* writer, const bcCodeStream_t* codeStream)
+{
+  for (size_t i = 0; i < codeStream->opSize; ++i)
+  {
+    uint8_t opcode = codeStream->opcodes[i];
+    if (!bcOpcodeHasArg(opcode))
+    {
+      continue;
+    }
+
+    if (++i >= codeStream->opSize)
+    {
+      return BC_MALFORMED_CODE;
+    }
+
+    if ((opcode != BC_PSH) && (opcode != BC_IFS) && (opcode != BC_LDG) && (opcode != BC_STG))
+    {
+      continue;
+    }
+
+    uint8_t conID = codeStream->opcodes[i];
+    if (conID >= codeStream->conSize)
+    {
+      return BC_CONST_NOT_FOUND;
+    }
+    BC_VALUE value = codeStream->cons[conID];
+
+    bcStatus_t status;
+    switch (value->type)
+    {
+    case BC_CODE:
+      status = bcCodeCompile((bcCode_t*) value);
+      if (status != BC_OK)
+      {
+        return status;
+      }
+      status = bcAotCollect(writer, &((bcCode_t*) value)->code);
+      if (status != BC_OK)
+      {
+        return status;
+      }
+      continue;
+    case BC_FUNC:
+      if (((bcFunc_t*) value)->native != NULL)
+      {
+        return BC_NOT_IMPLEMENTED;
+      }
+      break;
+    case BC_INTEGER:
+    case BC_NUMBER:
+    case BC_STRING:
+      break;
+    default:
+      return BC_NOT_IMPLEMENTED;
+    }
+
+    if (bcAotFindConstant(writer, value) != SIZE_MAX)
+    {
+      continue;
+    }
+
+    if (writer->conSize == writer->conTotal)
+    {
+      size_t total = (writer->conTotal == 0) ? 16 : 2 * writer->conTotal;
+      BC_VALUE* cons = (BC_VALUE*) realloc(writer->cons, total * sizeof(BC_VALUE));
+      if (cons == NULL)
+      {
+        return BC_NO_MEMORY;
+      }
+      writer->cons = cons;
+      writer->conTotal = total;
+    }
+    writer->cons[writer->conSize++] = value;
+
+    if (value->type == BC_FUNC)
+    {
+      status = bcAotCollect(writer, &((bcFunc_t*) value)->code);
+      if (status != BC_OK)
+      {
+        return status;
+      }
+    }
+  }
+  return BC_OK;
+}
+
+static void bcAotWriteString(FILE* output, const char* str)
+{
+  fputc('"', output);
+  for (const unsigned char* c = (const unsigned char*) str; *c != '\0'; ++c)
+  {
+    // escape '?' as well, to never produce trigraph
+    if ((*c >= ' ') && (*c <= '~') && (*c != '"') && (*c != '\\') && (*c != '?'))
+    {
+      fputc(*c, output);
+    }
+    else
+    {
+      fprintf(output, "\\%03o", (unsigned int) *c);
+    }
+  }
+  fputc('"', output);
+}
+
+static void bcAotWriteConstant(FILE* output, const BC_VALUE value, size_t index)
+{
+  switch (value->type)
+  {
+  case BC_INTEGER:
+  {
+    int64_t data = ((const bcInteger_t*) value)->data;
+    if (data == INT64_MIN)
+    {
+      fprintf(output, "api->integer(-INT64_C(9223372036854775807) - 1)");
+    }
+    else
+    {
+      fprintf(output, "api->integer(INT64_C(%" PRId64 "))", data);
+    }
+    break;
+  }
+  case BC_NUMBER:
+  {
+    double data = ((const bcNumber_t*) value)->data;
+    if (isnan(data))
+    {
+      fprintf(output, "api->number(NAN)");
+    }
+    else if (isinf(data))
+    {
+      fprintf(output, "api->number(%sHUGE_VAL)", (data < 0) ? "-" : "");
+    }
+    else
+    {
+      fprintf(output, "api->number(%a)", data);
+    }
+    break;
+  }
+  case BC_STRING:
+    fprintf(output, "api->string(");
+    bcAotWriteString(output, ((const bcString_t*) value)->data);
+    fprintf(output, ")");
+    break;
+  case BC_FUNC:
+  {
+    const bcFunc_t* func = (const bcFunc_t*) value;
+    fprintf(output, "api->function(library, %zu, %zu, bcAotFunc%zu)", func->argCount, func->slotCount, index);
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+/**
+ * Translate code stream to C statements.
+ *
+ * @param[in] writer emitter with collected constants
+ * @param[in] codeStream code stream to translate
+ * @param[in] depth nesting level, 0 for body of C function
+ */
+static bcStatus_t bcAotWriteStream(const bcAotWriter_t* writer, const bcCodeStream_t* codeStream, int depth)
+{
+  FILE* output = writer->output;
+  int indent = 2 * (depth + 1);
+
+  for (size_t i = 0; i < codeStream->opSize; ++i)
+  {
+    uint8_t opcode = codeStream->opcodes[i];
+    uint8_t arg = bcOpcodeHasArg(opcode) ? codeStream->opcodes[++i] : 0;
+
+    switch (opcode)
+    {
+    case BC_PSH:
+      fprintf(output, "%*sBC_AOT_CALL(api->push(core, cons[%zu]));\n", indent, "",
+        bcAotFindConstant(writer, codeStream->cons[arg]));
+      break;
+    case BC_POP:
+      fprintf(output, "%*sBC_AOT_CALL(api->pop(core));\n", indent, "");
+      break;
+    case BC_ADD:
+    case BC_SUB:
+    case BC_MUL:
+    case BC_DIV:
+    case BC_MOD:
+    case BC_EQ:
+    case BC_NEQ:
+    case BC_GR:
+    case BC_LS:
+    case BC_GRE:
+    case BC_LSE:
+    case BC_LND:
+    case BC_LOR:
+    case BC_BND:
+    case BC_BOR:
+    case BC_XOR:
+    case BC_BLS:
+    case BC_BRS:
+      fprintf(output, "%*sBC_AOT_CALL(api->binary(core, %d)); /* %s */\n", indent, "",
+        (int) opcode, bcOpcodeString(opcode));
+      break;
+    case BC_NEG:
+    case BC_LNT:
+    case BC_BNT:
+    case BC_INT:
+    case BC_NUM:
+    case BC_STR:
+      fprintf(output, "%*sBC_AOT_CALL(api->unary(core, %d)); /* %s */\n", indent, "",
+        (int) opcode, bcOpcodeString(opcode));
+      break;
+    case BC_SET:
+      fprintf(output, "%*sBC_AOT_CALL(api->set(core));\n", indent, "");
+      break;
+    case BC_VAL:
+      fprintf(output, "%*sBC_AOT_CALL(api->value(core));\n", indent, "");
+      break;
+    case BC_RET:
+      fprintf(output, "%*sBC_AOT_CALL(api->result(core));\n", indent, "");
+      break;
+    case BC_LDL:
+      fprintf(output, "%*sBC_AOT_CALL(api->loadLocal(core, base, %d));\n", indent, "", (int) arg);
+      break;
+    case BC_STL:
+      fprintf(output, "%*sBC_AOT_CALL(api->storeLocal(core, base, %d));\n", indent, "", (int) arg);
+      break;
+    case BC_LDG:
+      fprintf(output, "%*sBC_AOT_CALL(api->loadGlobal(core, cons[%zu]));\n", indent, "",
+        bcAotFindConstant(writer, codeStream->cons[arg]));
+      break;
+    case BC_STG:
+      fprintf(output, "%*sBC_AOT_CALL(api->storeGlobal(core, cons[%zu]));\n", indent, "",
+        bcAotFindConstant(writer, codeStream->cons[arg]));
+      break;
+    case BC_CLL:
+      fprintf(output, "%*sBC_AOT_CALL(api->call(core, %d));\n", indent, "", (int) arg);
+      break;
+    case BC_TCL:
+      fprintf(output, "%*sBC_AOT_CALL(api->call(core, %d));\n", indent, "", (int) arg);
+      fprintf(output, "%*sreturn 0;\n", indent, "");
+      break;
+    case BC_RTN:
+      fprintf(output, "%*sreturn 0;\n", indent, "");
+      break;
+    case BC_IFS:
+    {
+      const bcCode_t* body = (const bcCode_t*) codeStream->cons[arg];
+      fprintf(output, "%*s{\n", indent, "");
+      fprintf(output, "%*s  int64_t cond;\n", indent, "");
+      fprintf(output, "%*s  BC_AOT_CALL(api->condition(core, &cond));\n", indent, "");
+      fprintf(output, "%*s  if (cond != 0)\n", indent, "");
+      fprintf(output, "%*s  {\n", indent, "");
+      bcStatus_t status = bcAotWriteStream(writer, &body->code, depth + 2);
+      if (status != BC_OK)
+      {
+        return status;
+      }
+      fprintf(output, "%*s  }\n", indent, "");
+      fprintf(output, "%*s}\n", indent, "");
+      break;
+    }
+    case BC_HALT:
+      if (depth == 0)
+      {
+        fprintf(output, "%*sreturn 0;\n", indent, "");
+      }
+      return BC_OK;
+    default:
+      return BC_NOT_IMPLEMENTED;
+    }
+  }
+  return BC_OK;
+}
+
+static bcStatus_t bcAotWrite(bcAotWriter_t* writer, const bcCodeStream_t* codeStream)
+{
+  bcStatus_t status = bcAotCollect(writer, codeStream);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  FILE* output = writer->output;
+  size_t conSize = writer->conSize;
+
+  fprintf(output, "/* Generated by BadCode 0x%08" PRIx32 ", do not edit. */\n", bcVersion());
+  fprintf(output, "#include <math.h>\n");
+  fprintf(output, "#include <stddef.h>\n");
+  fprintf(output, "#include <stdint.h>\n\n");
+  fprintf(output, "typedef struct bcCore_t* BC_CORE;\n");
+  fprintf(output, "typedef struct bcValue_t* BC_VALUE;\n\n");
+  fprintf(output, "%s\n\n", BC_AOT_EXPAND_STRING(BC_AOT_API_DECLARATION));
+  fprintf(output, "#define BC_AOT_VERSION (%d)\n", BC_AOT_VERSION);
+  fprintf(output, "#define BC_AOT_CALL(CALL) do { int status = (CALL); if (status != 0) { return status; } } while (0)\n\n");
+  fprintf(output, "#if defined(_WIN32)\n#define BC_AOT_EXPORT __declspec(dllexport)\n");
+  fprintf(output, "#else\n#define BC_AOT_EXPORT __attribute__((visibility(\"default\")))\n#endif\n\n");
+  fprintf(output, "static const bcAotApi_t* api;\n");
+  fprintf(output, "static void* library;\n");
+  fprintf(output, "static BC_VALUE cons[%zu];\n\n", conSize + 1);
+
+  for (size_t i = 0; i < conSize; ++i)
+  {
+    if (writer->cons[i]->type == BC_FUNC)
+    {
+      fprintf(output, "static int bcAotFunc%zu(BC_CORE core, BC_VALUE* base);\n", i);
+    }
+  }
+
+  for (size_t i = 0; i < conSize; ++i)
+  {
+    if (writer->cons[i]->type != BC_FUNC)
+    {
+      continue;
+    }
+    fprintf(output, "\nstatic int bcAotFunc%zu(BC_CORE core, BC_VALUE* base)\n{\n", i);
+    fprintf(output, "  (void) base;\n");
+    status = bcAotWriteStream(writer, &((const bcFunc_t*) writer->cons[i])->code, 0);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+    fprintf(output, "}\n");
+  }
+
+  fprintf(output, "\nBC_AOT_EXPORT int bcAotMain(BC_CORE core)\n{\n");
+  status = bcAotWriteStream(writer, codeStream, 0);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+  fprintf(output, "}\n");
+
+  fprintf(output, "\nBC_AOT_EXPORT void bcAotCleanup(void)\n{\n");
+  fprintf(output, "  for (size_t i = 0; i < sizeof(cons) / sizeof(cons[0]); ++i)\n  {\n");
+  fprintf(output, "    if (cons[i] != NULL)\n    {\n      api->release(cons[i]);\n      cons[i] = NULL;\n    }\n  }\n");
+  fprintf(output, "  library = NULL;\n");
+  fprintf(output, "}\n");
+
+  fprintf(output, "\nBC_AOT_EXPORT int bcAotInit(const bcAotApi_t* runtime, void** pOwner)\n{\n");
+  fprintf(output, "  if (runtime->version != BC_AOT_VERSION)\n  {\n    return -1;\n  }\n");
+  fprintf(output, "  if (library != NULL)\n  {\n    *pOwner = library;\n    return 0;\n  }\n");
+  fprintf(output, "  api = runtime;\n");
+  fprintf(output, "  library = *pOwner;\n");
+  for (size_t i = 0; i < conSize; ++i)
+  {
+    fprintf(output, "  cons[%zu] = ", i);
+    bcAotWriteConstant(output, writer->cons[i], i);
+    fprintf(output, ";\n");
+  }
+  fprintf(output, "  for (size_t i = 0; i < %zu; ++i)\n  {\n", conSize);
+  fprintf(output, "    if (cons[i] == NULL)\n    {\n      bcAotCleanup();\n      return -1;\n    }\n  }\n");
+  fprintf(output, "  return 0;\n}\n");
+
+  return (ferror(output) != 0) ? BC_INVALID_ARG : BC_OK;
+}
+
+BCAPI bcStatus_t bcCompileToC(const char* code, FILE* output)
+{
+  if ((code == NULL) || (output == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  BC_PROGRAM program = NULL;
+  bcStatus_t status = bcProgramCompile(code, &program);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  bcAotWriter_t writer = { output, NULL, 0, 0 };
+  status = bcAotWrite(&writer, &program->code);
+  free(writer.cons);
+
+  bcProgramDelete(program);
+  return status;
+}
+
+#ifndef _WIN32
+
+BCAPI bcStatus_t bcNativeProgramLoad(const char* path, BC_NATIVE_PROGRAM* pProgram)
+{
+  if ((path == NULL) || (pProgram == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  void* library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+  if (library == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  void* mainSymbol = dlsym(library, "bcAotMain");
+  void* initSymbol = dlsym(library, "bcAotInit");
+  void* cleanupSymbol = dlsym(library, "bcAotCleanup");
+  if ((mainSymbol == NULL) || (initSymbol == NULL) || (cleanupSymbol == NULL))
+  {
+    dlclose(library);
+    return BC_NOT_DEFINED;
+  }
+
+  bcNativeProgram_t* program = (bcNativeProgram_t*) malloc(sizeof(bcNativeProgram_t));
+  bcNativeLibrary_t* owner = (bcNativeLibrary_t*) malloc(sizeof(bcNativeLibrary_t));
+  if ((program == NULL) || (owner == NULL))
+  {
+    free(program);
+    free(owner);
+    dlclose(library);
+    return BC_NO_MEMORY;
+  }
+
+  // ISO C has no cast between data and function pointers
+  int (*init)(const bcAotApi_t* api, void** pOwner);
+  memcpy(&init, &initSymbol, sizeof(init));
+  memcpy(&program->main, &mainSymbol, sizeof(program->main));
+  memcpy(&owner->cleanup, &cleanupSymbol, sizeof(owner->cleanup));
+  owner->refCount = 1;
+  owner->handle = library;
+
+  void* current = owner;
+  if (init(&bcAotRuntime, &current) != 0)
+  {
+    free(program);
+    free(owner);
+    dlclose(library);
+    return BC_MALFORMED_CODE;
+  }
+
+  if (current != owner)
+  { // library is loaded by other program already, share its state
+    free(owner);
+    dlclose(library);
+    owner = (bcNativeLibrary_t*) current;
+    bcAtomicAdd32(&owner->refCount, 1);
+  }
+
+  program->library = owner;
+  *pProgram = program;
+  return BC_OK;
+}
+
+BCAPI void bcNativeProgramDelete(BC_NATIVE_PROGRAM program)
+{
+  if (program != NULL)
+  {
+    bcNativeLibraryRelease(program->library);
+    free(program);
+  }
+}
+
+#else
+
+BCAPI bcStatus_t bcNativeProgramLoad(const char* path, BC_NATIVE_PROGRAM* pProgram)
+{
+  (void) path;
+  (void) pProgram;
+  (void) bcAotRuntime;
+  return BC_NOT_IMPLEMENTED;
+}
+
+BCAPI void bcNativeProgramDelete(BC_NATIVE_PROGRAM program)
+{
+  (void) program;
+}
+
+#endif
+
+BCAPI bcStatus_t bcCoreExecuteNative(BC_CORE core, const BC_NATIVE_PROGRAM program)
+{
+  if ((core == NULL) || (program == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcFrame_t* frames = core->frames.top;
+  BC_VALUE* values = core->stack.top;
+
+  bcStatus_t status = (bcStatus_t) program->main(core);
+  if (status != BC_OK)
+  {
+    bcCoreUnwind(core, frames, values);
+  }
+  return status;
+}
@@ -1,4 +1,5 @@
 #include <bcPrivate.h>
+#include <bcSync.h>
 
 #include <stdlib.h>
 #include <stdio.h>
@@ -28,24 +29,63 @@ bcStatus_t bcCodeStreamInit(bcCodeStream_t* cs)
   cs->cons = cons;
   cs->conSize = 0;
   cs->conCap = BC_CODE_STREAM_INITIAL_CONST_CAP;
+
+  cs->image = NULL;
+  cs->imageOffset = 0;
+
+  cs->slotSize = 0;
+  cs->slots = NULL;
   return BC_OK;
 }
 
 bcStatus_t bcCodeStreamCleanup(bcCodeStream_t* cs)
 {
-  free(cs->opcodes);
+  if (cs->image == NULL)
+  { // loaded code stream borrows opcodes from image
+    free(cs->opcodes);
+  }
   cs->opcodes = NULL;
   cs->opSize = 0;
   cs->opCap = 0;
 
   for (BC_VALUE* cursor = cs->cons, *end = cs->cons+cs->conSize;  cursor!=end; ++cursor)
   {
-    bcValueCleanup(*cursor);
+    if (*cursor != NULL)
+    { // constants of loaded code stream may be not materialized
+      bcValueCleanup(*cursor);
+    }
   }
   free(cs->cons);
   cs->cons = NULL;
   cs->conSize = 0;
   cs->conCap = 0;
+
+  cs->image = NULL;
+  cs->imageOffset = 0;
+
+  free(cs->slots);
+  cs->slots = NULL;
+  cs->slotSize = 0;
+  return BC_OK;
+}
+
+bcStatus_t bcCodeStreamConstant(const bcCodeStream_t* cs, uint8_t conID, BC_VALUE* pCon)
+{
+  if (conID >= cs->conSize)
+  {
+    return BC_CONST_NOT_FOUND;
+  }
+
+  if (cs->cons[conID] == NULL)
+  {
+    bcStatus_t status = bcImageConstant((bcCodeStream_t*) cs, conID);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+  }
+
+  *pCon = cs->cons[conID];
   return BC_OK;
 }
 
@@ -107,31 +147,366 @@ bcStatus_t bcCodeStreamAppendConstant(bcCodeStream_t* cs, const BC_VALUE con, ui
   return BC_OK;  
 }
 
-static bcStatus_t bcCodeStreamProduce(bcCodeStream_t* cs, const bcTreeItem_t* item)
+/**
+ * Function frame slots known at compile time.
+ * 
+ * Top-level code has no scope, so all names in it refer to global variables.
+ */
+typedef struct bcScope_t
+{
+  size_t size;                  /**< Total slots used */
+  BC_VALUE names[UINT8_MAX+1];  /**< Slot names */
+} bcScope_t;
+
+static void bcScopeCleanup(bcScope_t* scope)
 {
-  if ((cs == NULL) || (item == NULL))
+  for (size_t slot = 0; slot < scope->size; ++slot)
+  {
+    bcValueCleanup(scope->names[slot]);
+  }
+  scope->size = 0;
+}
+
+static BC_VALUE bcTreeItemName(const bcTreeArena_t* arena, bcTreeRef_t ref)
+{
+  if ((ref == BC_TREE_NONE) || (bcTreeItem(arena, ref)->type != TIT_CONSTANT))
+  {
+    return NULL;
+  }
+
+  BC_VALUE value = bcTreeValue(arena, bcTreeItem(arena, ref)->as.constant.value);
+  if (value->type != BC_STRING)
+  {
+    return NULL;
+  }
+  return value;
+}
+
+static int bcScopeFind(const bcScope_t* scope, const BC_VALUE name)
+{
+  if ((scope == NULL) || (name == NULL))
+  {
+    return -1;
+  }
+
+  for (size_t slot = 0; slot < scope->size; ++slot)
+  {
+    if (strcmp(((const bcString_t*) scope->names[slot])->data, ((const bcString_t*) name)->data) == 0)
+    {
+      return (int) slot;
+    }
+  }
+  return -1;
+}
+
+static bcStatus_t bcScopeAdd(bcScope_t* scope, const BC_VALUE name)
+{
+  if (bcScopeFind(scope, name) >= 0)
+  {
+    return BC_OK;
+  }
+
+  if (scope->size == (UINT8_MAX+1))
+  {
+    return BC_TOO_MANY_LOCALS;
+  }
+
+  // names are referenced, because if-statement parse trees are freed during compilation
+  scope->names[scope->size++] = bcValueCopy(name);
+  return BC_OK;
+}
+
+/**
+ * Add every name assigned in function body to scope.
+ * 
+ * Nested function bodies have own scopes, so only their names are added.
+ */
+static bcStatus_t bcScopeCollect(bcScope_t* scope, const bcTreeArena_t* arena, bcTreeRef_t item)
+{
+  for (bcTreeRef_t ref = item; ref != BC_TREE_NONE; ref = bcTreeItem(arena, ref)->next)
+  {
+    const bcTreeItem_t* cursor = bcTreeItem(arena, ref);
+    bcStatus_t status = BC_OK;
+    switch (cursor->type)
+    {
+    case TIT_BIN_OP:
+      {
+        BC_VALUE name = bcTreeItemName(arena, cursor->as.binOp.lbr);
+        if ((cursor->as.binOp.tag == BC_SET) && (name != NULL))
+        {
+          status = bcScopeAdd(scope, name);
+        }
+        else
+        {
+          status = bcScopeCollect(scope, arena, cursor->as.binOp.lbr);
+        }
+        if (status == BC_OK)
+        {
+          status = bcScopeCollect(scope, arena, cursor->as.binOp.rbr);
+        }
+      }
+      break;
+    case TIT_UN_OP:
+      status = bcScopeCollect(scope, arena, cursor->as.unOp.br);
+      break;
+    case TIT_IF_STATEMENT:
+      status = bcScopeCollect(scope, arena, cursor->as.ifStatement.cond);
+      if (status == BC_OK)
+      {
+        status = bcScopeCollect(scope, arena, cursor->as.ifStatement.body);
+      }
+      break;
+    case TIT_FUNCTION:
+      status = bcScopeAdd(scope, bcTreeValue(arena, cursor->as.function.name));
+      break;
+    case TIT_CALL:
+      status = bcScopeCollect(scope, arena, cursor->as.call.func);
+      if (status == BC_OK)
+      {
+        status = bcScopeCollect(scope, arena, cursor->as.call.args);
+      }
+      break;
+    default:
+      break;
+    }
+
+    if (status != BC_OK)
+    {
+      return status;
+    }
+  }
+  return BC_OK;
+}
+
+bcStatus_t bcCodeStreamAppendOpcodeArg(bcCodeStream_t* cs, uint8_t opcode, uint8_t arg)
+{
+  bcStatus_t status = bcCodeStreamAppendOpcode(cs, opcode);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+  return bcCodeStreamAppendOpcode(cs, arg);
+}
+
+bcStatus_t bcCodeStreamAppendPush(bcCodeStream_t* cs, const BC_VALUE con)
+{
+  uint8_t conCode;
+  bcStatus_t status = bcCodeStreamAppendConstant(cs, con, &conCode);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+  return bcCodeStreamAppendOpcodeArg(cs, BC_PSH, conCode);
+}
+
+bcStatus_t bcCodeStreamAppendGlobal(bcCodeStream_t* cs, uint8_t opcode, const BC_VALUE name)
+{
+  if ((name == NULL) || (name->type != BC_STRING))
+  {
+    return BC_INVALID_ID;
+  }
+
+  uint8_t conCode;
+  bcStatus_t status = bcCodeStreamAppendConstant(cs, name, &conCode);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  // slot cache grows at compile time only, so executing threads never
+  // see it moved
+  if (conCode >= cs->slotSize)
+  {
+    size_t slotSize = (cs->conCap > conCode)? cs->conCap : (size_t) conCode + 1;
+    uint64_t* slots = (uint64_t*) realloc(cs->slots, slotSize*sizeof(uint64_t));
+    if (slots == NULL)
+    {
+      return BC_NO_MEMORY;
+    }
+
+    memset(slots + cs->slotSize, 0, (slotSize - cs->slotSize)*sizeof(uint64_t));
+    cs->slots = slots;
+    cs->slotSize = slotSize;
+  }
+  return bcCodeStreamAppendOpcodeArg(cs, opcode, conCode);
+}
+
+static bcStatus_t bcCodeStreamCompileScoped(bcCodeStream_t* cs, bcTree_t* tree, const bcScope_t* scope);
+
+static bcStatus_t bcCodeStreamProduce(bcCodeStream_t* cs, bcTreeArena_t* arena, bcTreeRef_t item, const bcScope_t* scope);
+
+static bcStatus_t bcCodeStreamProduceCall(bcCodeStream_t* cs, bcTreeArena_t* arena, const bcTreeItem_t* call, const bcScope_t* scope, uint8_t opcode)
+{
+  size_t argCount = 0;
+  for (bcTreeRef_t ref = call->as.call.args; ref != BC_TREE_NONE; ref = bcTreeItem(arena, ref)->next)
+  {
+    ++argCount;
+  }
+
+  if (argCount > UINT8_MAX)
+  {
+    return BC_TOO_MANY_LOCALS;
+  }
+
+  bcStatus_t status = bcCodeStreamProduce(cs, arena, call->as.call.func, scope);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  if (call->as.call.args != BC_TREE_NONE)
+  {
+    status = bcCodeStreamProduce(cs, arena, call->as.call.args, scope);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+  }
+
+  return bcCodeStreamAppendOpcodeArg(cs, opcode, (uint8_t) argCount);
+}
+
+/**
+ * Compile function definition into BC_FUNC value.
+ */
+static BC_VALUE bcFuncCompile(bcTreeArena_t* arena, const bcTreeItem_t* def, bcStatus_t* pStatus)
+{
+  bcScope_t scope;
+  scope.size = 0;
+
+  for (bcTreeRef_t ref = def->as.function.params; ref != BC_TREE_NONE; ref = bcTreeItem(arena, ref)->next)
+  {
+    BC_VALUE name = bcTreeItemName(arena, ref);
+    if ((name == NULL) || (bcScopeFind(&scope, name) >= 0))
+    { // parameter names must be unique
+      bcScopeCleanup(&scope);
+      *pStatus = BC_INVALID_ID;
+      return NULL;
+    }
+
+    *pStatus = bcScopeAdd(&scope, name);
+    if (*pStatus != BC_OK)
+    {
+      bcScopeCleanup(&scope);
+      return NULL;
+    }
+  }
+
+  size_t argCount = scope.size;
+  *pStatus = bcScopeCollect(&scope, arena, def->as.function.body);
+  if (*pStatus != BC_OK)
+  {
+    bcScopeCleanup(&scope);
+    return NULL;
+  }
+
+  bcFunc_t* result = (bcFunc_t*) malloc(sizeof(bcFunc_t));
+  if (result == NULL)
+  {
+    bcScopeCleanup(&scope);
+    *pStatus = BC_NO_MEMORY;
+    return NULL;
+  }
+
+  result->head.type = BC_FUNC;
+  result->head.refCount = 1;
+  result->argCount = argCount;
+  result->slotCount = scope.size;
+  result->native = NULL;
+  result->finalize = NULL;
+
+  *pStatus = bcCodeStreamInit(&result->code);
+  if (*pStatus != BC_OK)
+  {
+    bcScopeCleanup(&scope);
+    free(result);
+    return NULL;
+  }
+
+  if (def->as.function.body != BC_TREE_NONE)
+  {
+    *pStatus = bcCodeStreamProduce(&result->code, arena, def->as.function.body, &scope);
+  }
+
+  if (*pStatus == BC_OK)
+  { // function without return statement returns 0
+    BC_VALUE zero = bcValueInteger(0);
+    *pStatus = (zero != NULL)? bcCodeStreamAppendPush(&result->code, zero) : BC_NO_MEMORY;
+    bcValueCleanup(zero);
+  }
+
+  if (*pStatus == BC_OK)
+  {
+    *pStatus = bcCodeStreamAppendOpcode(&result->code, BC_RTN);
+  }
+
+  bcScopeCleanup(&scope);
+  if (*pStatus != BC_OK)
+  {
+    bcValueCleanup(&result->head);
+    return NULL;
+  }
+  return &result->head;
+}
+
+static bcStatus_t bcCodeStreamProduce(bcCodeStream_t* cs, bcTreeArena_t* arena, bcTreeRef_t item, const bcScope_t* scope)
+{
+  if ((cs == NULL) || (arena == NULL) || (item == BC_TREE_NONE))
   {
     return BC_INVALID_ARG;
   }
 
-  for (const bcTreeItem_t* cursor = item; cursor != NULL; cursor = cursor->next)
+  for (bcTreeRef_t ref = item; ref != BC_TREE_NONE; ref = bcTreeItem(arena, ref)->next)
   {
+    const bcTreeItem_t* cursor = bcTreeItem(arena, ref);
     switch (cursor->type)
     {
     case TIT_BIN_OP:
       {
-        bcBinOp_t* binop = (bcBinOp_t*) cursor;
-        bcStatus_t status = bcCodeStreamProduce(cs, binop->lbr);
+        int tag = cursor->as.binOp.tag;
+        int slot = (tag == BC_SET)? bcScopeFind(scope, bcTreeItemName(arena, cursor->as.binOp.lbr)) : -1;
+        if (slot >= 0)
+        { // local variable assignment
+          bcStatus_t status = bcCodeStreamProduce(cs, arena, cursor->as.binOp.rbr, scope);
+          if (status != BC_OK)
+          {
+            return status;
+          }
+          status = bcCodeStreamAppendOpcodeArg(cs, BC_STL, (uint8_t) slot);
+          if (status != BC_OK)
+          {
+            return status;
+          }
+          break;
+        }
+
+        BC_VALUE name = (tag == BC_SET)? bcTreeItemName(arena, cursor->as.binOp.lbr) : NULL;
+        if (name != NULL)
+        { // global variable assignment
+          bcStatus_t status = bcCodeStreamProduce(cs, arena, cursor->as.binOp.rbr, scope);
+          if (status != BC_OK)
+          {
+            return status;
+          }
+          status = bcCodeStreamAppendGlobal(cs, BC_STG, name);
+          if (status != BC_OK)
+          {
+            return status;
+          }
+          break;
+        }
+
+        bcStatus_t status = bcCodeStreamProduce(cs, arena, cursor->as.binOp.lbr, scope);
         if (status != BC_OK)
         {
           return status;
         }
-        status = bcCodeStreamProduce(cs, binop->rbr);
+        status = bcCodeStreamProduce(cs, arena, cursor->as.binOp.rbr, scope);
         if (status != BC_OK)
         {
           return status;
         }
-        status = bcCodeStreamAppendOpcode(cs, (uint8_t) binop->tag);
+        status = bcCodeStreamAppendOpcode(cs, (uint8_t) tag);
         if (status != BC_OK)
         {
           return status;
@@ -140,14 +515,57 @@ static bcStatus_t bcCodeStreamProduce(bcCodeStream_t* cs, const bcTreeItem_t* it
       break;
     case TIT_UN_OP:
       {
-        bcUnOp_t* unop = (bcUnOp_t*) cursor;
-        bcStatus_t status = bcCodeStreamProduce(cs, unop->br);
+        int tag = cursor->as.unOp.tag;
+        int slot = (tag == BC_VAL)? bcScopeFind(scope, bcTreeItemName(arena, cursor->as.unOp.br)) : -1;
+        if (slot >= 0)
+        { // local variable value
+          bcStatus_t status = bcCodeStreamAppendOpcodeArg(cs, BC_LDL, (uint8_t) slot);
+          if (status != BC_OK)
+          {
+            return status;
+          }
+          break;
+        }
+
+        BC_VALUE name = (tag == BC_VAL)? bcTreeItemName(arena, cursor->as.unOp.br) : NULL;
+        if (name != NULL)
+        { // global variable value
+          bcStatus_t status = bcCodeStreamAppendGlobal(cs, BC_LDG, name);
+          if (status != BC_OK)
+          {
+            return status;
+          }
+          break;
+        }
+
+        if (tag == BC_RTN)
+        {
+          if (scope == NULL)
+          { // return outside of function
+            return BC_MALFORMED_CODE;
+          }
+
+          const bcTreeItem_t* br = bcTreeItem(arena, cursor->as.unOp.br);
+          if (br->type == TIT_CALL)
+          { // call result is returned as is, so current frame can be reused
+            bcStatus_t status = bcCodeStreamProduceCall(cs, arena, br, scope, BC_TCL);
+            if (status != BC_OK)
+            {
+              return status;
+            }
+            break;
+          }
+        }
+
+        bcStatus_t status = bcCodeStreamProduce(cs, arena, cursor->as.unOp.br, scope);
         if (status != BC_OK)
         {
           return status;
         }
 
-        status = bcCodeStreamAppendOpcode(cs, (uint8_t) unop->tag);
+        // statement results inside function are not interpreter results
+        uint8_t opcode = ((tag == BC_RET) && (scope != NULL))? BC_POP : (uint8_t) tag;
+        status = bcCodeStreamAppendOpcode(cs, opcode);
         if (status != BC_OK)
         {
           return status;
@@ -156,54 +574,109 @@ static bcStatus_t bcCodeStreamProduce(bcCodeStream_t* cs, const bcTreeItem_t* it
       break;
     case TIT_CONSTANT:
       {
-        bcConstant_t* cns = (bcConstant_t*) cursor;
+        bcStatus_t status = bcCodeStreamAppendPush(cs, bcTreeValue(arena, cursor->as.constant.value));
+        if (status != BC_OK)
+        {
+          return status;
+        }
+      }
+      break;
+    case TIT_IF_STATEMENT:
+      {
+        // lazy body references arena, so it outlives parse tree
+        bcTree_t* body = bcTree(arena, cursor->as.ifStatement.body);
+        if (body == NULL)
+        {
+          return BC_NO_MEMORY;
+        }
+
+        BC_VALUE lazyBody = bcValueCode(body);
+        if (lazyBody == NULL)
+        {
+          bcTreeCleanup(body);
+          return BC_NO_MEMORY;
+        }
+
+        if (scope != NULL)
+        { // function scope is not available later, so compile body now
+          bcCode_t* code = (bcCode_t*) lazyBody;
+          bcStatus_t status = bcCodeStreamInit(&code->code);
+          if (status == BC_OK)
+          {
+            status = bcCodeStreamCompileScoped(&code->code, code->tree, scope);
+          }
+          if (status != BC_OK)
+          {
+            bcValueCleanup(lazyBody);
+            return status;
+          }
+          bcTreeCleanup(code->tree);
+          code->tree = NULL;
+        }
+
         uint8_t conCode;
-        bcStatus_t status = bcCodeStreamAppendConstant(cs, cns->constVal, &conCode);
+        bcStatus_t status = bcCodeStreamAppendConstant(cs, lazyBody, &conCode);
+        bcValueCleanup(lazyBody);
         if (status != BC_OK)
         {
           return status;
         }
-        status = bcCodeStreamAppendOpcode(cs, BC_PSH);
+
+        status = bcCodeStreamProduce(cs, arena, cursor->as.ifStatement.cond, scope);
         if (status != BC_OK)
         {
           return status;
         }
-        status = bcCodeStreamAppendOpcode(cs, conCode);
+
+        status = bcCodeStreamAppendOpcodeArg(cs, BC_IFS, conCode);
         if (status != BC_OK)
         {
           return status;
         }
       }
       break;
-    case TIT_IF_STATEMENT:
+    case TIT_FUNCTION:
       {
-        bcIfStatement_t* ifstat = (bcIfStatement_t*) cursor;
-        BC_VALUE compiledBody = bcValueCode(ifstat->body);
-        if (compiledBody == NULL)
+        BC_VALUE name = bcTreeValue(arena, cursor->as.function.name);
+
+        bcStatus_t status;
+        BC_VALUE func = bcFuncCompile(arena, cursor, &status);
+        if (func == NULL)
         {
-          return BC_NO_MEMORY;
+          return status;
         }
 
-        uint8_t conCode;
-        bcStatus_t status = bcCodeStreamAppendConstant(cs, compiledBody, &conCode);
-        bcValueCleanup(compiledBody);
+        int slot = bcScopeFind(scope, name);
+        status = bcCodeStreamAppendPush(cs, func);
+        bcValueCleanup(func);
         if (status != BC_OK)
         {
           return status;
         }
 
-        status = bcCodeStreamProduce(cs, ifstat->cond);
+        if (slot < 0)
+        {
+          status = bcCodeStreamAppendGlobal(cs, BC_STG, name);
+        }
+        else
+        {
+          status = bcCodeStreamAppendOpcodeArg(cs, BC_STL, (uint8_t) slot);
+        }
         if (status != BC_OK)
         {
           return status;
         }
 
-        status = bcCodeStreamAppendOpcode(cs, BC_IFS);
+        status = bcCodeStreamAppendOpcode(cs, BC_POP);
         if (status != BC_OK)
         {
           return status;
         }
-        status = bcCodeStreamAppendOpcode(cs, conCode);
+      }
+      break;
+    case TIT_CALL:
+      {
+        bcStatus_t status = bcCodeStreamProduceCall(cs, arena, cursor, scope, BC_CLL);
         if (status != BC_OK)
         {
           return status;
@@ -217,16 +690,16 @@ static bcStatus_t bcCodeStreamProduce(bcCodeStream_t* cs, const bcTreeItem_t* it
   return BC_OK;
 }
 
-bcStatus_t bcCodeStreamCompile(bcCodeStream_t* cs, const bcTree_t* tree)
+static bcStatus_t bcCodeStreamCompileScoped(bcCodeStream_t* cs, bcTree_t* tree, const bcScope_t* scope)
 {
   if ((cs == NULL) || (tree == NULL))
   {
     return BC_INVALID_ARG;
   }
 
-  if (tree->root != NULL)
+  if (tree->root != BC_TREE_NONE)
   {
-    bcStatus_t result = bcCodeStreamProduce(cs, tree->root);
+    bcStatus_t result = bcCodeStreamProduce(cs, tree->arena, tree->root, scope);
     if (result != BC_OK)
     {
       return result;
@@ -234,3 +707,147 @@ bcStatus_t bcCodeStreamCompile(bcCodeStream_t* cs, const bcTree_t* tree)
   }
   return bcCodeStreamAppendOpcode(cs, BC_HALT);
 }
+
+bcStatus_t bcCodeStreamCompile(bcCodeStream_t* cs, bcTree_t* tree)
+{
+  return bcCodeStreamCompileScoped(cs, tree, NULL);
+}
+
+bcStatus_t bcCodeStreamAppendStatement(bcCodeStream_t* cs, bcTreeArena_t* arena, bcTreeRef_t item)
+{
+  return bcCodeStreamProduce(cs, arena, item, NULL);
+}
+
+bcStatus_t bcCodeCompile(bcCode_t* code)
+{
+  if (code == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  if (code->tree == NULL)
+  { // already compiled
+    return BC_OK;
+  }
+
+  bcCodeStream_t codeStream;
+  bcStatus_t status = bcCodeStreamInit(&codeStream);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  status = bcCodeStreamCompile(&codeStream, code->tree);
+  if (status != BC_OK)
+  {
+    bcCodeStreamCleanup(&codeStream);
+    return status;
+  }
+
+  bcTreeCleanup(code->tree);
+  code->tree = NULL;
+  code->code = codeStream;
+  return BC_OK;
+}
+
+static bcStatus_t bcCodeStreamShareGraph(bcCodeStream_t* cs, size_t* pSize, int immortal);
+
+/**
+ * Share value and values it refers to. Values, which are shared by this
+ * call, are made immortal, if requested.
+ */
+static bcStatus_t bcValueShareGraph(BC_VALUE value, size_t* pSize, int immortal)
+{
+  *pSize = 0;
+  if (value->refCount < 0)
+  { // already shared
+    return BC_OK;
+  }
+
+  size_t nestedSize = 0;
+  bcStatus_t status = BC_OK;
+  switch (value->type)
+  {
+  case BC_CODE:
+    status = bcCodeCompile((bcCode_t*) value);
+    if (status == BC_OK)
+    {
+      status = bcCodeStreamShareGraph(&((bcCode_t*) value)->code, &nestedSize, immortal);
+    }
+    *pSize = sizeof(bcCode_t) + nestedSize;
+    break;
+  case BC_FUNC:
+    status = bcCodeStreamShareGraph(&((bcFunc_t*) value)->code, &nestedSize, immortal);
+    *pSize = sizeof(bcFunc_t) + nestedSize;
+    break;
+  case BC_STRING:
+    *pSize = sizeof(bcString_t) + ((const bcString_t*) value)->len;
+    break;
+  default:
+    *pSize = sizeof(bcNumber_t);
+    break;
+  }
+
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  if (immortal)
+  { // counter isn't visible to other threads yet
+    value->refCount = BC_REF_STATIC;
+  }
+  else
+  {
+    bcValueShare(value);
+  }
+  return BC_OK;
+}
+
+static bcStatus_t bcCodeStreamShareGraph(bcCodeStream_t* cs, size_t* pSize, int immortal)
+{
+  size_t size = cs->opCap + cs->conCap * sizeof(BC_VALUE);
+
+  for (size_t i = 0; i < cs->conSize; ++i)
+  {
+    BC_VALUE con;
+    bcStatus_t status = bcCodeStreamConstant(cs, (uint8_t) i, &con);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+
+    size_t conSize = 0;
+    status = bcValueShareGraph(con, &conSize, immortal);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+    size += conSize;
+  }
+
+  size += cs->slotSize * sizeof(uint64_t);
+  *pSize = size;
+  return BC_OK;
+}
+
+bcStatus_t bcCodeStreamShare(bcCodeStream_t* cs, size_t* pSize)
+{
+  return bcCodeStreamShareGraph(cs, pSize, 0);
+}
+
+bcStatus_t bcValueShareDeep(BC_VALUE value, size_t* pSize)
+{
+  return bcValueShareGraph(value, pSize, 0);
+}
+
+BCAPI bcStatus_t bcValueFreeze(BC_VALUE value, bcFreezeMode_t mode)
+{
+  if ((value == NULL) || ((mode != BC_FREEZE_SHARED) && (mode != BC_FREEZE_IMMORTAL)))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  size_t size;
+  return bcValueShareGraph(value, &size, mode == BC_FREEZE_IMMORTAL);
+}
@@ -0,0 +1,424 @@
+/**
+ * Process-wide cache of compiled code.
+ *
+ * Entries are kept in chains of fixed number of buckets. Readers walk chains
+ * without locks, writers are serialized by mutex. Entry removed from chain
+ * is not released until every reader, which could still see it, leaves
+ * chain (see bcCacheSynchronize). Entry found by reader is pinned with its
+ * reference counter, so code stream stays alive while it is executed.
+ *
+ * Entries are replaced by CLOCK policy: every entry is kept in ring, hit
+ * marks entry referenced, and hand, which moves over ring, evicts first entry
+ * not referenced since hand passed it last time. Evicted entries are retired
+ * and released in batches, so one grace period is waited for whole batch,
+ * and writer lock is not held meanwhile.
+ */
+#include <bcPrivate.h>
+#include <bcSync.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Counters of threads using one stripe, padded to own cache line.
+ */
+typedef union bcCacheStripe_t
+{
+  struct
+  {
+    int32_t readers[2]; /**< Readers walking chains, by epoch parity */
+    uint64_t hits;      /**< Hits, updated with relaxed atomics */
+    uint64_t misses;    /**< Misses, updated with relaxed atomics */
+  } counters;
+  char pad[64];
+} bcCacheStripe_t;
+
+typedef struct bcCache_t
+{
+  bcCacheEntry_t* buckets[BC_CACHE_BUCKETS]; /**< Entry chains, updated atomically */
+  bcMutex_t lock;     /**< Serializes writers */
+  bcMutex_t syncLock; /**< Serializes grace periods */
+  uint64_t epoch;     /**< Readers epoch, its parity selects readers counter */
+  bcCacheStripe_t stripes[BC_CACHE_STRIPES]; /**< Per thread counters */
+  int32_t nextStripe; /**< Stripe given to next new thread */
+  bcCacheEntry_t* hand;    /**< CLOCK hand, or NULL if cache is empty */
+  bcCacheEntry_t* retired; /**< Entries removed from chains, but not released */
+  size_t retiredSize;      /**< Entries in retired list */
+  uint64_t limit;     /**< Memory limit, 0 disables cache */
+  uint64_t size;      /**< Approximate memory used by entries */
+  uint64_t entries;   /**< Total entries */
+  uint64_t evictions; /**< Total evictions */
+} bcCache_t;
+
+static bcCache_t bcCache = { { NULL }, BC_MUTEX_INIT, BC_MUTEX_INIT, 0, { { { { 0, 0 }, 0, 0 } } }, 0, NULL, NULL, 0, BC_CACHE_DEFAULT_LIMIT, 0, 0, 0 };
+
+static BC_THREAD_LOCAL int32_t bcCacheStripeIndex = -1; /**< Stripe of this thread */
+
+static uint64_t bcCacheHash(const char* code, size_t len, int newline)
+{ // FNV-1a
+  uint64_t hash = UINT64_C(0xcbf29ce484222325);
+  for (size_t i = 0; i < len; ++i)
+  {
+    hash ^= (uint8_t) code[i];
+    hash *= UINT64_C(0x100000001b3);
+  }
+  hash ^= (uint64_t) (newline != 0);
+  hash *= UINT64_C(0x100000001b3);
+  return hash;
+}
+
+static bcCacheEntry_t* volatile* bcCacheBucket(uint64_t hash)
+{
+  return (bcCacheEntry_t* volatile*) &bcCache.buckets[hash & (BC_CACHE_BUCKETS - 1)];
+}
+
+static int bcCacheMatch(const bcCacheEntry_t* entry, uint64_t hash, const char* code, size_t len, int newline)
+{
+  return (entry->hash == hash)
+    && (entry->newline == newline)
+    && (entry->sourceLen == len)
+    && (memcmp(entry->source, code, len) == 0);
+}
+
+static bcCacheStripe_t* bcCacheStripe(void)
+{
+  if (bcCacheStripeIndex < 0)
+  {
+    bcCacheStripeIndex = (int32_t) ((uint32_t) bcAtomicAdd32(&bcCache.nextStripe, 1) % BC_CACHE_STRIPES);
+  }
+  return &bcCache.stripes[bcCacheStripeIndex];
+}
+
+static volatile int32_t* bcCacheReadBegin(bcCacheStripe_t* stripe)
+{
+  volatile int32_t* readers = &stripe->counters.readers[bcAtomicLoad64(&bcCache.epoch) & 1];
+  bcAtomicAdd32(readers, 1);
+  return readers;
+}
+
+static void bcCacheReadEnd(volatile int32_t* readers)
+{
+  bcAtomicAdd32(readers, -1);
+}
+
+/**
+ * Wait until every reader, which entered chains before call, leaves them.
+ *
+ * Epoch is flipped twice, because reader could take epoch before first flip,
+ * but count itself after it.
+ */
+static void bcCacheSynchronize(void)
+{
+  bcMutexLock(&bcCache.syncLock);
+  for (int i = 0; i < 2; ++i)
+  {
+    uint64_t epoch = bcAtomicAdd64(&bcCache.epoch, 1) - 1;
+    for (int j = 0; j < BC_CACHE_STRIPES; ++j)
+    {
+      while (bcAtomicLoad32(&bcCache.stripes[j].counters.readers[epoch & 1]) != 0)
+      {
+        bcThreadYield();
+      }
+    }
+  }
+  bcMutexUnlock(&bcCache.syncLock);
+}
+
+static void bcCacheEntryDelete(bcCacheEntry_t* entry)
+{
+  bcCodeStreamCleanup(&entry->code);
+  free(entry);
+}
+
+/**
+ * Put new entry into chain and CLOCK ring, lock must be held.
+ *
+ * Entry is put right behind hand, so it is checked last.
+ */
+static void bcCacheLink(bcCacheEntry_t* entry)
+{
+  if (bcCache.hand == NULL)
+  {
+    entry->clockPrev = entry;
+    entry->clockNext = entry;
+    bcCache.hand = entry;
+  }
+  else
+  {
+    entry->clockNext = bcCache.hand;
+    entry->clockPrev = bcCache.hand->clockPrev;
+    entry->clockPrev->clockNext = entry;
+    bcCache.hand->clockPrev = entry;
+  }
+
+  bcCacheEntry_t* volatile* bucket = bcCacheBucket(entry->hash);
+  entry->next = *bucket;
+  bcAtomicStorePtr((void* volatile*) bucket, entry);
+
+  bcAtomicStore64(&bcCache.size, bcCache.size + entry->size);
+  bcAtomicStore64(&bcCache.entries, bcCache.entries + 1);
+}
+
+/**
+ * Remove entry from chain and CLOCK ring, and put it in retired list, lock
+ * must be held.
+ */
+static void bcCacheRetire(bcCacheEntry_t* entry)
+{
+  bcCacheEntry_t* volatile* link = bcCacheBucket(entry->hash);
+  while (*link != entry)
+  {
+    link = &(*link)->next;
+  }
+  // entry->next is left intact, readers still can walk through it
+  bcAtomicStorePtr((void* volatile*) link, entry->next);
+
+  if (entry->clockNext == entry)
+  {
+    bcCache.hand = NULL;
+  }
+  else
+  {
+    entry->clockPrev->clockNext = entry->clockNext;
+    entry->clockNext->clockPrev = entry->clockPrev;
+    if (bcCache.hand == entry)
+    {
+      bcCache.hand = entry->clockNext;
+    }
+  }
+
+  entry->clockNext = bcCache.retired;
+  bcCache.retired = entry;
+  ++bcCache.retiredSize;
+
+  bcAtomicStore64(&bcCache.size, bcCache.size - entry->size);
+  bcAtomicStore64(&bcCache.entries, bcCache.entries - 1);
+  bcAtomicAdd64(&bcCache.evictions, 1);
+}
+
+/**
+ * Retire entries, until cache fits in given size, lock must be held.
+ *
+ * Hand clears reference marks on its way, so it makes at most two turns.
+ */
+static void bcCacheEvict(uint64_t size)
+{
+  while ((bcCache.size > size) && (bcCache.hand != NULL))
+  {
+    bcCacheEntry_t* entry = bcCache.hand;
+    if ((size != 0) && (bcAtomicLoadRelaxed32(&entry->referenced) != 0))
+    {
+      bcAtomicStoreRelaxed32(&entry->referenced, 0);
+      bcCache.hand = entry->clockNext;
+      continue;
+    }
+    bcCacheRetire(entry);
+  }
+}
+
+/**
+ * Take retired entries, lock must be held.
+ *
+ * @param[in] all when 0, list is taken only if it holds whole batch
+ *
+ * @return list of entries, which must be passed to bcCacheDrop
+ */
+static bcCacheEntry_t* bcCacheTakeRetired(int all)
+{
+  if ((all == 0) && (bcCache.retiredSize < BC_CACHE_RETIRE_BATCH))
+  {
+    return NULL;
+  }
+
+  bcCacheEntry_t* retired = bcCache.retired;
+  bcCache.retired = NULL;
+  bcCache.retiredSize = 0;
+  return retired;
+}
+
+/**
+ * Release retired entries, when no reader can see them.
+ *
+ * Must be called without lock held.
+ */
+static void bcCacheDrop(bcCacheEntry_t* retired)
+{
+  if (retired == NULL)
+  {
+    return;
+  }
+
+  bcCacheSynchronize();
+
+  while (retired != NULL)
+  {
+    bcCacheEntry_t* next = retired->clockNext;
+    bcCacheRelease(retired);
+    retired = next;
+  }
+}
+
+bcCacheEntry_t* bcCacheAcquire(const char* code, int newline)
+{
+  if (bcAtomicLoad64(&bcCache.limit) == 0)
+  {
+    return NULL;
+  }
+
+  size_t len = strlen(code);
+  uint64_t hash = bcCacheHash(code, len, newline);
+
+  bcCacheStripe_t* stripe = bcCacheStripe();
+  volatile int32_t* readers = bcCacheReadBegin(stripe);
+
+  bcCacheEntry_t* entry = bcAtomicLoadPtr((void* volatile*) bcCacheBucket(hash));
+  while (entry != NULL)
+  {
+    if (bcCacheMatch(entry, hash, code, len, newline))
+    {
+      bcAtomicAdd32(&entry->refCount, 1);
+
+      if (bcAtomicLoadRelaxed32(&entry->referenced) == 0)
+      { // don't write shared cache line on every hit
+        bcAtomicStoreRelaxed32(&entry->referenced, 1);
+      }
+      break;
+    }
+    entry = bcAtomicLoadPtr((void* volatile*) &entry->next);
+  }
+
+  bcCacheReadEnd(readers);
+
+  bcAtomicAddRelaxed64((entry != NULL) ? &stripe->counters.hits : &stripe->counters.misses, 1);
+  return entry;
+}
+
+bcCacheEntry_t* bcCacheInsert(const char* code, size_t consumed, int newline, int newlineAfter, bcCodeStream_t* codeStream)
+{
+  uint64_t limit = bcAtomicLoad64(&bcCache.limit);
+  if (limit == 0)
+  {
+    return NULL;
+  }
+
+  size_t len = strlen(code);
+  size_t size = sizeof(bcCacheEntry_t) + len + 1;
+  if (size > limit)
+  { // don't prepare code, which will never fit
+    return NULL;
+  }
+
+  size_t codeSize;
+  if (bcCodeStreamShare(codeStream, &codeSize) != BC_OK)
+  {
+    return NULL;
+  }
+
+  size += codeSize;
+  if (size > limit)
+  {
+    return NULL;
+  }
+
+  bcCacheEntry_t* entry = (bcCacheEntry_t*) malloc(sizeof(bcCacheEntry_t) + len + 1);
+  if (entry == NULL)
+  {
+    return NULL;
+  }
+
+  entry->hash = bcCacheHash(code, len, newline);
+  entry->referenced = 0;
+  entry->refCount = 2; // cache and caller
+  entry->newline = newline;
+  entry->newlineAfter = newlineAfter;
+  entry->consumed = consumed;
+  entry->size = size;
+  entry->code = *codeStream;
+  entry->sourceLen = len;
+  memcpy(entry->source, code, len + 1);
+
+  memset(codeStream, 0, sizeof(bcCodeStream_t));
+
+  bcCacheEntry_t* volatile* bucket = bcCacheBucket(entry->hash);
+
+  bcMutexLock(&bcCache.lock);
+
+  for (bcCacheEntry_t* other = *bucket; other != NULL; other = other->next)
+  {
+    if (bcCacheMatch(other, entry->hash, code, len, newline))
+    { // inserted by other thread meanwhile
+      bcAtomicAdd32(&other->refCount, 1);
+      bcMutexUnlock(&bcCache.lock);
+      bcCacheEntryDelete(entry);
+      return other;
+    }
+  }
+
+  if (size > bcCache.limit)
+  { // limit was lowered meanwhile, give code stream back
+    bcMutexUnlock(&bcCache.lock);
+    *codeStream = entry->code;
+    free(entry);
+    return NULL;
+  }
+
+  bcCacheEvict(bcCache.limit - size);
+  bcCacheLink(entry);
+  bcCacheEntry_t* retired = bcCacheTakeRetired(0);
+
+  bcMutexUnlock(&bcCache.lock);
+
+  bcCacheDrop(retired);
+  return entry;
+}
+
+void bcCacheRelease(bcCacheEntry_t* entry)
+{
+  if ((entry != NULL) && (bcAtomicAdd32(&entry->refCount, -1) == 0))
+  {
+    bcCacheEntryDelete(entry);
+  }
+}
+
+BCAPI bcStatus_t bcCacheSetLimit(size_t limit)
+{
+  bcMutexLock(&bcCache.lock);
+  bcAtomicStore64(&bcCache.limit, (uint64_t) limit);
+  bcCacheEvict((uint64_t) limit);
+  bcCacheEntry_t* retired = bcCacheTakeRetired(1);
+  bcMutexUnlock(&bcCache.lock);
+
+  bcCacheDrop(retired);
+  return BC_OK;
+}
+
+BCAPI void bcCacheClear(void)
+{
+  bcMutexLock(&bcCache.lock);
+  bcCacheEvict(0);
+  bcCacheEntry_t* retired = bcCacheTakeRetired(1);
+  bcMutexUnlock(&bcCache.lock);
+
+  bcCacheDrop(retired);
+}
+
+BCAPI bcStatus_t bcCacheStatistics(bcCacheStats_t* pStats)
+{
+  if (pStats == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  pStats->hits = 0;
+  pStats->misses = 0;
+  for (int i = 0; i < BC_CACHE_STRIPES; ++i)
+  {
+    pStats->hits += bcAtomicLoadRelaxed64(&bcCache.stripes[i].counters.hits);
+    pStats->misses += bcAtomicLoadRelaxed64(&bcCache.stripes[i].counters.misses);
+  }
+  pStats->evictions = bcAtomicLoad64(&bcCache.evictions);
+  pStats->entries = (size_t) bcAtomicLoad64(&bcCache.entries);
+  pStats->size = (size_t) bcAtomicLoad64(&bcCache.size);
+  pStats->limit = (size_t) bcAtomicLoad64(&bcCache.limit);
+  return BC_OK;
+}
@@ -0,0 +1,259 @@
+/**
+ * Bounded channels between cores.
+ *
+ * Channel is ring of values protected by lock, so any number of threads
+ * send and receive. Values are never copied. Integer, number or string,
+ * which has no other references, is moved to receiver as is. Other values
+ * are shared first, so sender and receiver update their counters
+ * atomically.
+ *
+ * Scripts use channels through native functions, which are defined by
+ * bcCoreBindChannel and keep channel alive, while host or any of them
+ * refers to it.
+ */
+#include <bcPrivate.h>
+#include <bcSync.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+struct bcChannel_t
+{
+  int32_t refCount;   /**< Host and function references, updated atomically */
+  bcMutex_t lock;
+  bcCond_t notEmpty;  /**< Signaled when value is sent or channel is closed */
+  bcCond_t notFull;   /**< Signaled when value is received or channel is closed */
+  size_t cap;         /**< Ring capacity */
+  size_t head;        /**< Index of oldest value */
+  size_t size;        /**< Values in ring */
+  int closed;         /**< Not 0 after bcChannelClose */
+  BC_VALUE values[];  /**< Ring of sent values */
+};
+
+/**
+ * Function, which sends to or receives from channel.
+ */
+typedef struct bcChannelFunc_t
+{
+  bcFunc_t func;
+  BC_CHANNEL channel;
+} bcChannelFunc_t;
+
+BCAPI bcStatus_t bcChannelNew(size_t capacity, BC_CHANNEL* pChannel)
+{
+  if ((capacity == 0) || (capacity > (SIZE_MAX - sizeof(struct bcChannel_t)) / sizeof(BC_VALUE)) || (pChannel == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  BC_CHANNEL channel = (BC_CHANNEL) malloc(sizeof(struct bcChannel_t) + capacity * sizeof(BC_VALUE));
+  if (channel == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  channel->refCount = 1;
+  bcMutexInit(&channel->lock);
+  bcCondInit(&channel->notEmpty);
+  bcCondInit(&channel->notFull);
+  channel->cap = capacity;
+  channel->head = 0;
+  channel->size = 0;
+  channel->closed = 0;
+
+  *pChannel = channel;
+  return BC_OK;
+}
+
+/**
+ * Drop reference, and free channel on last one.
+ */
+static void bcChannelRelease(BC_CHANNEL channel)
+{
+  if (bcAtomicAdd32(&channel->refCount, -1) == 0)
+  {
+    for (size_t i = 0; i < channel->size; ++i)
+    {
+      bcValueCleanup(channel->values[(channel->head + i) % channel->cap]);
+    }
+
+    bcCondDestroy(&channel->notFull);
+    bcCondDestroy(&channel->notEmpty);
+    bcMutexDestroy(&channel->lock);
+    free(channel);
+  }
+}
+
+BCAPI void bcChannelDelete(BC_CHANNEL channel)
+{
+  if (channel != NULL)
+  {
+    bcChannelRelease(channel);
+  }
+}
+
+BCAPI void bcChannelClose(BC_CHANNEL channel)
+{
+  if (channel != NULL)
+  {
+    bcMutexLock(&channel->lock);
+    channel->closed = 1;
+    bcMutexUnlock(&channel->lock);
+
+    bcCondBroadcast(&channel->notEmpty);
+    bcCondBroadcast(&channel->notFull);
+  }
+}
+
+BCAPI bcStatus_t bcChannelSend(BC_CHANNEL channel, BC_VALUE value)
+{
+  if ((channel == NULL) || (value == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  // nested values of functions and code can be referred by sender, so only
+  // plain values are moved
+  int moved = (value->refCount == 1)
+    && ((value->type == BC_INTEGER) || (value->type == BC_NUMBER) || (value->type == BC_STRING));
+  if (!moved)
+  {
+    size_t size;
+    bcStatus_t status = bcValueShareDeep(value, &size);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+  }
+
+  bcMutexLock(&channel->lock);
+  while ((channel->size == channel->cap) && !channel->closed)
+  {
+    bcCondWait(&channel->notFull, &channel->lock);
+  }
+
+  if (channel->closed)
+  {
+    bcMutexUnlock(&channel->lock);
+    return BC_CLOSED;
+  }
+
+  channel->values[(channel->head + channel->size) % channel->cap] = value;
+  ++channel->size;
+  bcMutexUnlock(&channel->lock);
+
+  bcCondSignal(&channel->notEmpty);
+  return BC_OK;
+}
+
+BCAPI bcStatus_t bcChannelReceive(BC_CHANNEL channel, BC_VALUE* pValue)
+{
+  if ((channel == NULL) || (pValue == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcMutexLock(&channel->lock);
+  while ((channel->size == 0) && !channel->closed)
+  {
+    bcCondWait(&channel->notEmpty, &channel->lock);
+  }
+
+  if (channel->size == 0)
+  { // closed and drained
+    bcMutexUnlock(&channel->lock);
+    return BC_CLOSED;
+  }
+
+  *pValue = channel->values[channel->head];
+  channel->head = (channel->head + 1) % channel->cap;
+  --channel->size;
+  bcMutexUnlock(&channel->lock);
+
+  bcCondSignal(&channel->notFull);
+  return BC_OK;
+}
+
+/**
+ * Send argument, which is moved from frame, and return 1.
+ */
+static int bcChannelSendNative(BC_CORE core, BC_VALUE* base)
+{
+  const bcChannelFunc_t* endpoint = (const bcChannelFunc_t*) base[-1];
+  bcStatus_t status = bcChannelSend(endpoint->channel, base[0]);
+  if (status != BC_OK)
+  {
+    return (int) status;
+  }
+
+  base[0] = NULL;
+  return (int) bcCorePushInteger(core, 1);
+}
+
+/**
+ * Return received value.
+ */
+static int bcChannelReceiveNative(BC_CORE core, BC_VALUE* base)
+{
+  const bcChannelFunc_t* endpoint = (const bcChannelFunc_t*) base[-1];
+  BC_VALUE value;
+  bcStatus_t status = bcChannelReceive(endpoint->channel, &value);
+  if (status != BC_OK)
+  {
+    return (int) status;
+  }
+
+  status = bcValueStackPush(&core->stack, value);
+  bcValueCleanup(value);
+  return (int) status;
+}
+
+static void bcChannelFinalize(bcFunc_t* func)
+{
+  bcChannelRelease(((bcChannelFunc_t*) func)->channel);
+}
+
+/**
+ * Define native function of channel.
+ */
+static bcStatus_t bcChannelBind(BC_CORE core, const char* name, BC_CHANNEL channel, size_t argCount, int (*native)(BC_CORE core, BC_VALUE* base))
+{
+  bcChannelFunc_t* endpoint = (bcChannelFunc_t*) malloc(sizeof(bcChannelFunc_t));
+  if (endpoint == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  endpoint->func.head.type = BC_FUNC;
+  endpoint->func.head.refCount = 1;
+  endpoint->func.argCount = argCount;
+  endpoint->func.slotCount = argCount;
+  memset(&endpoint->func.code, 0, sizeof(endpoint->func.code));
+  endpoint->func.native = native;
+  endpoint->func.finalize = bcChannelFinalize;
+  endpoint->channel = channel;
+  bcAtomicAdd32(&channel->refCount, 1);
+
+  bcStatus_t status = bcCoreSetGlobal(core, name, (BC_VALUE) endpoint);
+  bcValueCleanup((BC_VALUE) endpoint);
+  return status;
+}
+
+BCAPI bcStatus_t bcCoreBindChannel(BC_CORE core, const char* send, const char* receive, BC_CHANNEL channel)
+{
+  if ((core == NULL) || (channel == NULL) || ((send == NULL) && (receive == NULL)))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcStatus_t status = BC_OK;
+  if (send != NULL)
+  {
+    status = bcChannelBind(core, send, channel, 1, bcChannelSendNative);
+  }
+  if ((status == BC_OK) && (receive != NULL))
+  {
+    status = bcChannelBind(core, receive, channel, 0, bcChannelReceiveNative);
+  }
+  return status;
+}
@@ -0,0 +1,70 @@
+#include <bcPrivate.h>
+
+#include <stdlib.h>
+
+bcStatus_t bcFrameStackInit(bcFrameStack_t* pStack, size_t total)
+{
+  if ((pStack == NULL) || (total == 0))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcFrame_t* frames = (bcFrame_t*) calloc(total, sizeof(bcFrame_t));
+  if (frames == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  pStack->bottom = frames;
+  pStack->top = frames;
+  pStack->total = total;
+  return BC_OK;
+}
+
+bcStatus_t bcFrameStackCleanup(bcFrameStack_t* pStack)
+{
+  if (pStack == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  free(pStack->bottom);
+
+  pStack->bottom = NULL;
+  pStack->top = NULL;
+  pStack->total = 0;
+  return BC_OK;
+}
+
+bcStatus_t bcFrameStackPush(bcFrameStack_t* pStack, const bcFrame_t* frame)
+{
+  if ((pStack == NULL) || (frame == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  if ((size_t)(pStack->top-pStack->bottom) >= pStack->total)
+  {
+    return BC_OVERFLOW;
+  }
+
+  *pStack->top = *frame;
+  ++pStack->top;
+  return BC_OK;
+}
+
+bcStatus_t bcFrameStackPop(bcFrameStack_t* pStack)
+{
+  if (pStack == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  if (pStack->top == pStack->bottom)
+  {
+    return BC_UNDERFLOW;
+  }
+
+  --pStack->top;
+  return BC_OK;
+}
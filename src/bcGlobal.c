@@ -1,14 +1,201 @@
 #include <bcPrivate.h>
+#include <bcSync.h>
 
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
 
-static int bcCompareGlobals(const void* a,const void* b)
+//
+// Globals are kept in array in order of definition, so BC_GLOBAL entries
+// never move and are updated in place. Names are found by open addressing
+// hash table of array indices + 1, 0 marks empty slot.
+//
+// Compiled code refers to globals by slots of core. Core numbers names,
+// which its code loads and stores, and keeps global of every slot once it
+// is found. Code stream caches slot of every name constant with tag of 
+// core, which filled the entry, so access from the same core takes no name
+// lookup, and access from other core finds its own slot by name. Slots live
+// as long as core, so they grow with names used by core only.
+//
+// Frozen environment keeps globals the same way, but never changes them.
+// Slots of core refer to environment globals, where core has no own 
+// variables. Writes to frozen global define own variable of core instead.
+//
+
+static uint64_t bcCoreSlotTags = 0;
+
+static uint64_t bcGlobalHash(const char* name)
+{ // FNV-1a
+  uint64_t hash = UINT64_C(0xcbf29ce484222325);
+  for (; *name != '\0'; ++name)
+  {
+    hash ^= (uint8_t) *name;
+    hash *= UINT64_C(0x100000001b3);
+  }
+  return hash;
+}
+
+uint64_t bcCoreSlotTag(void)
+{
+  uint64_t tag;
+  do
+  {
+    tag = bcAtomicAdd64(&bcCoreSlotTags, 1) & (UINT64_MAX >> BC_GLOBAL_SLOT_BITS);
+  } while (tag == 0);
+  return tag;
+}
+
+static void bcCoreSlotIndex(BC_CORE core, uint32_t slot)
+{
+  size_t mask = core->slotTableSize - 1;
+  size_t entry = (size_t) core->slots[slot].hash & mask;
+  while (core->slotTable[entry] != 0)
+  {
+    entry = (entry + 1) & mask;
+  }
+  core->slotTable[entry] = slot + 1;
+}
+
+/**
+ * Find slot of name in core.
+ * 
+ * @return slot + 1, or 0 if name has no slot
+ */
+static uint32_t bcCoreSlotFind(BC_CORE core, const char* name, uint64_t hash)
+{
+  if (core->slotTableSize == 0)
+  {
+    return 0;
+  }
+
+  size_t mask = core->slotTableSize - 1;
+  for (size_t entry = (size_t) hash & mask; core->slotTable[entry] != 0; entry = (entry + 1) & mask)
+  {
+    const bcGlobalSlot_t* slot = &core->slots[core->slotTable[entry] - 1];
+    if ((slot->hash == hash) && (strcmp(slot->name, name) == 0))
+    {
+      return core->slotTable[entry];
+    }
+  }
+  return 0;
+}
+
+/**
+ * Add new name to slots of core.
+ */
+static bcStatus_t bcCoreSlotAdd(BC_CORE core, const char* name, uint64_t hash, uint32_t* pSlot)
+{
+  if (core->slotSize == UINT32_MAX - 1)
+  {
+    return BC_OVERFLOW;
+  }
+
+  if (core->slotSize == core->slotCap)
+  {
+    uint32_t cap = (core->slotCap == 0)? BC_CORE_GLOBAL_TABLE_INITIAL_SIZE : core->slotCap*2;
+    bcGlobalSlot_t* slots = (bcGlobalSlot_t*) realloc(core->slots, cap*sizeof(bcGlobalSlot_t));
+    if (slots == NULL)
+    {
+      return BC_NO_MEMORY;
+    }
+    core->slots = slots;
+    core->slotCap = cap;
+  }
+
+  if ((size_t) (core->slotSize + 1)*2 > core->slotTableSize)
+  {
+    size_t tableSize = (core->slotTableSize == 0)? BC_CORE_GLOBAL_TABLE_INITIAL_SIZE : core->slotTableSize*2;
+    uint32_t* table = (uint32_t*) calloc(tableSize, sizeof(uint32_t));
+    if (table == NULL)
+    {
+      return BC_NO_MEMORY;
+    }
+
+    free(core->slotTable);
+    core->slotTable = table;
+    core->slotTableSize = tableSize;
+    for (uint32_t i = 0; i < core->slotSize; ++i)
+    {
+      bcCoreSlotIndex(core, i);
+    }
+  }
+
+  size_t nameLen = strlen(name) + 1;
+  char* copy = (char*) malloc(nameLen);
+  if (copy == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+  memcpy(copy, name, nameLen);
+
+  uint32_t slot = core->slotSize++;
+  core->slots[slot].hash = hash;
+  core->slots[slot].name = copy;
+  core->slots[slot].global = NULL;
+  bcCoreSlotIndex(core, slot);
+
+  *pSlot = slot;
+  return BC_OK;
+}
+
+bcStatus_t bcCoreGlobalSlot(BC_CORE core, const bcCodeStream_t* cs, uint8_t conID, uint32_t* pSlot)
 {
-  const BC_GLOBAL* aVal = (const BC_GLOBAL*)a;
-  const BC_GLOBAL* bVal = (const BC_GLOBAL*)b;
-  return strcmp((*aVal)->name, (*bVal)->name);
+  if (conID < cs->slotSize)
+  {
+    uint64_t cached = bcAtomicLoadRelaxed64(&cs->slots[conID]);
+    if ((cached >> BC_GLOBAL_SLOT_BITS) == core->slotTag)
+    {
+      *pSlot = (uint32_t) (cached & BC_GLOBAL_SLOT_MASK);
+      return BC_OK;
+    }
+  }
+
+  BC_VALUE name;
+  bcStatus_t status = bcCodeStreamConstant(cs, conID, &name);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  if (name->type != BC_STRING)
+  {
+    return BC_INVALID_ID;
+  }
+
+  const char* data = ((const bcString_t*) name)->data;
+  uint64_t hash = bcGlobalHash(data);
+  uint32_t found = bcCoreSlotFind(core, data, hash);
+  if (found != 0)
+  {
+    *pSlot = found - 1;
+  }
+  else
+  {
+    status = bcCoreSlotAdd(core, data, hash, pSlot);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+  }
+
+  // entry is one word, so threads sharing code stream never see it torn
+  if ((conID < cs->slotSize) && (*pSlot <= BC_GLOBAL_SLOT_MASK))
+  {
+    bcAtomicStoreRelaxed64(&cs->slots[conID], (core->slotTag << BC_GLOBAL_SLOT_BITS) | *pSlot);
+  }
+  return BC_OK;
+}
+
+static BC_GLOBAL bcCoreFindGlobalHash(BC_CORE core, const char* name, uint64_t hash);
+
+BC_GLOBAL bcCoreSlotGlobal(BC_CORE core, uint32_t slot)
+{
+  bcGlobalSlot_t* entry = &core->slots[slot];
+  if (entry->global == NULL)
+  { // undefined name is looked up again, until it is defined
+    entry->global = bcCoreFindGlobalHash(core, entry->name, entry->hash);
+  }
+  return entry->global;
 }
 
 BC_GLOBAL bcGlobalNew(const char* name, const BC_VALUE value)
@@ -24,41 +211,304 @@ BC_GLOBAL bcGlobalNew(const char* name, const BC_VALUE value)
   }
 
   result->value = bcValueCopy(value);
+  result->bind = BC_BIND_NONE;
+  result->frozen = 0;
+  result->hash = bcGlobalHash(name);
   memcpy(result->name, name, nameLen);
   return result;
 }
 
+/**
+ * Release value or image of global.
+ */
+static void bcGlobalDrop(BC_GLOBAL global)
+{
+  if (global->value != NULL)
+  {
+    bcValueCleanup(global->value);
+    global->value = NULL;
+  }
+
+  if (global->bind == BC_BIND_IMAGE)
+  {
+    bcImageRelease(global->as.image.image);
+  }
+  global->bind = BC_BIND_NONE;
+}
+
 void bcGlobalDelete(BC_GLOBAL global)
 {
   if(global != NULL)
   {
-    bcValueCleanup(global->value);
+    bcGlobalDrop(global);
     free(global);
   }
 }
 
-bcStatus_t bcCoreSetGlobal(BC_CORE core, const char* name, const BC_VALUE value)
+/**
+ * Get box of global bound to host integer or number, refreshed from storage.
+ * 
+ * Global keeps its box and refreshes it in place, when nobody else holds it,
+ * so repeated reads don't allocate.
+ */
+static BC_VALUE bcGlobalBox(BC_GLOBAL global)
+{
+  BC_VALUE box = global->value;
+  if ((box == NULL) || (box->refCount != 1))
+  {
+    box = (global->bind == BC_BIND_INTEGER)
+      ? bcValueInteger(*global->as.integer)
+      : bcValueNumber(*global->as.number);
+    if (box == NULL)
+    {
+      return NULL;
+    }
+
+    if (global->value != NULL)
+    {
+      bcValueCleanup(global->value);
+    }
+    global->value = box;
+  }
+  else if (global->bind == BC_BIND_INTEGER)
+  {
+    ((bcInteger_t*) box)->data = *global->as.integer;
+  }
+  else
+  {
+    ((bcNumber_t*) box)->data = *global->as.number;
+  }
+  return bcValueCopy(box);
+}
+
+bcStatus_t bcGlobalLoad(const BC_GLOBAL global, BC_VALUE* pValue)
 {
-  BC_GLOBAL newGlobalVal = bcGlobalNew(name, value);
-  if (newGlobalVal == NULL)
+  BC_VALUE value = NULL;
+  switch (global->bind)
+  {
+  case BC_BIND_NONE:
+    value = bcValueCopy(global->value);
+    break;
+  case BC_BIND_INTEGER:
+  case BC_BIND_NUMBER:
+    value = bcGlobalBox(global);
+    break;
+  case BC_BIND_ACCESSORS:
+    {
+      bcStatus_t status = global->as.accessors.get(global->as.accessors.user, &value);
+      if (status != BC_OK)
+      {
+        return status;
+      }
+      break;
+    }
+  case BC_BIND_IMAGE:
+    {
+      bcStatus_t status = bcImageGlobalValue(global->as.image.image, global->as.image.offset, &value);
+      if (status != BC_OK)
+      {
+        return status;
+      }
+
+      // loaded value is kept by global
+      bcGlobalDrop(global);
+      global->value = bcValueCopy(value);
+      break;
+    }
+  }
+
+  if (value == NULL)
   {
     return BC_NO_MEMORY;
   }
+  *pValue = value;
+  return BC_OK;
+}
+
+bcStatus_t bcGlobalStore(BC_GLOBAL global, const BC_VALUE value)
+{
+  switch (global->bind)
+  {
+  case BC_BIND_NONE:
+    { // value can be old value itself
+      BC_VALUE oldValue = global->value;
+      global->value = bcValueCopy(value);
+      bcValueCleanup(oldValue);
+      return BC_OK;
+    }
+  case BC_BIND_INTEGER:
+    {
+      int64_t integer;
+      bcStatus_t status = bcValueAsInteger(value, &integer);
+      if (status == BC_OK)
+      {
+        *global->as.integer = integer;
+      }
+      return status;
+    }
+  case BC_BIND_NUMBER:
+    {
+      double number;
+      bcStatus_t status = bcValueAsNumber(value, &number);
+      if (status == BC_OK)
+      {
+        *global->as.number = number;
+      }
+      return status;
+    }
+  case BC_BIND_ACCESSORS:
+    if (global->as.accessors.set == NULL)
+    {
+      return BC_NOT_IMPLEMENTED;
+    }
+    return global->as.accessors.set(global->as.accessors.user, value);
+  case BC_BIND_IMAGE:
+    bcGlobalDrop(global);
+    global->value = bcValueCopy(value);
+    return BC_OK;
+  }
+  return BC_INVALID_ARG;
+}
+
+bcStatus_t bcCorePushGlobal(BC_CORE core, const BC_GLOBAL global)
+{
+  if (global->bind == BC_BIND_NONE)
+  {
+    return bcValueStackPush(&core->stack, global->value);
+  }
+
+  BC_VALUE value;
+  bcStatus_t status = bcGlobalLoad(global, &value);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  status = bcValueStackPush(&core->stack, value);
+  bcValueCleanup(value);
+  return status;
+}
+
+bcStatus_t bcCorePushStoreGlobal(BC_CORE core, const char* name)
+{
+  BC_VALUE value = bcStoreGet(core->store, name);
+  if (value == NULL)
+  {
+    return BC_NOT_DEFINED;
+  }
+  return bcValueStackPush(&core->stack, value);
+}
 
-  BC_GLOBAL* itemInArray = bsearch(&newGlobalVal, core->globals, core->globalSize, sizeof(BC_GLOBAL), bcCompareGlobals);
-  if (itemInArray != NULL)
+BCAPI bcStatus_t bcCoreSetStore(BC_CORE core, BC_STORE store)
+{
+  if (core == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  core->store = store;
+  return BC_OK;
+}
+
+/**
+ * Put global index into hash table, which has free slots.
+ */
+static void bcGlobalTableIndex(BC_GLOBAL* globals, size_t* table, size_t tableSize, size_t index)
+{
+  size_t mask = tableSize - 1;
+  size_t slot = (size_t) globals[index]->hash & mask;
+  while (table[slot] != 0)
+  {
+    slot = (slot + 1) & mask;
+  }
+  table[slot] = index + 1;
+}
+
+static BC_GLOBAL bcGlobalTableFind(BC_GLOBAL* globals, const size_t* table, size_t tableSize, const char* name, uint64_t hash)
+{
+  if (tableSize == 0)
+  {
+    return NULL;
+  }
+
+  size_t mask = tableSize - 1;
+  for (size_t slot = (size_t) hash & mask; table[slot] != 0; slot = (slot + 1) & mask)
+  {
+    BC_GLOBAL global = globals[table[slot] - 1];
+    if ((global->hash == hash) && (strcmp(global->name, name) == 0))
+    {
+      return global;
+    }
+  }
+  return NULL;
+}
+
+static void bcCoreGlobalIndex(BC_CORE core, size_t index)
+{
+  bcGlobalTableIndex(core->globals, core->globalTable, core->globalTableSize, index);
+}
+
+/**
+ * Grow hash table to keep at least half of slots free.
+ */
+static bcStatus_t bcCoreGlobalTableReserve(BC_CORE core, size_t size)
+{
+  if (size*2 <= core->globalTableSize)
   {
-    bcGlobalDelete(*itemInArray);
-    *itemInArray = newGlobalVal;
     return BC_OK;
   }
 
+  size_t tableSize = (core->globalTableSize == 0)? BC_CORE_GLOBAL_TABLE_INITIAL_SIZE : core->globalTableSize*2;
+  while (size*2 > tableSize)
+  {
+    tableSize *= 2;
+  }
+
+  size_t* table = (size_t*) calloc(tableSize, sizeof(size_t));
+  if (table == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  free(core->globalTable);
+  core->globalTable = table;
+  core->globalTableSize = tableSize;
+
+  for (size_t i = 0; i < core->globalSize; ++i)
+  {
+    bcCoreGlobalIndex(core, i);
+  }
+  return BC_OK;
+}
+
+static BC_GLOBAL bcCoreFindGlobalHash(BC_CORE core, const char* name, uint64_t hash)
+{
+  BC_GLOBAL global = bcGlobalTableFind(core->globals, core->globalTable, core->globalTableSize, name, hash);
+  for (BC_ENV env = core->env; (global == NULL) && (env != NULL); env = env->base)
+  {
+    global = bcGlobalTableFind(env->globals, env->globalTable, env->globalTableSize, name, hash);
+  }
+  return global;
+}
+
+BC_GLOBAL bcCoreFindGlobal(BC_CORE core, const char* name)
+{
+  return bcCoreFindGlobalHash(core, name, bcGlobalHash(name));
+}
+
+bcStatus_t bcCoreSetGlobal(BC_CORE core, const char* name, const BC_VALUE value)
+{
+  BC_GLOBAL global = bcCoreFindGlobal(core, name);
+  if ((global != NULL) && !global->frozen)
+  {
+    return bcGlobalStore(global, value);
+  }
+
   if (core->globalSize == core->globalCap)
   {
     BC_GLOBAL* newGlobals = (BC_GLOBAL*) calloc(core->globalCap*3/2, sizeof(BC_GLOBAL));
     if (newGlobals == NULL)
     {
-      bcGlobalDelete(newGlobalVal);
       return BC_NO_MEMORY;
     }
 
@@ -69,25 +519,346 @@ bcStatus_t bcCoreSetGlobal(BC_CORE core, const char* name, const BC_VALUE value)
     core->globalCap = core->globalCap*3/2;
   }
 
-  core->globals[core->globalSize++] = newGlobalVal;
-  qsort(core->globals, core->globalSize, sizeof(BC_GLOBAL), bcCompareGlobals);
+  bcStatus_t status = bcCoreGlobalTableReserve(core, core->globalSize + 1);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  global = bcGlobalNew(name, value);
+  if (global == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  core->globals[core->globalSize] = global;
+  bcCoreGlobalIndex(core, core->globalSize++);
+
+  // new variable hides frozen one in slot of its name
+  uint32_t slot = bcCoreSlotFind(core, global->name, global->hash);
+  if (slot != 0)
+  {
+    core->slots[slot - 1].global = global;
+  }
   return BC_OK;
 }
 
 BC_VALUE bcCoreGetGlobal(BC_CORE core, const char* name)
 {
-  BC_GLOBAL keyGlobal = bcGlobalNew(name, NULL);
-  if (keyGlobal == NULL)
+  BC_GLOBAL global = bcCoreFindGlobal(core, name);
+  if (global == NULL)
+  { // store values are static, so they aren't copied
+    return bcStoreGet(core->store, name);
+  }
+
+  BC_VALUE value;
+  if (bcGlobalLoad(global, &value) != BC_OK)
   {
     return NULL;
   }
+  return value;
+}
 
-  BC_GLOBAL* itemInArray = bsearch(&keyGlobal, core->globals, core->globalSize, sizeof(BC_GLOBAL), bcCompareGlobals);
-  if (itemInArray != NULL)
+/**
+ * Bind global variable, defining it if needed.
+ */
+static bcStatus_t bcCoreBind(BC_CORE core, const char* name, const bcGlobalVar_t* binding)
+{
+  if ((core == NULL) || (name == NULL))
   {
-    bcGlobalDelete(keyGlobal);
-    return bcValueCopy((*itemInArray)->value);
+    return BC_INVALID_ARG;
   }
-  bcGlobalDelete(keyGlobal);
-  return NULL;
+
+  BC_GLOBAL global = bcCoreFindGlobal(core, name);
+  if ((global == NULL) || global->frozen)
+  {
+    bcStatus_t status = bcCoreSetGlobal(core, name, NULL);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+    global = core->globals[core->globalSize - 1];
+  }
+
+  bcGlobalDrop(global);
+  global->bind = binding->bind;
+  global->as = binding->as;
+  return BC_OK;
+}
+
+bcStatus_t bcCoreBindImage(BC_CORE core, const char* name, bcImage_t* image, uint32_t offset)
+{
+  bcGlobalVar_t binding;
+  binding.bind = BC_BIND_IMAGE;
+  binding.as.image.image = image;
+  binding.as.image.offset = offset;
+
+  bcStatus_t status = bcCoreBind(core, name, &binding);
+  if (status == BC_OK)
+  {
+    bcImageRetain(image);
+  }
+  return status;
+}
+
+BCAPI bcStatus_t bcCoreBindInteger(BC_CORE core, const char* name, int64_t* storage)
+{
+  if (storage == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcGlobalVar_t binding;
+  binding.bind = BC_BIND_INTEGER;
+  binding.as.integer = storage;
+  return bcCoreBind(core, name, &binding);
+}
+
+BCAPI bcStatus_t bcCoreBindNumber(BC_CORE core, const char* name, double* storage)
+{
+  if (storage == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcGlobalVar_t binding;
+  binding.bind = BC_BIND_NUMBER;
+  binding.as.number = storage;
+  return bcCoreBind(core, name, &binding);
+}
+
+BCAPI bcStatus_t bcCoreBindAccessors(BC_CORE core, const char* name, bcGetter_t get, bcSetter_t set, void* user)
+{
+  if (get == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcGlobalVar_t binding;
+  binding.bind = BC_BIND_ACCESSORS;
+  binding.as.accessors.get = get;
+  binding.as.accessors.set = set;
+  binding.as.accessors.user = user;
+  return bcCoreBind(core, name, &binding);
+}
+
+BCAPI bcStatus_t bcCoreUnbind(BC_CORE core, const char* name)
+{
+  if ((core == NULL) || (name == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  BC_GLOBAL global = bcCoreFindGlobal(core, name);
+  if (global == NULL)
+  {
+    return BC_NOT_DEFINED;
+  }
+
+  if ((global->bind == BC_BIND_NONE) || (global->bind == BC_BIND_IMAGE))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  BC_VALUE value;
+  bcStatus_t status = bcGlobalLoad(global, &value);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  bcGlobalDrop(global);
+  global->value = value;
+  return BC_OK;
+}
+
+BCAPI void bcEnvDelete(BC_ENV env)
+{
+  while ((env != NULL) && (bcAtomicAdd32(&env->refCount, -1) == 0))
+  {
+    for (size_t i = 0; i < env->globalSize; ++i)
+    {
+      bcGlobalDelete(env->globals[i]);
+    }
+    free(env->globals);
+    free(env->globalTable);
+
+    BC_ENV base = env->base;
+    free(env);
+    env = base;
+  }
+}
+
+static BC_ENV bcEnvNew(size_t globalSize)
+{
+  BC_ENV env = (BC_ENV) malloc(sizeof(struct bcEnv_t));
+  if (env == NULL)
+  {
+    return NULL;
+  }
+
+  size_t tableSize = BC_CORE_GLOBAL_TABLE_INITIAL_SIZE;
+  while (globalSize*2 > tableSize)
+  {
+    tableSize *= 2;
+  }
+
+  env->refCount = 1;
+  env->base = NULL;
+  env->globalSize = 0;
+  env->globals = (BC_GLOBAL*) malloc((globalSize + 1)*sizeof(BC_GLOBAL));
+  env->globalTableSize = tableSize;
+  env->globalTable = (size_t*) calloc(tableSize, sizeof(size_t));
+  if ((env->globals == NULL) || (env->globalTable == NULL))
+  {
+    bcEnvDelete(env);
+    return NULL;
+  }
+  return env;
+}
+
+BCAPI bcStatus_t bcCoreFreeze(BC_CORE core, BC_ENV* pEnv)
+{
+  if ((core == NULL) || (pEnv == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  // values are shared first, so nothing is changed if it fails
+  size_t frozenSize = 0;
+  for (size_t i = 0; i < core->globalSize; ++i)
+  {
+    BC_GLOBAL global = core->globals[i];
+    if (global->bind == BC_BIND_IMAGE)
+    { // image is not shared, values are loaded now
+      BC_VALUE value;
+      bcStatus_t status = bcGlobalLoad(global, &value);
+      if (status != BC_OK)
+      {
+        return status;
+      }
+      bcValueCleanup(value);
+    }
+
+    if (global->bind != BC_BIND_NONE)
+    {
+      continue;
+    }
+
+    size_t valueSize;
+    bcStatus_t status = bcValueShareDeep(global->value, &valueSize);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+    ++frozenSize;
+  }
+
+  BC_ENV env = bcEnvNew(frozenSize);
+  if (env == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  size_t keptSize = 0;
+  for (size_t i = 0; i < core->globalSize; ++i)
+  {
+    BC_GLOBAL global = core->globals[i];
+    if (global->bind != BC_BIND_NONE)
+    { // host storage belongs to core
+      core->globals[keptSize++] = global;
+      continue;
+    }
+
+    global->frozen = 1;
+    env->globals[env->globalSize] = global;
+    bcGlobalTableIndex(env->globals, env->globalTable, env->globalTableSize, env->globalSize++);
+  }
+
+  core->globalSize = keptSize;
+  if (core->globalTableSize != 0)
+  {
+    memset(core->globalTable, 0, core->globalTableSize*sizeof(size_t));
+  }
+  for (size_t i = 0; i < keptSize; ++i)
+  {
+    bcCoreGlobalIndex(core, i);
+  }
+
+  // reference of core to base moves to new environment
+  env->base = core->env;
+  env->refCount = 2;
+  core->env = env;
+
+  *pEnv = env;
+  return BC_OK;
+}
+
+BCAPI bcStatus_t bcCoreSetEnv(BC_CORE core, BC_ENV env)
+{
+  if (core == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  // globals of new environment are found on next access
+  for (uint32_t slot = 0; slot < core->slotSize; ++slot)
+  {
+    BC_GLOBAL global = core->slots[slot].global;
+    if ((global != NULL) && global->frozen)
+    {
+      core->slots[slot].global = NULL;
+    }
+  }
+
+  if (env != NULL)
+  {
+    bcAtomicAdd32(&env->refCount, 1);
+  }
+
+  bcEnvDelete(core->env);
+  core->env = env;
+  return BC_OK;
+}
+
+bcStatus_t bcCoreForkGlobals(BC_CORE parent, BC_CORE child)
+{
+  // own variables of parent are frozen, so both cores share them and
+  // copy them on write
+  for (size_t i = 0; i < parent->globalSize; ++i)
+  {
+    bcGlobalBind_t bind = parent->globals[i]->bind;
+    if ((bind == BC_BIND_NONE) || (bind == BC_BIND_IMAGE))
+    {
+      BC_ENV env;
+      bcStatus_t status = bcCoreFreeze(parent, &env);
+      if (status != BC_OK)
+      {
+        return status;
+      }
+      bcEnvDelete(env);
+      break;
+    }
+  }
+
+  BC_ENV env = parent->env;
+  if (env == NULL)
+  {
+    return BC_OK;
+  }
+
+  bcAtomicAdd32(&env->refCount, 1);
+  child->env = env;
+
+  // variables bound to host storage are bound by child too
+  for (size_t i = 0; i < parent->globalSize; ++i)
+  {
+    BC_GLOBAL global = parent->globals[i];
+    bcStatus_t status = bcCoreBind(child, global->name, global);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+  }
+  return BC_OK;
 }
@@ -0,0 +1,951 @@
+/**
+ * Serialized compiled programs and cores.
+ *
+ * Image layout, all integers are little-endian:
+ *
+ *   header:   "BCIM", u32 version, u32 opcode count, u32 main stream offset,
+ *             u32 image size
+ *   globals:  u32 count, {u32 name offset, u32 value offset}[count]
+ *   stream:   u32 opcode count, u32 constant count,
+ *             u32 constant offsets[constant count], u8 opcodes[opcode count]
+ *   constant: u8 type, followed by
+ *             BC_INTEGER - i64 value
+ *             BC_NUMBER  - f64 value bits
+ *             BC_STRING  - u32 length with terminating zero, characters
+ *             BC_CODE    - u32 stream offset
+ *             BC_FUNC    - u32 argument count, u32 slot count, u32 stream offset
+ *
+ * Nested streams are always placed after stream, which refers to them.
+ *
+ * Loaded top-level code and if-statement bodies borrow opcodes from image,
+ * their constants are materialized on first use. Function bodies are copied
+ * from image, because functions outlive programs in core globals.
+ *
+ * Core image starts with "BCCI" and has globals table offset in place of
+ * main stream offset. Names are BC_STRING constants and values are constants
+ * of any type. Core keeps image mapped and materializes every global, when
+ * it is used first time.
+ */
+#include <bcPrivate.h>
+#include <bcSync.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Version of image format, bumped on every incompatible change.
+ */
+#define BC_IMAGE_VERSION (1)
+
+#define BC_IMAGE_HEADER_SIZE (20)
+
+/**
+ * Image being written.
+ */
+typedef struct bcImageWriter_t
+{
+  uint8_t* data;
+  size_t size;
+  size_t cap;
+} bcImageWriter_t;
+
+static uint32_t bcImageRead32(const uint8_t* data)
+{
+  return (uint32_t) data[0]
+    | ((uint32_t) data[1] << 8)
+    | ((uint32_t) data[2] << 16)
+    | ((uint32_t) data[3] << 24);
+}
+
+static uint64_t bcImageRead64(const uint8_t* data)
+{
+  return (uint64_t) bcImageRead32(data) | ((uint64_t) bcImageRead32(data + 4) << 32);
+}
+
+static void bcImageWrite32(uint8_t* data, uint32_t value)
+{
+  for (int i = 0; i < 4; ++i)
+  {
+    data[i] = (uint8_t) (value >> (8 * i));
+  }
+}
+
+static void bcImageWrite64(uint8_t* data, uint64_t value)
+{
+  bcImageWrite32(data, (uint32_t) value);
+  bcImageWrite32(data + 4, (uint32_t) (value >> 32));
+}
+
+/**
+ * Reserve space at the end of image.
+ *
+ * @return offset of reserved space
+ */
+static bcStatus_t bcImageReserve(bcImageWriter_t* writer, size_t size, uint32_t* pOffset)
+{
+  if (writer->size + size > UINT32_MAX)
+  {
+    return BC_OVERFLOW;
+  }
+
+  if (writer->size + size > writer->cap)
+  {
+    size_t cap = (writer->cap == 0) ? 4096 : writer->cap;
+    while (cap < writer->size + size)
+    {
+      cap *= 2;
+    }
+
+    uint8_t* data = (uint8_t*) realloc(writer->data, cap);
+    if (data == NULL)
+    {
+      return BC_NO_MEMORY;
+    }
+    writer->data = data;
+    writer->cap = cap;
+  }
+
+  *pOffset = (uint32_t) writer->size;
+  memset(writer->data + writer->size, 0, size);
+  writer->size += size;
+  return BC_OK;
+}
+
+static bcStatus_t bcImageWriteStream(bcImageWriter_t* writer, const bcCodeStream_t* cs, uint32_t* pOffset);
+
+/**
+ * Write BC_STRING constant.
+ *
+ * @param[in] len length with terminating zero
+ */
+static bcStatus_t bcImageWriteString(bcImageWriter_t* writer, const char* data, size_t len, uint32_t* pOffset)
+{
+  uint32_t offset;
+  bcStatus_t status = bcImageReserve(writer, 1 + 4 + len, &offset);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  writer->data[offset] = BC_STRING;
+  bcImageWrite32(writer->data + offset + 1, (uint32_t) len);
+  memcpy(writer->data + offset + 5, data, len);
+  *pOffset = offset;
+  return BC_OK;
+}
+
+static bcStatus_t bcImageWriteConstant(bcImageWriter_t* writer, BC_VALUE con, uint32_t* pOffset)
+{
+  bcStatus_t status;
+  uint32_t streamOffset;
+  uint32_t offset;
+
+  switch (con->type)
+  {
+  case BC_INTEGER:
+    status = bcImageReserve(writer, 1 + 8, &offset);
+    if (status == BC_OK)
+    {
+      bcImageWrite64(writer->data + offset + 1, (uint64_t) ((const bcInteger_t*) con)->data);
+    }
+    break;
+  case BC_NUMBER:
+    status = bcImageReserve(writer, 1 + 8, &offset);
+    if (status == BC_OK)
+    {
+      uint64_t bits;
+      memcpy(&bits, &((const bcNumber_t*) con)->data, sizeof(bits));
+      bcImageWrite64(writer->data + offset + 1, bits);
+    }
+    break;
+  case BC_STRING:
+    {
+      const bcString_t* str = (const bcString_t*) con;
+      status = bcImageWriteString(writer, str->data, str->len, &offset);
+    }
+    break;
+  case BC_CODE:
+    {
+      bcCode_t* code = (bcCode_t*) con;
+      status = bcCodeCompile(code);
+      if (status == BC_OK)
+      {
+        status = bcImageWriteStream(writer, &code->code, &streamOffset);
+      }
+      if (status == BC_OK)
+      {
+        status = bcImageReserve(writer, 1 + 4, &offset);
+      }
+      if (status == BC_OK)
+      {
+        bcImageWrite32(writer->data + offset + 1, streamOffset);
+      }
+    }
+    break;
+  case BC_FUNC:
+    {
+      const bcFunc_t* func = (const bcFunc_t*) con;
+      if (func->native != NULL)
+      {
+        return BC_NOT_IMPLEMENTED;
+      }
+
+      status = bcImageWriteStream(writer, &func->code, &streamOffset);
+      if (status == BC_OK)
+      {
+        status = bcImageReserve(writer, 1 + 12, &offset);
+      }
+      if (status == BC_OK)
+      {
+        bcImageWrite32(writer->data + offset + 1, (uint32_t) func->argCount);
+        bcImageWrite32(writer->data + offset + 5, (uint32_t) func->slotCount);
+        bcImageWrite32(writer->data + offset + 9, streamOffset);
+      }
+    }
+    break;
+  default:
+    return BC_NOT_IMPLEMENTED;
+  }
+
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  writer->data[offset] = (uint8_t) con->type;
+  *pOffset = offset;
+  return BC_OK;
+}
+
+static bcStatus_t bcImageWriteStream(bcImageWriter_t* writer, const bcCodeStream_t* cs, uint32_t* pOffset)
+{
+  uint32_t offset;
+  bcStatus_t status = bcImageReserve(writer, 8 + 4 * cs->conSize + cs->opSize, &offset);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  bcImageWrite32(writer->data + offset, (uint32_t) cs->opSize);
+  bcImageWrite32(writer->data + offset + 4, (uint32_t) cs->conSize);
+  memcpy(writer->data + offset + 8 + 4 * cs->conSize, cs->opcodes, cs->opSize);
+
+  for (size_t i = 0; i < cs->conSize; ++i)
+  {
+    BC_VALUE con;
+    status = bcCodeStreamConstant(cs, (uint8_t) i, &con);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+
+    uint32_t conOffset;
+    status = bcImageWriteConstant(writer, con, &conOffset);
+    if (status != BC_OK)
+    {
+      return status;
+    }
+
+    // writer data could be moved, so it is taken again
+    bcImageWrite32(writer->data + offset + 8 + 4 * i, conOffset);
+  }
+
+  *pOffset = offset;
+  return BC_OK;
+}
+
+/**
+ * Check that opcodes can be executed safely.
+ */
+static bcStatus_t bcImageCheckCode(const uint8_t* opcodes, uint32_t opSize, uint32_t conSize)
+{
+  if (opSize == 0)
+  {
+    return BC_MALFORMED_CODE;
+  }
+
+  uint8_t last = BC_HALT;
+  for (uint32_t i = 0; i < opSize; ++i)
+  {
+    last = opcodes[i];
+    if (last >= BC_OP_LAST)
+    {
+      return BC_MALFORMED_CODE;
+    }
+
+    if (bcOpcodeHasArg(last))
+    {
+      if (++i == opSize)
+      {
+        return BC_MALFORMED_CODE;
+      }
+
+      if (((last == BC_PSH) || (last == BC_IFS) || (last == BC_LDG) || (last == BC_STG)) && (opcodes[i] >= conSize))
+      {
+        return BC_MALFORMED_CODE;
+      }
+    }
+  }
+
+  return ((last == BC_HALT) || (last == BC_RTN)) ? BC_OK : BC_MALFORMED_CODE;
+}
+
+static bcStatus_t bcImageValue(const bcImage_t* image, uint32_t offset, uint32_t owner, int detached, BC_VALUE* pValue);
+
+/**
+ * Check string constant data.
+ *
+ * String values can contain NULs, so only terminating zero is checked.
+ *
+ * @param[in] data constant data after type
+ * @param[in] left image size after type
+ * @param[out] pLen pointer to store string length without terminating zero
+ *
+ * @return NUL-terminated characters, or NULL if string is malformed
+ */
+static const char* bcImageString(const uint8_t* data, size_t left, size_t* pLen)
+{
+  if (left < 4)
+  {
+    return NULL;
+  }
+
+  uint32_t len = bcImageRead32(data);
+  if ((len == 0) || (len > left - 4) || (data[4 + len - 1] != '\0'))
+  {
+    return NULL;
+  }
+  *pLen = (size_t) len - 1;
+  return (const char*) data + 4;
+}
+
+/**
+ * Attach code stream to image.
+ *
+ * @param[in] image loaded image
+ * @param[in] offset stream offset
+ * @param[in] owner offset of stream, which refers to this one, or 0
+ * @param[in] detached when not 0, opcodes are copied and all constants are materialized
+ * @param[out] cs code stream to initialize
+ */
+static bcStatus_t bcImageStream(const bcImage_t* image, uint32_t offset, uint32_t owner, int detached, bcCodeStream_t* cs)
+{
+  if ((offset <= owner) || ((size_t) offset + 8 > image->size))
+  { // backward references could make loops
+    return BC_MALFORMED_CODE;
+  }
+
+  uint32_t opSize = bcImageRead32(image->data + offset);
+  uint32_t conSize = bcImageRead32(image->data + offset + 4);
+  if ((conSize > UINT8_MAX + 1) || ((size_t) offset + 8 + 4 * (size_t) conSize + opSize > image->size))
+  {
+    return BC_MALFORMED_CODE;
+  }
+
+  const uint8_t* opcodes = image->data + offset + 8 + 4 * conSize;
+  bcStatus_t status = bcImageCheckCode(opcodes, opSize, conSize);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  memset(cs, 0, sizeof(bcCodeStream_t));
+
+  cs->cons = (BC_VALUE*) calloc((conSize == 0) ? 1 : conSize, sizeof(BC_VALUE));
+  if (cs->cons == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+  cs->conCap = conSize;
+  cs->conSize = conSize;
+
+  cs->slots = (uint64_t*) calloc((conSize == 0) ? 1 : conSize, sizeof(uint64_t));
+  if (cs->slots == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+  cs->slotSize = conSize;
+
+  if (detached == 0)
+  {
+    cs->opcodes = (uint8_t*) opcodes;
+    cs->opSize = opSize;
+    cs->opCap = opSize;
+    cs->image = image;
+    cs->imageOffset = offset;
+    return BC_OK;
+  }
+
+  cs->opcodes = (uint8_t*) malloc(opSize);
+  if (cs->opcodes == NULL)
+  {
+    bcCodeStreamCleanup(cs);
+    return BC_NO_MEMORY;
+  }
+  memcpy(cs->opcodes, opcodes, opSize);
+  cs->opSize = opSize;
+  cs->opCap = opSize;
+
+  for (uint32_t i = 0; i < conSize; ++i)
+  {
+    status = bcImageValue(image, bcImageRead32(image->data + offset + 8 + 4 * i), offset, 1, &cs->cons[i]);
+    if (status != BC_OK)
+    {
+      bcCodeStreamCleanup(cs);
+      return status;
+    }
+  }
+  return BC_OK;
+}
+
+/**
+ * Materialize constant.
+ *
+ * @param[in] image loaded image
+ * @param[in] offset constant offset
+ * @param[in] owner offset of stream, constant belongs to
+ * @param[in] detached when not 0, nested streams don't refer to image
+ * @param[out] pValue new value
+ */
+static bcStatus_t bcImageValue(const bcImage_t* image, uint32_t offset, uint32_t owner, int detached, BC_VALUE* pValue)
+{
+  if ((size_t) offset + 1 > image->size)
+  {
+    return BC_MALFORMED_CODE;
+  }
+
+  const uint8_t* data = image->data + offset + 1;
+  size_t left = image->size - offset - 1;
+
+  BC_VALUE value = NULL;
+  bcStatus_t status = BC_OK;
+
+  switch (image->data[offset])
+  {
+  case BC_INTEGER:
+    if (left < 8)
+    {
+      return BC_MALFORMED_CODE;
+    }
+    value = bcValueInteger((int64_t) bcImageRead64(data));
+    break;
+  case BC_NUMBER:
+    {
+      if (left < 8)
+      {
+        return BC_MALFORMED_CODE;
+      }
+      uint64_t bits = bcImageRead64(data);
+      double number;
+      memcpy(&number, &bits, sizeof(number));
+      value = bcValueNumber(number);
+    }
+    break;
+  case BC_STRING:
+    {
+      size_t len;
+      const char* str = bcImageString(data, left, &len);
+      if (str == NULL)
+      {
+        return BC_MALFORMED_CODE;
+      }
+      value = bcValueStringSlice(str, len);
+    }
+    break;
+  case BC_CODE:
+    {
+      if (left < 4)
+      {
+        return BC_MALFORMED_CODE;
+      }
+      bcCode_t* code = (bcCode_t*) malloc(sizeof(bcCode_t));
+      if (code == NULL)
+      {
+        return BC_NO_MEMORY;
+      }
+      status = bcImageStream(image, bcImageRead32(data), owner, detached, &code->code);
+      if (status != BC_OK)
+      {
+        free(code);
+        return status;
+      }
+      code->head.type = BC_CODE;
+      code->head.refCount = 1;
+      code->tree = NULL;
+      value = (BC_VALUE) code;
+    }
+    break;
+  case BC_FUNC:
+    {
+      if (left < 12)
+      {
+        return BC_MALFORMED_CODE;
+      }
+      bcFunc_t* func = (bcFunc_t*) malloc(sizeof(bcFunc_t));
+      if (func == NULL)
+      {
+        return BC_NO_MEMORY;
+      }
+      status = bcImageStream(image, bcImageRead32(data + 8), owner, 1, &func->code);
+      if (status != BC_OK)
+      {
+        free(func);
+        return status;
+      }
+      func->head.type = BC_FUNC;
+      func->head.refCount = 1;
+      func->argCount = bcImageRead32(data);
+      func->slotCount = bcImageRead32(data + 4);
+      func->native = NULL;
+      func->finalize = NULL;
+      if ((func->argCount > func->slotCount) || (func->slotCount > UINT8_MAX + 1))
+      {
+        bcValueCleanup((BC_VALUE) func);
+        return BC_MALFORMED_CODE;
+      }
+      value = (BC_VALUE) func;
+    }
+    break;
+  default:
+    return BC_MALFORMED_CODE;
+  }
+
+  if (value == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  *pValue = value;
+  return BC_OK;
+}
+
+bcStatus_t bcImageConstant(bcCodeStream_t* cs, uint8_t conID)
+{
+  if ((cs->image == NULL) || (conID >= cs->conSize))
+  {
+    return BC_CONST_NOT_FOUND;
+  }
+
+  uint32_t offset = bcImageRead32(cs->image->data + cs->imageOffset + 8 + 4 * conID);
+  return bcImageValue(cs->image, offset, cs->imageOffset, 0, &cs->cons[conID]);
+}
+
+bcStatus_t bcImageGlobalValue(const bcImage_t* image, uint32_t offset, BC_VALUE* pValue)
+{
+  if (offset < BC_IMAGE_HEADER_SIZE)
+  {
+    return BC_MALFORMED_CODE;
+  }
+  return bcImageValue(image, offset, 0, 1, pValue);
+}
+
+void bcImageRetain(bcImage_t* image)
+{
+  bcAtomicAdd32(&image->refCount, 1);
+}
+
+void bcImageRelease(bcImage_t* image)
+{
+  if ((image == NULL) || (bcAtomicAdd32(&image->refCount, -1) != 0))
+  {
+    return;
+  }
+
+#ifndef _WIN32
+  if (image->mapped)
+  {
+    munmap((void*) image->data, image->size);
+  }
+  else
+#endif
+  {
+    free((void*) image->data);
+  }
+  free(image);
+}
+
+/**
+ * Fill header and write image to file.
+ *
+ * @param[in] magic image kind
+ * @param[in] root main stream or globals table offset
+ */
+static bcStatus_t bcImageSave(bcImageWriter_t* writer, const char* magic, uint32_t root, const char* path)
+{
+  memcpy(writer->data, magic, 4);
+  bcImageWrite32(writer->data + 4, BC_IMAGE_VERSION);
+  bcImageWrite32(writer->data + 8, BC_OP_LAST);
+  bcImageWrite32(writer->data + 12, root);
+  bcImageWrite32(writer->data + 16, (uint32_t) writer->size);
+
+  FILE* output = fopen(path, "wb");
+  if (output == NULL)
+  {
+    return BC_IO_ERROR;
+  }
+
+  bcStatus_t status = BC_OK;
+  if (fwrite(writer->data, 1, writer->size, output) != writer->size)
+  {
+    status = BC_IO_ERROR;
+  }
+  if (fclose(output) != 0)
+  {
+    status = BC_IO_ERROR;
+  }
+  return status;
+}
+
+BCAPI bcStatus_t bcProgramSave(const BC_PROGRAM program, const char* path)
+{
+  if ((program == NULL) || (path == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcImageWriter_t writer = { NULL, 0, 0 };
+
+  uint32_t header;
+  uint32_t mainOffset = 0;
+  bcStatus_t status = bcImageReserve(&writer, BC_IMAGE_HEADER_SIZE, &header);
+  if (status == BC_OK)
+  {
+    status = bcImageWriteStream(&writer, &program->code, &mainOffset);
+  }
+
+  if (status == BC_OK)
+  {
+    status = bcImageSave(&writer, "BCIM", mainOffset, path);
+  }
+
+  free(writer.data);
+  return status;
+}
+
+/**
+ * Map or read whole file.
+ */
+static bcStatus_t bcImageOpen(const char* path, bcImage_t* image)
+{
+#ifndef _WIN32
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    return BC_IO_ERROR;
+  }
+
+  struct stat info;
+  if ((fstat(fd, &info) != 0) || (info.st_size < BC_IMAGE_HEADER_SIZE))
+  {
+    close(fd);
+    return BC_MALFORMED_CODE;
+  }
+
+  void* data = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED)
+  {
+    return BC_IO_ERROR;
+  }
+
+  image->data = (const uint8_t*) data;
+  image->size = (size_t) info.st_size;
+  image->mapped = 1;
+  return BC_OK;
+#else
+  FILE* input = fopen(path, "rb");
+  if (input == NULL)
+  {
+    return BC_IO_ERROR;
+  }
+
+  long size = -1;
+  if (fseek(input, 0, SEEK_END) == 0)
+  {
+    size = ftell(input);
+  }
+
+  if ((size < BC_IMAGE_HEADER_SIZE) || (fseek(input, 0, SEEK_SET) != 0))
+  {
+    fclose(input);
+    return BC_MALFORMED_CODE;
+  }
+
+  uint8_t* data = (uint8_t*) malloc((size_t) size);
+  if (data == NULL)
+  {
+    fclose(input);
+    return BC_NO_MEMORY;
+  }
+
+  if (fread(data, 1, (size_t) size, input) != (size_t) size)
+  {
+    free(data);
+    fclose(input);
+    return BC_IO_ERROR;
+  }
+  fclose(input);
+
+  image->data = data;
+  image->size = (size_t) size;
+  image->mapped = 0;
+  return BC_OK;
+#endif
+}
+
+/**
+ * Open image and check its header.
+ *
+ * @param[in] magic expected image kind
+ * @param[out] pImage loaded image with single reference
+ */
+static bcStatus_t bcImageLoad(const char* path, const char* magic, bcImage_t** pImage)
+{
+  bcImage_t* image = (bcImage_t*) malloc(sizeof(bcImage_t));
+  if (image == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  bcStatus_t status = bcImageOpen(path, image);
+  if (status != BC_OK)
+  {
+    free(image);
+    return status;
+  }
+  image->refCount = 1;
+
+  if ((memcmp(image->data, magic, 4) != 0)
+    || (bcImageRead32(image->data + 4) != BC_IMAGE_VERSION)
+    || (bcImageRead32(image->data + 8) != BC_OP_LAST)
+    || (bcImageRead32(image->data + 16) != image->size))
+  {
+    bcImageRelease(image);
+    return BC_MALFORMED_CODE;
+  }
+
+  *pImage = image;
+  return BC_OK;
+}
+
+BCAPI bcStatus_t bcProgramLoad(const char* path, BC_PROGRAM* pProgram)
+{
+  if ((path == NULL) || (pProgram == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcImage_t* image = NULL;
+  bcStatus_t status = bcImageLoad(path, "BCIM", &image);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  bcProgram_t* program = (bcProgram_t*) malloc(sizeof(bcProgram_t));
+  if (program == NULL)
+  {
+    bcImageRelease(image);
+    return BC_NO_MEMORY;
+  }
+
+  status = bcImageStream(image, bcImageRead32(image->data + 12), 0, 0, &program->code);
+  if (status != BC_OK)
+  {
+    free(program);
+    bcImageRelease(image);
+    return status;
+  }
+
+  program->image = image;
+  program->shared = 0;
+  *pProgram = program;
+  return BC_OK;
+}
+
+/**
+ * Check if global is saved to core image. Native functions belong to host,
+ * which registers them again.
+ */
+static int bcImageSaved(BC_VALUE value)
+{
+  return (value->type != BC_NATIVE)
+    && ((value->type != BC_FUNC) || (((const bcFunc_t*) value)->native == NULL));
+}
+
+BCAPI bcStatus_t bcCoreSave(const BC_CORE core, const char* path)
+{
+  if ((core == NULL) || (path == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  // visible globals are own ones and environment ones, which they don't hide
+  size_t total = core->globalSize;
+  for (BC_ENV env = core->env; env != NULL; env = env->base)
+  {
+    total += env->globalSize;
+  }
+
+  BC_GLOBAL* globals = (BC_GLOBAL*) malloc(((total == 0) ? 1 : total)*sizeof(BC_GLOBAL));
+  BC_VALUE* values = (BC_VALUE*) calloc((total == 0) ? 1 : total, sizeof(BC_VALUE));
+  if ((globals == NULL) || (values == NULL))
+  {
+    free(globals);
+    free(values);
+    return BC_NO_MEMORY;
+  }
+
+  size_t globalSize = 0;
+  for (size_t i = 0; i < core->globalSize; ++i)
+  {
+    globals[globalSize++] = core->globals[i];
+  }
+  for (BC_ENV env = core->env; env != NULL; env = env->base)
+  {
+    for (size_t i = 0; i < env->globalSize; ++i)
+    {
+      if (bcCoreFindGlobal(core, env->globals[i]->name) == env->globals[i])
+      {
+        globals[globalSize++] = env->globals[i];
+      }
+    }
+  }
+
+  // values are taken first, so accessors and image globals are loaded once
+  size_t count = 0;
+  bcStatus_t status = BC_OK;
+  for (size_t i = 0; (i < globalSize) && (status == BC_OK); ++i)
+  {
+    status = bcGlobalLoad(globals[i], &values[i]);
+    if ((status == BC_OK) && bcImageSaved(values[i]))
+    {
+      ++count;
+    }
+  }
+
+  bcImageWriter_t writer = { NULL, 0, 0 };
+  uint32_t header;
+  uint32_t table = 0;
+  if (status == BC_OK)
+  {
+    status = bcImageReserve(&writer, BC_IMAGE_HEADER_SIZE, &header);
+  }
+  if (status == BC_OK)
+  {
+    status = bcImageReserve(&writer, 4 + 8 * count, &table);
+  }
+
+  if (status == BC_OK)
+  {
+    bcImageWrite32(writer.data + table, (uint32_t) count);
+
+    uint32_t entry = table + 4;
+    for (size_t i = 0; (i < globalSize) && (status == BC_OK); ++i)
+    {
+      if ((values[i] == NULL) || !bcImageSaved(values[i]))
+      {
+        continue;
+      }
+
+      const char* name = globals[i]->name;
+      uint32_t nameOffset;
+      uint32_t valueOffset;
+      status = bcImageWriteString(&writer, name, strlen(name) + 1, &nameOffset);
+      if (status == BC_OK)
+      {
+        status = bcImageWriteConstant(&writer, values[i], &valueOffset);
+      }
+      if (status == BC_OK)
+      {
+        bcImageWrite32(writer.data + entry, nameOffset);
+        bcImageWrite32(writer.data + entry + 4, valueOffset);
+        entry += 8;
+      }
+    }
+  }
+
+  if (status == BC_OK)
+  {
+    status = bcImageSave(&writer, "BCCI", table, path);
+  }
+
+  for (size_t i = 0; i < globalSize; ++i)
+  {
+    if (values[i] != NULL)
+    {
+      bcValueCleanup(values[i]);
+    }
+  }
+  free(values);
+  free(globals);
+  free(writer.data);
+  return status;
+}
+
+BCAPI bcStatus_t bcCoreLoad(BC_CORE core, const char* path)
+{
+  if ((core == NULL) || (path == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcImage_t* image = NULL;
+  bcStatus_t status = bcImageLoad(path, "BCCI", &image);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  // whole table is checked first, so core is not changed by malformed image
+  uint32_t table = bcImageRead32(image->data + 12);
+  uint32_t count = 0;
+  if ((table < BC_IMAGE_HEADER_SIZE) || ((size_t) table + 4 > image->size))
+  {
+    status = BC_MALFORMED_CODE;
+  }
+  else
+  {
+    count = bcImageRead32(image->data + table);
+    if ((size_t) count > (image->size - table - 4) / 8)
+    {
+      status = BC_MALFORMED_CODE;
+    }
+  }
+
+  for (uint32_t i = 0; (i < count) && (status == BC_OK); ++i)
+  {
+    // names are used as C strings, so they can't contain NULs
+    uint32_t nameOffset = bcImageRead32(image->data + table + 4 + 8 * i);
+    uint32_t valueOffset = bcImageRead32(image->data + table + 8 + 8 * i);
+    size_t nameLen = 0;
+    const char* name = NULL;
+    if ((nameOffset >= BC_IMAGE_HEADER_SIZE) && (nameOffset < image->size) && (image->data[nameOffset] == BC_STRING))
+    {
+      name = bcImageString(image->data + nameOffset + 1, image->size - nameOffset - 1, &nameLen);
+    }
+    if ((name == NULL) || (strlen(name) != nameLen)
+      || (valueOffset < BC_IMAGE_HEADER_SIZE) || (valueOffset >= image->size))
+    {
+      status = BC_MALFORMED_CODE;
+    }
+  }
+
+  for (uint32_t i = 0; (i < count) && (status == BC_OK); ++i)
+  {
+    uint32_t nameOffset = bcImageRead32(image->data + table + 4 + 8 * i);
+    const char* name = (const char*) image->data + nameOffset + 5;
+    status = bcCoreBindImage(core, name, image, bcImageRead32(image->data + table + 8 + 8 * i));
+  }
+
+  bcImageRelease(image);
+  return status;
+}
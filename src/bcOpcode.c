@@ -407,8 +407,32 @@ const char* bcOpcodeString(uint8_t opcode)
   case BC_CLL: return "CLL"; /**< A() */
   case BC_LST: return "LST"; /**< toList(A) */
   case BC_DCT: return "DCT"; /**< toDict(A) */
+  case BC_LDL: return "LDL"; /**< push(local[A]) */
+  case BC_STL: return "STL"; /**< local[A] <- B */
+  case BC_TCL: return "TCL"; /**< Tail call A() */
+  case BC_RTN: return "RTN"; /**< Return from function */
+  case BC_LDG: return "LDG"; /**< push(global[A]) */
+  case BC_STG: return "STG"; /**< global[A] <- B */
   default:
     assert(0);
     return "???";
   }
 }
+
+int bcOpcodeHasArg(uint8_t opcode)
+{
+  switch (opcode)
+  {
+  case BC_PSH:
+  case BC_IFS:
+  case BC_LDL:
+  case BC_STL:
+  case BC_LDG:
+  case BC_STG:
+  case BC_CLL:
+  case BC_TCL:
+    return 1;
+  default:
+    return 0;
+  }
+}
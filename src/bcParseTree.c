@@ -4,75 +4,101 @@
 #include <stdlib.h>
 #include <assert.h>
 
-bcStatus_t bcTreeItemCleanup(bcTreeItem_t* treeItem)
+bcTreeArena_t* bcTreeArenaNew(void)
 {
-  if (treeItem == NULL)
+  bcTreeArena_t* result = (bcTreeArena_t*) malloc(sizeof(bcTreeArena_t));
+  if (result == NULL)
   {
-    return BC_INVALID_ARG;
+    return NULL;
+  }
+
+  result->items = (bcTreeItem_t*) calloc(BC_TREE_ARENA_INITIAL_CAP, sizeof(bcTreeItem_t));
+  if (result->items == NULL)
+  {
+    free(result);
+    return NULL;
+  }
+
+  result->refCount = 1;
+  result->size = 1; // first item is BC_TREE_NONE
+  result->cap = BC_TREE_ARENA_INITIAL_CAP;
+  result->valueSize = 0;
+  result->valueCap = 0;
+  result->values = NULL;
+  return result;
+}
+
+void bcTreeArenaRelease(bcTreeArena_t* arena)
+{
+  if ((arena == NULL) || (--arena->refCount > 0))
+  {
+    return;
+  }
+
+  for (uint32_t i = 0; i < arena->valueSize; ++i)
+  {
+    bcValueCleanup(arena->values[i]);
+  }
+  free(arena->values);
+  free(arena->items);
+  free(arena);
+}
+
+static bcTreeRef_t bcTreeArenaAlloc(bcTreeArena_t* arena, bcTreeItemType_t type)
+{
+  if (arena == NULL)
+  {
+    return BC_TREE_NONE;
   }
 
-  for (bcTreeItem_t* cursor = treeItem; cursor != NULL;)
+  if (arena->size == arena->cap)
   {
-    bcTreeItem_t* next = cursor->next; // stored, because later cursor is freed
-    switch (cursor->type)
+    if (arena->cap > UINT32_MAX/3*2)
+    {
+      return BC_TREE_NONE;
+    }
+
+    uint32_t cap = arena->cap*3/2;
+    bcTreeItem_t* items = (bcTreeItem_t*) realloc(arena->items, cap*sizeof(bcTreeItem_t));
+    if (items == NULL)
     {
-    case TIT_BIN_OP:
-      {
-        bcBinOp_t* binop = (bcBinOp_t*) cursor;
-        bcStatus_t status = bcTreeItemCleanup(binop->lbr);
-        if (status != BC_OK)
-        {
-          return status;
-        }
-        status = bcTreeItemCleanup(binop->rbr);
-        if (status != BC_OK)
-        {
-          return status;
-        }
-      }
-      break;
-    case TIT_UN_OP:
-      {
-        bcUnOp_t* unop = (bcUnOp_t*) cursor;
-        bcStatus_t status = bcTreeItemCleanup(unop->br);
-        if (status != BC_OK)
-        {
-          return status;
-        }
-      }
-      break;
-    case TIT_CONSTANT:
-      {
-        bcConstant_t* cns = (bcConstant_t*) cursor;
-        bcStatus_t status = bcValueCleanup(cns->constVal);
-        if (status != BC_OK)
-        {
-          return status;
-        }
-      }
-      break;
-    case TIT_IF_STATEMENT:
-      {
-        bcIfStatement_t* ifstate = (bcIfStatement_t*) cursor;
-        bcStatus_t status = bcTreeItemCleanup(ifstate->cond);
-        if (status != BC_OK)
-        {
-          return status;
-        }
-        status = bcTreeCleanup(ifstate->body);
-        if (status != BC_OK)
-        {
-          return status;
-        }
-      }
-      break;
-    default:
-      return BC_NOT_IMPLEMENTED;
+      return BC_TREE_NONE;
     }
-    free(cursor);
-    cursor = next;
+
+    arena->items = items;
+    arena->cap = cap;
   }
-  return BC_OK;
+
+  bcTreeRef_t ref = arena->size++;
+  bcTreeItem_t* item = &arena->items[ref];
+  item->type = type;
+  item->next = BC_TREE_NONE;
+  return ref;
+}
+
+static int bcTreeArenaValue(bcTreeArena_t* arena, const BC_VALUE value, uint32_t* pIndex)
+{
+  if (arena->valueSize == arena->valueCap)
+  {
+    if (arena->valueCap > UINT32_MAX/3*2)
+    {
+      return 0;
+    }
+
+    uint32_t cap = (arena->valueCap == 0)? BC_TREE_ARENA_INITIAL_CAP : arena->valueCap*3/2;
+    BC_VALUE* values = (BC_VALUE*) realloc(arena->values, cap*sizeof(BC_VALUE));
+    if (values == NULL)
+    {
+      return 0;
+    }
+
+    arena->values = values;
+    arena->valueCap = cap;
+  }
+
+  *pIndex = arena->valueSize;
+  arena->values[arena->valueSize++] = bcValueCopy(value);
+  return 1;
 }
 
 bcStatus_t bcTreeCleanup(bcTree_t* tree)
@@ -82,101 +108,142 @@ bcStatus_t bcTreeCleanup(bcTree_t* tree)
     return BC_INVALID_ARG;
   }
 
-  bcStatus_t status = bcTreeItemCleanup(tree->root);
+  bcTreeArenaRelease(tree->arena);
   free(tree);
-  return status;
+  return BC_OK;
 }
 
-bcTreeItem_t* bcBinOp(bcTreeItem_t* lbr, bcTreeItem_t* rbr, int tag)
+bcTreeRef_t bcBinOp(bcTreeArena_t* arena, bcTreeRef_t lbr, bcTreeRef_t rbr, int tag)
 {
-  bcBinOp_t* result = (bcBinOp_t*) malloc(sizeof(bcBinOp_t));
-  if (result == NULL)
+  bcTreeRef_t result = bcTreeArenaAlloc(arena, TIT_BIN_OP);
+  if (result == BC_TREE_NONE)
   {
-    return NULL;
+    return BC_TREE_NONE;
   }
-  result->head.type = TIT_BIN_OP;
-  result->head.next = NULL;
 
-  result->lbr = lbr;
-  result->rbr = rbr;
-  result->tag = tag;
-  return &result->head;
+  bcTreeItem_t* item = bcTreeItem(arena, result);
+  item->as.binOp.lbr = lbr;
+  item->as.binOp.rbr = rbr;
+  item->as.binOp.tag = tag;
+  return result;
 }
 
-bcTreeItem_t* bcUnOp(bcTreeItem_t* br, int tag)
+bcTreeRef_t bcUnOp(bcTreeArena_t* arena, bcTreeRef_t br, int tag)
 {
-  bcUnOp_t* result = (bcUnOp_t*) malloc(sizeof(bcUnOp_t));
-  if (result == NULL)
+  bcTreeRef_t result = bcTreeArenaAlloc(arena, TIT_UN_OP);
+  if (result == BC_TREE_NONE)
   {
-    return NULL;
+    return BC_TREE_NONE;
   }
 
-  result->head.type = TIT_UN_OP;
-  result->head.next = NULL;
-
-  result->br = br;
-  result->tag = tag;
-  return &result->head;
+  bcTreeItem_t* item = bcTreeItem(arena, result);
+  item->as.unOp.br = br;
+  item->as.unOp.tag = tag;
+  return result;
 }
 
-bcTreeItem_t* bcConstant(const BC_VALUE value)
+bcTreeRef_t bcConstant(bcTreeArena_t* arena, const BC_VALUE value)
 {
-  bcConstant_t* result = (bcConstant_t*) malloc(sizeof(bcConstant_t));
-  if (result == NULL)
+  uint32_t index;
+  if ((arena == NULL) || !bcTreeArenaValue(arena, value, &index))
   {
-    return NULL;
+    return BC_TREE_NONE;
   }
 
-  result->head.type = TIT_CONSTANT;
-  result->head.next = NULL;
-
-  result->constVal = bcValueCopy(value);
+  // value stays in arena, even if item is not allocated
+  bcTreeRef_t result = bcTreeArenaAlloc(arena, TIT_CONSTANT);
+  if (result == BC_TREE_NONE)
+  {
+    return BC_TREE_NONE;
+  }
 
-  return &result->head;
+  bcTreeItem_t* item = bcTreeItem(arena, result);
+  item->as.constant.value = index;
+  return result;
 }
 
-bcTreeItem_t* bcAppend(bcTreeItem_t* head, bcTreeItem_t* tail)
+bcTreeRef_t bcAppend(bcTreeArena_t* arena, bcTreeRef_t head, bcTreeRef_t tail)
 {
-  if (head == NULL)
+  if (head == BC_TREE_NONE)
   { // must not happen in valid code!
     assert(0);
-    return NULL;
+    return BC_TREE_NONE;
   }
 
-  bcTreeItem_t* last = head;
-  while(last->next != NULL)
+  bcTreeRef_t last = head;
+  while (bcTreeItem(arena, last)->next != BC_TREE_NONE)
   {
-    last = last->next;
+    last = bcTreeItem(arena, last)->next;
   }
 
-  last->next = tail;
+  bcTreeItem(arena, last)->next = tail;
   return head;
 }
 
-bcTreeItem_t* bcIfStatement(bcTreeItem_t* cond, bcTreeItem_t* body)
+bcTreeRef_t bcIfStatement(bcTreeArena_t* arena, bcTreeRef_t cond, bcTreeRef_t body)
 {
-  bcIfStatement_t* result = (bcIfStatement_t*) malloc(sizeof(bcIfStatement_t));
-  if (result == NULL)
+  bcTreeRef_t result = bcTreeArenaAlloc(arena, TIT_IF_STATEMENT);
+  if (result == BC_TREE_NONE)
   {
-    return NULL;
+    return BC_TREE_NONE;
+  }
+
+  bcTreeItem_t* item = bcTreeItem(arena, result);
+  item->as.ifStatement.cond = cond;
+  item->as.ifStatement.body = body;
+  return result;
+}
+
+bcTreeRef_t bcFunction(bcTreeArena_t* arena, const BC_VALUE name, bcTreeRef_t params, bcTreeRef_t body)
+{
+  uint32_t index;
+  if ((arena == NULL) || !bcTreeArenaValue(arena, name, &index))
+  {
+    return BC_TREE_NONE;
+  }
+
+  bcTreeRef_t result = bcTreeArenaAlloc(arena, TIT_FUNCTION);
+  if (result == BC_TREE_NONE)
+  {
+    return BC_TREE_NONE;
+  }
+
+  bcTreeItem_t* item = bcTreeItem(arena, result);
+  item->as.function.name = index;
+  item->as.function.params = params;
+  item->as.function.body = body;
+  return result;
+}
+
+bcTreeRef_t bcCall(bcTreeArena_t* arena, bcTreeRef_t func, bcTreeRef_t args)
+{
+  bcTreeRef_t result = bcTreeArenaAlloc(arena, TIT_CALL);
+  if (result == BC_TREE_NONE)
+  {
+    return BC_TREE_NONE;
   }
-  result->head.type = TIT_IF_STATEMENT;
-  result->head.next = NULL;
 
-  result->cond = cond;
-  result->body = bcTree(body);
-  return &result->head;
+  bcTreeItem_t* item = bcTreeItem(arena, result);
+  item->as.call.func = func;
+  item->as.call.args = args;
+  return result;
 }
 
-bcTree_t* bcTree(bcTreeItem_t* root)
+bcTree_t* bcTree(bcTreeArena_t* arena, bcTreeRef_t root)
 {
+  if (arena == NULL)
+  {
+    return NULL;
+  }
+
   bcTree_t* result = (bcTree_t*) malloc(sizeof(bcTree_t));
   if (result == NULL)
   {
     return NULL;
   }
 
+  ++arena->refCount;
+  result->arena = arena;
   result->root = root;
   return result;
 }
-
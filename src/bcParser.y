@@ -1,11 +1,10 @@
-%token_type {BC_VALUE}
-%token_destructor { if ($$ != NULL) { bcValueCleanup($$); }; }
+%token_type {bcToken_t}
 %token_prefix TOK_
-%extra_argument { bcTree_t** tree }
+%extra_argument { bcParseContext_t* parseContext }
 %start_symbol program
 
-%default_type { bcTreeItem_t* }
-%default_destructor { if ($$ != NULL) { bcTreeItemCleanup($$); } }
+// items are owned by statement arena, so discarded ones need no destructor
+%default_type { bcTreeRef_t }
 
 %right SET.
 %left LOR.
@@ -29,81 +28,434 @@
   #include <stdlib.h>
   #include <stdint.h>
 
+  /**
+   * Call arguments.
+   */
+  typedef struct bcArgList_t
+  {
+    bcTreeRef_t list; /**< Argument expressions, BC_TREE_NONE when they are compiled directly */
+    size_t count;     /**< Number of arguments */
+  } bcArgList_t;
+
+  static void bcParseFail(bcParseContext_t* parseContext, bcStatus_t status)
+  {
+    if ((status != BC_OK) && (parseContext->status == BC_OK))
+    { // first error is reported, following ones are usually caused by it
+      parseContext->status = status;
+    }
+  }
+
+  /**
+   * Get statement arena, it is created with first item.
+   */
+  static bcTreeArena_t* bcParseArena(bcParseContext_t* parseContext)
+  {
+    if (parseContext->arena == NULL)
+    {
+      parseContext->arena = bcTreeArenaNew();
+      if (parseContext->arena == NULL)
+      {
+        bcParseFail(parseContext, BC_NO_MEMORY);
+      }
+    }
+    return parseContext->arena;
+  }
+
+  static bcTreeRef_t bcParseItem(bcParseContext_t* parseContext, bcTreeRef_t item)
+  {
+    if (item == BC_TREE_NONE)
+    {
+      bcParseFail(parseContext, BC_NO_MEMORY);
+    }
+    return item;
+  }
+
+  /**
+   * Create value of token, which is kept by parser.
+   */
+  static BC_VALUE bcParseValue(bcParseContext_t* parseContext, const bcToken_t* token)
+  {
+    BC_VALUE value = bcTokenValue(token, parseContext);
+    if (value == NULL)
+    {
+      bcParseFail(parseContext, BC_NO_MEMORY);
+    }
+    return value;
+  }
+
+  /**
+   * Build constant item of token, even if statement is compiled directly.
+   */
+  static bcTreeRef_t bcParseTreeConstant(bcParseContext_t* parseContext, const bcToken_t* token)
+  {
+    BC_VALUE value = bcParseValue(parseContext, token);
+    if (value == NULL)
+    {
+      return BC_TREE_NONE;
+    }
+
+    bcTreeRef_t result = bcParseItem(parseContext, bcConstant(bcParseArena(parseContext), value));
+    bcValueCleanup(value);
+    return result;
+  }
+
+  //
+  // When parsing context compiles code, actions of top-level statements append
+  // their opcodes to code stream and produce no tree items. Lemon reduces rules
+  // bottom-up, left to right, so opcodes are appended in same order, in which
+  // bcCodeStreamCompile would produce them from parse tree.
+  //
+
+  static int bcParseEmits(const bcParseContext_t* parseContext)
+  {
+    return parseContext->compile && (parseContext->depth == 0);
+  }
+
+  /**
+   * Append global variable access by name of constant item, which is always
+   * kept in tree for variable names.
+   */
+  static void bcParseGlobal(bcParseContext_t* parseContext, bcTreeRef_t name, uint8_t opcode)
+  {
+    if (name == BC_TREE_NONE)
+    { // item creation has already failed
+      return;
+    }
+
+    const bcTreeArena_t* arena = bcParseArena(parseContext);
+    BC_VALUE value = bcTreeValue(arena, bcTreeItem(arena, name)->as.constant.value);
+    bcParseFail(parseContext, bcCodeStreamAppendGlobal(&parseContext->code, opcode, value));
+  }
+
+  static bcTreeRef_t bcParseBinOp(bcParseContext_t* parseContext, bcTreeRef_t lbr, bcTreeRef_t rbr, int tag)
+  {
+    if (!bcParseEmits(parseContext))
+    {
+      return bcParseItem(parseContext, bcBinOp(bcParseArena(parseContext), lbr, rbr, tag));
+    }
+
+    if (tag == BC_SET)
+    { // value is already compiled, variable name is not pushed
+      bcParseGlobal(parseContext, lbr, BC_STG);
+      return BC_TREE_NONE;
+    }
+    bcParseFail(parseContext, bcCodeStreamAppendOpcode(&parseContext->code, (uint8_t) tag));
+    return BC_TREE_NONE;
+  }
+
+  static bcTreeRef_t bcParseUnOp(bcParseContext_t* parseContext, bcTreeRef_t br, int tag)
+  {
+    if (!bcParseEmits(parseContext))
+    {
+      return bcParseItem(parseContext, bcUnOp(bcParseArena(parseContext), br, tag));
+    }
+
+    if (tag == BC_VAL)
+    {
+      bcParseGlobal(parseContext, br, BC_LDG);
+      return BC_TREE_NONE;
+    }
+    bcParseFail(parseContext, bcCodeStreamAppendOpcode(&parseContext->code, (uint8_t) tag));
+    return BC_TREE_NONE;
+  }
+
+  static bcTreeRef_t bcParseConstant(bcParseContext_t* parseContext, const bcToken_t* token)
+  {
+    if (!bcParseEmits(parseContext))
+    {
+      return bcParseTreeConstant(parseContext, token);
+    }
+
+    BC_VALUE value = bcParseValue(parseContext, token);
+    if (value != NULL)
+    {
+      bcParseFail(parseContext, bcCodeStreamAppendPush(&parseContext->code, value));
+      bcValueCleanup(value);
+    }
+    return BC_TREE_NONE;
+  }
+
+  static bcTreeRef_t bcParseCall(bcParseContext_t* parseContext, bcTreeRef_t func, bcArgList_t* args)
+  {
+    if (!bcParseEmits(parseContext))
+    {
+      return bcParseItem(parseContext, bcCall(bcParseArena(parseContext), func, args->list));
+    }
+
+    if (args->count > UINT8_MAX)
+    {
+      bcParseFail(parseContext, BC_TOO_MANY_LOCALS);
+      return BC_TREE_NONE;
+    }
+    bcParseFail(parseContext, bcCodeStreamAppendOpcodeArg(&parseContext->code, BC_CLL, (uint8_t) args->count));
+    return BC_TREE_NONE;
+  }
+
+  static bcTreeRef_t bcParseIfStatement(bcParseContext_t* parseContext, bcTreeRef_t cond, bcTreeRef_t body)
+  {
+    if (!bcParseEmits(parseContext))
+    {
+      return bcParseItem(parseContext, bcIfStatement(bcParseArena(parseContext), cond, body));
+    }
+
+    // condition is already compiled, body is compiled on first use
+    bcTree_t* tree = bcTree(bcParseArena(parseContext), body);
+    if (tree == NULL)
+    {
+      bcParseFail(parseContext, BC_NO_MEMORY);
+      return BC_TREE_NONE;
+    }
+
+    BC_VALUE lazyBody = bcValueCode(tree);
+    if (lazyBody == NULL)
+    {
+      bcTreeCleanup(tree);
+      bcParseFail(parseContext, BC_NO_MEMORY);
+      return BC_TREE_NONE;
+    }
+
+    uint8_t conCode;
+    bcStatus_t status = bcCodeStreamAppendConstant(&parseContext->code, lazyBody, &conCode);
+    bcValueCleanup(lazyBody);
+    if (status == BC_OK)
+    {
+      status = bcCodeStreamAppendOpcodeArg(&parseContext->code, BC_IFS, conCode);
+    }
+    bcParseFail(parseContext, status);
+    return BC_TREE_NONE;
+  }
+
+  static bcTreeRef_t bcParseFunction(bcParseContext_t* parseContext, bcTreeRef_t def, bcTreeRef_t body)
+  {
+    if ((def == BC_TREE_NONE) || (parseContext->status != BC_OK))
+    { // definition may be incomplete
+      return BC_TREE_NONE;
+    }
+
+    bcTreeItem(parseContext->arena, def)->as.function.body = body;
+    if (!bcParseEmits(parseContext))
+    {
+      return def;
+    }
+
+    // function body needs its scope, so definition is compiled from tree
+    bcParseFail(parseContext, bcCodeStreamAppendStatement(&parseContext->code, parseContext->arena, def));
+    return BC_TREE_NONE;
+  }
+
 }
 
 %syntax_error {
   fprintf(stderr, "Syntax Error: Unexpected token %s (%d)\n", yyTokenName[yymajor], yymajor);
+  bcParseFail(parseContext, BC_MALFORMED_CODE);
 }
 
-program ::= statementList(LIST). { *tree = bcTree(LIST);  }
+%parse_failure {
+  bcParseFail(parseContext, BC_MALFORMED_CODE);
+}
 
-statementList(RESULT) ::= statementList(HEAD) statement(TAIL). { if (HEAD == NULL) { RESULT = TAIL; } else { RESULT = bcAppend(HEAD, TAIL); } }
+%type argList { bcArgList_t }
+%type args { bcArgList_t }
+
+program ::= statementList(LIST). {
+  if (!parseContext->compile)
+  { // compiled statements leave nothing in list
+    parseContext->tree = bcTree(bcParseArena(parseContext), LIST);
+  }
+}
+
+statementList(RESULT) ::= statementList(HEAD) statement(TAIL). {
+  if (HEAD == BC_TREE_NONE)
+  {
+    RESULT = TAIL;
+  }
+  else
+  {
+    RESULT = bcAppend(parseContext->arena, HEAD, TAIL);
+  }
+}
 statementList(RESULT) ::= statement(HEAD). { RESULT = HEAD; }
 
-statement(RESULT) ::= IF rightExpr(COND) BLOCK INDENT statementList(BODY) DEDENT. {
-  RESULT = bcIfStatement(COND, BODY);
-}
-
-statement(RESULT) ::= rightExpr(HEAD) EXPR_END. { RESULT = bcUnOp(HEAD, BC_RET); }
-statement(RESULT) ::= EXPR_END. { RESULT = NULL; }
-
-rightExpr(RESULT) ::=  leftExpr(LHS) SET rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_SET); }
-rightExpr(RESULT) ::= rightExpr(LHS) LOR rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_LOR); }
-rightExpr(RESULT) ::= rightExpr(LHS) LND rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_LND); }
-rightExpr(RESULT) ::= rightExpr(LHS) BOR rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_BOR); }
-rightExpr(RESULT) ::= rightExpr(LHS) XOR rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_XOR); }
-rightExpr(RESULT) ::= rightExpr(LHS) BND rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_BND); }
-rightExpr(RESULT) ::= rightExpr(LHS) EQ  rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_EQ);  }
-rightExpr(RESULT) ::= rightExpr(LHS) NEQ rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_NEQ); }
-rightExpr(RESULT) ::= rightExpr(LHS) GR  rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_GR);  }
-rightExpr(RESULT) ::= rightExpr(LHS) GRE rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_GRE); }
-rightExpr(RESULT) ::= rightExpr(LHS) LS  rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_LS);  }
-rightExpr(RESULT) ::= rightExpr(LHS) LSE rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_LSE); }
-rightExpr(RESULT) ::= rightExpr(LHS) BLS rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_BLS); }
-rightExpr(RESULT) ::= rightExpr(LHS) BRS rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_BRS); }
-rightExpr(RESULT) ::= rightExpr(LHS) SUB rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_SUB); }
-rightExpr(RESULT) ::= rightExpr(LHS) ADD rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_ADD); }
-rightExpr(RESULT) ::= rightExpr(LHS) MUL rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_MUL); }
-rightExpr(RESULT) ::= rightExpr(LHS) DIV rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_DIV); }
-rightExpr(RESULT) ::= rightExpr(LHS) MOD rightExpr(RHS). { RESULT = bcBinOp(LHS, RHS, BC_MOD); }
+ifHead(RESULT) ::= IF rightExpr(COND) BLOCK. {
+  RESULT = COND;
+  parseContext->depth++;
+}
+
+statement(RESULT) ::= ifHead(COND) INDENT statementList(BODY) DEDENT. {
+  parseContext->depth--;
+  RESULT = bcParseIfStatement(parseContext, COND, BODY);
+}
+
+funcHead(RESULT) ::= FUNC ID(NAME) OPENBR paramList(PARAMS) CLOSEBR BLOCK. {
+  BC_VALUE name = bcParseValue(parseContext, &NAME);
+  RESULT = BC_TREE_NONE;
+  if (name != NULL)
+  {
+    RESULT = bcParseItem(parseContext, bcFunction(bcParseArena(parseContext), name, PARAMS, BC_TREE_NONE));
+    bcValueCleanup(name);
+  }
+  parseContext->depth++;
+}
+
+statement(RESULT) ::= funcHead(DEF) INDENT statementList(BODY) DEDENT. {
+  parseContext->depth--;
+  RESULT = bcParseFunction(parseContext, DEF, BODY);
+}
+
+statement(RESULT) ::= RETURN rightExpr(HEAD) EXPR_END. {
+  if (bcParseEmits(parseContext))
+  { // return outside of function
+    bcParseFail(parseContext, BC_MALFORMED_CODE);
+    RESULT = BC_TREE_NONE;
+  }
+  else
+  {
+    RESULT = bcParseItem(parseContext, bcUnOp(bcParseArena(parseContext), HEAD, BC_RTN));
+  }
+}
+statement(RESULT) ::= rightExpr(HEAD) EXPR_END. { RESULT = bcParseUnOp(parseContext, HEAD, BC_RET); }
+statement(RESULT) ::= EXPR_END. { RESULT = BC_TREE_NONE; }
+
+rightExpr(RESULT) ::=  leftExpr(LHS) SET rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_SET); }
+rightExpr(RESULT) ::= rightExpr(LHS) LOR rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_LOR); }
+rightExpr(RESULT) ::= rightExpr(LHS) LND rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_LND); }
+rightExpr(RESULT) ::= rightExpr(LHS) BOR rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_BOR); }
+rightExpr(RESULT) ::= rightExpr(LHS) XOR rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_XOR); }
+rightExpr(RESULT) ::= rightExpr(LHS) BND rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_BND); }
+rightExpr(RESULT) ::= rightExpr(LHS) EQ  rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_EQ);  }
+rightExpr(RESULT) ::= rightExpr(LHS) NEQ rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_NEQ); }
+rightExpr(RESULT) ::= rightExpr(LHS) GR  rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_GR);  }
+rightExpr(RESULT) ::= rightExpr(LHS) GRE rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_GRE); }
+rightExpr(RESULT) ::= rightExpr(LHS) LS  rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_LS);  }
+rightExpr(RESULT) ::= rightExpr(LHS) LSE rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_LSE); }
+rightExpr(RESULT) ::= rightExpr(LHS) BLS rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_BLS); }
+rightExpr(RESULT) ::= rightExpr(LHS) BRS rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_BRS); }
+rightExpr(RESULT) ::= rightExpr(LHS) SUB rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_SUB); }
+rightExpr(RESULT) ::= rightExpr(LHS) ADD rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_ADD); }
+rightExpr(RESULT) ::= rightExpr(LHS) MUL rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_MUL); }
+rightExpr(RESULT) ::= rightExpr(LHS) DIV rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_DIV); }
+rightExpr(RESULT) ::= rightExpr(LHS) MOD rightExpr(RHS). { RESULT = bcParseBinOp(parseContext, LHS, RHS, BC_MOD); }
 rightExpr(RESULT) ::= OPENBR rightExpr(EXPR) CLOSEBR.    { RESULT = EXPR; }
-rightExpr(RESULT) ::= LNOT rightExpr(BR).                { RESULT = bcUnOp(BR, BC_LNT); }
-rightExpr(RESULT) ::= BNOT rightExpr(BR).                { RESULT = bcUnOp(BR, BC_BNT); }
-rightExpr(RESULT) ::= SUB rightExpr(BR). [LNOT]          { RESULT = bcUnOp(BR, BC_NEG); }
-rightExpr(RESULT) ::= OPENBR INT CLOSEBR rightExpr(BR).  { RESULT = bcUnOp(BR, BC_INT); }
-rightExpr(RESULT) ::= OPENBR NUM CLOSEBR rightExpr(BR).  { RESULT = bcUnOp(BR, BC_NUM); }
-rightExpr(RESULT) ::= OPENBR STR CLOSEBR rightExpr(BR).  { RESULT = bcUnOp(BR, BC_STR); }
+rightExpr(RESULT) ::= LNOT rightExpr(BR).                { RESULT = bcParseUnOp(parseContext, BR, BC_LNT); }
+rightExpr(RESULT) ::= BNOT rightExpr(BR).                { RESULT = bcParseUnOp(parseContext, BR, BC_BNT); }
+rightExpr(RESULT) ::= SUB rightExpr(BR). [LNOT]          { RESULT = bcParseUnOp(parseContext, BR, BC_NEG); }
+rightExpr(RESULT) ::= OPENBR INT CLOSEBR rightExpr(BR).  { RESULT = bcParseUnOp(parseContext, BR, BC_INT); }
+rightExpr(RESULT) ::= OPENBR NUM CLOSEBR rightExpr(BR).  { RESULT = bcParseUnOp(parseContext, BR, BC_NUM); }
+rightExpr(RESULT) ::= OPENBR STR CLOSEBR rightExpr(BR).  { RESULT = bcParseUnOp(parseContext, BR, BC_STR); }
 
 rightExpr(RESULT) ::= CONSTANT(VALUE). {
-  RESULT = bcConstant(VALUE);
-  bcValueCleanup(VALUE);
+  RESULT = bcParseConstant(parseContext, &VALUE);
+}
+
+rightExpr(RESULT) ::= callHead(FUNC) argList(ARGS) CLOSEBR. {
+  RESULT = bcParseCall(parseContext, FUNC, &ARGS);
 }
 
 rightExpr(RESULT) ::= leftExpr(BR). {
-  RESULT = bcUnOp(BR, BC_VAL);
+  RESULT = bcParseUnOp(parseContext, BR, BC_VAL);
+}
+
+callHead(RESULT) ::= ID(NAME) OPENBR. {
+  // function value is pushed before arguments
+  RESULT = bcParseUnOp(parseContext, bcParseTreeConstant(parseContext, &NAME), BC_VAL);
 }
 
 leftExpr(RESULT) ::= ID(NAME). {
-  RESULT = bcConstant(NAME),
-  bcValueCleanup(NAME);
+  // variable name is kept as item, even if statement is compiled directly
+  RESULT = bcParseTreeConstant(parseContext, &NAME);
+}
+
+paramList(RESULT) ::= . { RESULT = BC_TREE_NONE; }
+paramList(RESULT) ::= params(LIST). { RESULT = LIST; }
+
+params(RESULT) ::= ID(NAME). {
+  RESULT = bcParseTreeConstant(parseContext, &NAME);
+}
+
+params(RESULT) ::= params(HEAD) COMMA ID(NAME). {
+  RESULT = bcAppend(parseContext->arena, HEAD, bcParseTreeConstant(parseContext, &NAME));
+}
+
+argList(RESULT) ::= . { RESULT.list = BC_TREE_NONE; RESULT.count = 0; }
+argList(RESULT) ::= args(LIST). { RESULT = LIST; }
+
+args(RESULT) ::= rightExpr(HEAD). { RESULT.list = HEAD; RESULT.count = 1; }
+args(RESULT) ::= args(HEAD) COMMA rightExpr(TAIL). {
+  RESULT.list = (HEAD.list == BC_TREE_NONE)? TAIL : bcAppend(parseContext->arena, HEAD.list, TAIL);
+  RESULT.count = HEAD.count + 1;
 }
 
 %code {
 
   #include "bcParser.h"
 
-  bcStatus_t bcParseString(const char* str, bcTree_t** parseTree, char** endp, bcParseContext_t* parseContext)
+  #include <string.h>
+
+  /**
+   * Keep copy of source chunk, because parser can hold tokens referring to
+   * it, until statement is finished.
+   */
+  static int bcParseKeepSource(bcParseContext_t* parseContext, const char* str)
   {
-    if ((parseTree == NULL) || (str == NULL) || (parseContext == NULL))
+    char** chunks = (char**) realloc(parseContext->chunks, (parseContext->chunk + 1)*sizeof(char*));
+    if (chunks == NULL)
     {
-      return BC_INVALID_ARG;
+      return 0;
+    }
+    parseContext->chunks = chunks;
+
+    size_t len = strlen(str) + 1;
+    char* copy = (char*) malloc(len);
+    if (copy == NULL)
+    {
+      return 0;
+    }
+    memcpy(copy, str, len);
+
+    chunks[parseContext->chunk++] = copy;
+    parseContext->source = NULL;
+    return 1;
+  }
+
+  /**
+   * Free parser and everything, what was kept for unfinished statement.
+   */
+  static void bcParseFinish(void* parser, bcParseContext_t* parseContext)
+  {
+    ParseFree(parser, free);
+    parseContext->context = NULL;
+
+    // trees, which are still needed, keep their own arena references
+    bcTreeArenaRelease(parseContext->arena);
+    parseContext->arena = NULL;
+
+    for (uint32_t i = 0; i < parseContext->chunk; ++i)
+    {
+      free(parseContext->chunks[i]);
     }
+    free(parseContext->chunks);
+    parseContext->chunks = NULL;
+    parseContext->chunk = 0;
+    parseContext->source = NULL;
+  }
 
+  /**
+   * Feed tokens of string to parser.
+   *
+   * Parser is allocated, when new statement begins, and freed, when it is
+   * finished. Parser result is left in parsing context.
+   */
+  static bcStatus_t bcParseRun(const char* str, char** endp, bcParseContext_t* parseContext)
+  {
     void* parser = NULL;
 
     if (parseContext->context == NULL)
     {
       parser = ParseAlloc(malloc);
+
+      parseContext->tree = NULL;
+      parseContext->depth = 0;
+      parseContext->status = BC_OK;
     }
     else
     {
@@ -119,35 +471,29 @@ leftExpr(RESULT) ::= ID(NAME). {
       return BC_NO_MEMORY;
     }
 
-    BC_VALUE tmptok = NULL;
+    bcToken_t token;
+    memset(&token, 0, sizeof(bcToken_t));
+
+    parseContext->source = str;
     const char* cursor = str;
 
 //    ParseTrace(stderr, "trace: ");
 
     //
-    // I didn't found info on how properly raise internal errors from parser,
-    // Internet says, that parsing context must have some error flags when 
-    // some internal error happened and break on parsing in outer loop.
-    //
-    // So, now we just don't do any checks.
+    // Lemon can't break parsing from actions, so they record first error in
+    // parsing context, and it is reported when statement is finished.
     //
-    // Later, I'll add them.
-    //
-
-    bcTree_t* tree = NULL;
 
-    int prevTok;
-    for(int tok = bcGetToken(cursor, &cursor, &tmptok, parseContext); tok != 0; tok = bcGetToken(cursor, &cursor, &tmptok, parseContext))
+    int prevTok = 0;
+    for(int tok = bcGetToken(cursor, &cursor, &token, parseContext); tok != 0; tok = bcGetToken(cursor, &cursor, &token, parseContext))
     {
       if (tok == -1)
       { // special case, when more data expected
-        parseContext->context = parser;
-        return BC_PARSE_NOT_FINISHED;
+        prevTok = tok;
+        break;
       }
 
-      Parse(parser, tok, bcValueCopy(tmptok), &tree);
-      bcValueCleanup(tmptok);
-      tmptok = NULL;
+      Parse(parser, tok, token, parseContext);
       prevTok = tok;
 
       if (*cursor == '\0')
@@ -156,27 +502,127 @@ leftExpr(RESULT) ::= ID(NAME). {
       }
     }
 
-    if ((prevTok == TOK_BLOCK) || (parseContext->indentTop != parseContext->indentStack))
+    if ((prevTok == -1) || (prevTok == TOK_BLOCK) || (parseContext->indentTop != parseContext->indentStack))
     { // not all block were closed
+      if (!bcParseKeepSource(parseContext, str))
+      {
+        bcParseFinish(parser, parseContext);
+        return BC_NO_MEMORY;
+      }
+
       parseContext->context = parser;
       return BC_PARSE_NOT_FINISHED;
     }
 
     // When no more tokens are available, we need to give parser to know about it.
-    Parse(parser, 0, 0, &tree);
+    Parse(parser, 0, token, parseContext);
 
     //
     // Here parser done it's job and dies
     //
-    ParseFree(parser, free);
+    bcParseFinish(parser, parseContext);
 
-    *parseTree = tree;
-    parseContext->context = NULL;
     if (endp != NULL)
     {
       *endp = (char*) cursor;
     }
+    return parseContext->status;
+  }
+
+  bcStatus_t bcParseString(const char* str, bcTree_t** parseTree, char** endp, bcParseContext_t* parseContext)
+  {
+    if ((parseTree == NULL) || (str == NULL) || (parseContext == NULL))
+    {
+      return BC_INVALID_ARG;
+    }
+
+    if (parseContext->context == NULL)
+    {
+      parseContext->compile = 0;
+    }
+
+    bcStatus_t status = bcParseRun(str, endp, parseContext);
+    if (status == BC_PARSE_NOT_FINISHED)
+    {
+      return status;
+    }
+
+    bcTree_t* tree = parseContext->tree;
+    parseContext->tree = NULL;
+
+    if (status != BC_OK)
+    {
+      if (tree != NULL)
+      {
+        bcTreeCleanup(tree);
+      }
+      return status;
+    }
+
+    *parseTree = tree;
     return BC_OK;
   }
 
-}
\ No newline at end of file
+  bcStatus_t bcParseCompile(const char* str, bcCodeStream_t* cs, char** endp, bcParseContext_t* parseContext)
+  {
+    if ((cs == NULL) || (str == NULL) || (parseContext == NULL))
+    {
+      return BC_INVALID_ARG;
+    }
+
+    if (parseContext->context == NULL)
+    { // new statement begins
+      bcStatus_t status = bcCodeStreamInit(&parseContext->code);
+      if (status != BC_OK)
+      {
+        return status;
+      }
+      parseContext->compile = 1;
+    }
+
+    bcStatus_t status = bcParseRun(str, endp, parseContext);
+    if (status == BC_PARSE_NOT_FINISHED)
+    {
+      return status;
+    }
+
+    if ((status == BC_OK) && (parseContext->code.opSize == 0))
+    {
+      status = BC_EMPTY_EXPR;
+    }
+
+    if (status == BC_OK)
+    {
+      status = bcCodeStreamAppendOpcode(&parseContext->code, BC_HALT);
+    }
+
+    if (status == BC_OK)
+    {
+      *cs = parseContext->code;
+    }
+    else
+    {
+      bcCodeStreamCleanup(&parseContext->code);
+    }
+
+    memset(&parseContext->code, 0, sizeof(bcCodeStream_t));
+    parseContext->compile = 0;
+    return status;
+  }
+
+  void bcParseContextCleanup(bcParseContext_t* parseContext)
+  {
+    if ((parseContext != NULL) && (parseContext->context != NULL))
+    {
+      bcParseFinish(parseContext->context, parseContext);
+
+      if (parseContext->compile)
+      { // partial code of unfinished statement
+        bcCodeStreamCleanup(&parseContext->code);
+        memset(&parseContext->code, 0, sizeof(bcCodeStream_t));
+        parseContext->compile = 0;
+      }
+    }
+  }
+
+}
@@ -0,0 +1,460 @@
+/**
+ * Pool of worker threads.
+ *
+ * Every worker owns deque of cores, which have pending jobs. Worker takes
+ * newest core from tail of its own deque, and when it is empty, steals
+ * oldest core from head of others. Core, which has more jobs, is pushed
+ * back to deque of worker, which executed it, and new jobs of idle core are
+ * pushed to deque of worker, which executed it last, so core data stays in
+ * the same processor cache.
+ *
+ * Jobs of core form list guarded by pool lock. Core is in deque or executed
+ * by worker only while its list is not empty, so it is never executed by
+ * two threads at once. Pool claims idle core atomically on submit and 
+ * releases it, when list becomes empty, so core with jobs in one pool is
+ * rejected by others.
+ */
+#include <bcPrivate.h>
+#include <bcSync.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+struct bcJob_t
+{
+  BC_JOB next;
+  BC_PROGRAM program;
+  bcJobCallback_t callback;
+  void* user;
+  bcMutex_t lock;
+  bcCond_t completed; /**< Broadcast when job is completed */
+  int done;           /**< Not 0 when job is completed */
+  bcStatus_t status;  /**< Execution status */
+  int32_t refCount;   /**< Pool and job handle references */
+};
+
+typedef struct bcPoolDeque_t
+{
+  bcMutex_t lock;
+  BC_CORE* cores; /**< Ring of cores */
+  size_t cap;     /**< Ring capacity */
+  size_t head;    /**< Index of oldest core */
+  size_t size;    /**< Cores in ring */
+} bcPoolDeque_t;
+
+typedef struct bcPoolWorker_t
+{
+  BC_POOL pool;
+  size_t index;
+  bcThread_t thread;
+  bcPoolDeque_t deque;
+} bcPoolWorker_t;
+
+struct bcPool_t
+{
+  bcMutex_t lock;
+  bcCond_t wake;    /**< Signaled when core is pushed or pool is stopped */
+  size_t pending;   /**< Cores in all deques */
+  size_t next;      /**< Worker of next core executed first time */
+  int stop;         /**< Not 0 after bcPoolDelete */
+  size_t count;     /**< Number of workers */
+  bcPoolWorker_t workers[];
+};
+
+/**
+ * Guards sharing of programs, which can be submitted to several pools.
+ */
+static bcMutex_t bcPoolShareLock = BC_MUTEX_INIT;
+
+static bcStatus_t bcPoolDequePush(bcPoolDeque_t* deque, BC_CORE core)
+{
+  bcMutexLock(&deque->lock);
+  if (deque->size == deque->cap)
+  {
+    size_t cap = (deque->cap == 0) ? 16 : deque->cap * 2;
+    BC_CORE* cores = (BC_CORE*) malloc(cap * sizeof(BC_CORE));
+    if (cores == NULL)
+    {
+      bcMutexUnlock(&deque->lock);
+      return BC_NO_MEMORY;
+    }
+
+    for (size_t i = 0; i < deque->size; ++i)
+    {
+      cores[i] = deque->cores[(deque->head + i) % deque->cap];
+    }
+    free(deque->cores);
+    deque->cores = cores;
+    deque->cap = cap;
+    deque->head = 0;
+  }
+
+  deque->cores[(deque->head + deque->size) % deque->cap] = core;
+  ++deque->size;
+  bcMutexUnlock(&deque->lock);
+  return BC_OK;
+}
+
+/**
+ * Take newest core, which is executed by owner.
+ */
+static BC_CORE bcPoolDequePop(bcPoolDeque_t* deque)
+{
+  BC_CORE core = NULL;
+  bcMutexLock(&deque->lock);
+  if (deque->size != 0)
+  {
+    --deque->size;
+    core = deque->cores[(deque->head + deque->size) % deque->cap];
+  }
+  bcMutexUnlock(&deque->lock);
+  return core;
+}
+
+/**
+ * Take oldest core, which is executed by thief.
+ */
+static BC_CORE bcPoolDequeSteal(bcPoolDeque_t* deque)
+{
+  BC_CORE core = NULL;
+  bcMutexLock(&deque->lock);
+  if (deque->size != 0)
+  {
+    core = deque->cores[deque->head];
+    deque->head = (deque->head + 1) % deque->cap;
+    --deque->size;
+  }
+  bcMutexUnlock(&deque->lock);
+  return core;
+}
+
+static void bcJobRelease(BC_JOB job)
+{
+  if (bcAtomicAdd32(&job->refCount, -1) == 0)
+  {
+    bcCondDestroy(&job->completed);
+    bcMutexDestroy(&job->lock);
+    free(job);
+  }
+}
+
+static void bcJobComplete(BC_JOB job, bcStatus_t status)
+{
+  bcMutexLock(&job->lock);
+  job->status = status;
+  job->done = 1;
+  bcMutexUnlock(&job->lock);
+
+  bcCondBroadcast(&job->completed);
+  bcJobRelease(job);
+}
+
+/**
+ * Execute oldest job of core. Core stays with worker while push back to its
+ * deque fails.
+ */
+static void bcPoolExecute(bcPoolWorker_t* worker, BC_CORE core)
+{
+  BC_POOL pool = worker->pool;
+
+  bcMutexLock(&pool->lock);
+  --pool->pending;
+  core->poolLast = pool;
+  core->poolWorker = worker->index;
+  bcMutexUnlock(&pool->lock);
+
+  for (;;)
+  {
+    BC_JOB job = core->poolHead;
+    bcStatus_t status = bcCoreExecuteProgram(core, job->program);
+    if (job->callback != NULL)
+    {
+      job->callback(job->user, core, status);
+    }
+
+    int more = 0;
+    bcMutexLock(&pool->lock);
+    core->poolHead = job->next;
+    if (core->poolHead == NULL)
+    {
+      core->poolTail = NULL;
+      bcAtomicStorePtr((void* volatile*) &core->pool, NULL);
+    }
+    else if (bcPoolDequePush(&worker->deque, core) == BC_OK)
+    { // other jobs can run before next one of this core
+      ++pool->pending;
+      bcCondSignal(&pool->wake);
+    }
+    else
+    {
+      more = 1;
+    }
+    bcMutexUnlock(&pool->lock);
+
+    bcJobComplete(job, status);
+    if (!more)
+    {
+      return;
+    }
+  }
+}
+
+static BC_CORE bcPoolTake(bcPoolWorker_t* worker)
+{
+  BC_CORE core = bcPoolDequePop(&worker->deque);
+  for (size_t i = 1; (core == NULL) && (i < worker->pool->count); ++i)
+  {
+    core = bcPoolDequeSteal(&worker->pool->workers[(worker->index + i) % worker->pool->count].deque);
+  }
+  return core;
+}
+
+static BC_THREAD_MAIN(bcPoolWorkerMain, arg)
+{
+  bcPoolWorker_t* worker = (bcPoolWorker_t*) arg;
+  BC_POOL pool = worker->pool;
+
+  bcMutexLock(&pool->lock);
+  for (;;)
+  {
+    if (pool->pending != 0)
+    {
+      bcMutexUnlock(&pool->lock);
+      BC_CORE core = bcPoolTake(worker);
+      if (core != NULL)
+      {
+        bcPoolExecute(worker, core);
+      }
+      else
+      { // core is taken, but not counted yet
+        bcThreadYield();
+      }
+      bcMutexLock(&pool->lock);
+      continue;
+    }
+
+    if (pool->stop)
+    {
+      break;
+    }
+    bcCondWait(&pool->wake, &pool->lock);
+  }
+  bcMutexUnlock(&pool->lock);
+
+  BC_THREAD_RETURN;
+}
+
+BCAPI bcStatus_t bcPoolNew(size_t threads, BC_POOL* pPool)
+{
+  if (pPool == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  if (threads == 0)
+  {
+    threads = bcThreadCount();
+  }
+
+  if (threads > (SIZE_MAX - sizeof(struct bcPool_t)) / sizeof(bcPoolWorker_t))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  BC_POOL pool = (BC_POOL) malloc(sizeof(struct bcPool_t) + threads * sizeof(bcPoolWorker_t));
+  if (pool == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  bcMutexInit(&pool->lock);
+  bcCondInit(&pool->wake);
+  pool->pending = 0;
+  pool->next = 0;
+  pool->stop = 0;
+  pool->count = threads;
+
+  for (size_t i = 0; i < threads; ++i)
+  {
+    bcPoolWorker_t* worker = &pool->workers[i];
+    worker->pool = pool;
+    worker->index = i;
+    bcMutexInit(&worker->deque.lock);
+    worker->deque.cores = NULL;
+    worker->deque.cap = 0;
+    worker->deque.head = 0;
+    worker->deque.size = 0;
+  }
+
+  for (size_t i = 0; i < threads; ++i)
+  {
+    if (!bcThreadCreate(&pool->workers[i].thread, bcPoolWorkerMain, &pool->workers[i]))
+    {
+      for (size_t j = i; j < threads; ++j)
+      {
+        bcMutexDestroy(&pool->workers[j].deque.lock);
+      }
+      pool->count = i;
+      bcPoolDelete(pool);
+      return BC_NO_MEMORY;
+    }
+  }
+
+  *pPool = pool;
+  return BC_OK;
+}
+
+BCAPI void bcPoolDelete(BC_POOL pool)
+{
+  if (pool == NULL)
+  {
+    return;
+  }
+
+  bcMutexLock(&pool->lock);
+  pool->stop = 1;
+  bcMutexUnlock(&pool->lock);
+  bcCondBroadcast(&pool->wake);
+
+  // workers leave when all deques are empty, and core, which is executed,
+  // is pushed back only to deque of its worker
+  for (size_t i = 0; i < pool->count; ++i)
+  {
+    bcThreadJoin(pool->workers[i].thread);
+  }
+
+  for (size_t i = 0; i < pool->count; ++i)
+  {
+    free(pool->workers[i].deque.cores);
+    bcMutexDestroy(&pool->workers[i].deque.lock);
+  }
+
+  bcCondDestroy(&pool->wake);
+  bcMutexDestroy(&pool->lock);
+  free(pool);
+}
+
+/**
+ * Make program code safe to execute from several threads.
+ */
+static bcStatus_t bcPoolShare(BC_PROGRAM program)
+{
+  bcStatus_t status = BC_OK;
+  bcMutexLock(&bcPoolShareLock);
+  if (!program->shared)
+  {
+    size_t size = 0;
+    status = bcCodeStreamShare(&program->code, &size);
+    program->shared = (status == BC_OK);
+  }
+  bcMutexUnlock(&bcPoolShareLock);
+  return status;
+}
+
+BCAPI bcStatus_t bcPoolSubmit(BC_POOL pool, BC_CORE core, const BC_PROGRAM program, bcJobCallback_t callback, void* user, BC_JOB* pJob)
+{
+  if ((pool == NULL) || (core == NULL) || (program == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcStatus_t status = bcPoolShare(program);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  BC_JOB job = (BC_JOB) malloc(sizeof(struct bcJob_t));
+  if (job == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  job->next = NULL;
+  job->program = program;
+  job->callback = callback;
+  job->user = user;
+  bcMutexInit(&job->lock);
+  bcCondInit(&job->completed);
+  job->done = 0;
+  job->status = BC_OK;
+  job->refCount = (pJob != NULL) ? 2 : 1;
+
+  bcMutexLock(&pool->lock);
+  if (pool->stop)
+  {
+    status = BC_CLOSED;
+  }
+  else if ((bcAtomicLoadPtr((void* volatile*) &core->pool) != pool)
+    && !bcAtomicCasPtr((void* volatile*) &core->pool, NULL, pool))
+  { // core has jobs in other pool
+    status = BC_INVALID_ARG;
+  }
+  else if (core->poolTail != NULL)
+  { // core is scheduled, it takes job when previous ones are done
+    core->poolTail->next = job;
+    core->poolTail = job;
+  }
+  else
+  {
+    size_t index = core->poolWorker;
+    if ((core->poolLast != pool) || (index >= pool->count))
+    {
+      index = pool->next;
+      pool->next = (pool->next + 1) % pool->count;
+    }
+
+    status = bcPoolDequePush(&pool->workers[index].deque, core);
+    if (status == BC_OK)
+    {
+      core->poolHead = job;
+      core->poolTail = job;
+      ++pool->pending;
+      bcCondSignal(&pool->wake);
+    }
+    else
+    {
+      bcAtomicStorePtr((void* volatile*) &core->pool, NULL);
+    }
+  }
+  bcMutexUnlock(&pool->lock);
+
+  if (status != BC_OK)
+  {
+    bcCondDestroy(&job->completed);
+    bcMutexDestroy(&job->lock);
+    free(job);
+    return status;
+  }
+
+  if (pJob != NULL)
+  {
+    *pJob = job;
+  }
+  return BC_OK;
+}
+
+BCAPI bcStatus_t bcJobWait(BC_JOB job)
+{
+  if (job == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcMutexLock(&job->lock);
+  while (!job->done)
+  {
+    bcCondWait(&job->completed, &job->lock);
+  }
+  bcStatus_t status = job->status;
+  bcMutexUnlock(&job->lock);
+  return status;
+}
+
+BCAPI void bcJobDelete(BC_JOB job)
+{
+  if (job != NULL)
+  {
+    bcJobRelease(job);
+  }
+}
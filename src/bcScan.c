@@ -0,0 +1,208 @@
+#include <bcPrivate.h>
+
+#include <stdint.h>
+
+#if !defined(BC_SCAN_SCALAR)
+#if defined(__AVX2__)
+#define BC_SCAN_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define BC_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+#endif
+
+#if defined(BC_SCAN_AVX2) || defined(BC_SCAN_SSE2)
+
+//
+// Aligned block loads can read after terminating '\0', but never cross its
+// page. Address sanitizer doesn't know it, so vector scanners aren't
+// instrumented.
+//
+#if defined(__clang__) || defined(__GNUC__)
+#define BC_SCAN_NO_SANITIZE __attribute__((no_sanitize_address))
+#else
+#define BC_SCAN_NO_SANITIZE
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+
+static unsigned bcScanFirst(uint32_t mask)
+{
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (unsigned) index;
+}
+#else
+static unsigned bcScanFirst(uint32_t mask)
+{
+  return (unsigned) __builtin_ctz(mask);
+}
+#endif
+
+#ifdef BC_SCAN_AVX2
+
+#define BC_SCAN_BLOCK 32
+
+typedef __m256i bcScanBlock_t;
+
+#define bcScanLoad(p) _mm256_load_si256((const __m256i*) (p))
+#define bcScanSet(c) _mm256_set1_epi8((char) (c))
+#define bcScanEq(a, b) _mm256_cmpeq_epi8((a), (b))
+#define bcScanGt(a, b) _mm256_cmpgt_epi8((a), (b))
+#define bcScanOr(a, b) _mm256_or_si256((a), (b))
+#define bcScanAnd(a, b) _mm256_and_si256((a), (b))
+#define bcScanMask(a) ((uint32_t) _mm256_movemask_epi8(a))
+
+#else
+
+#define BC_SCAN_BLOCK 16
+
+typedef __m128i bcScanBlock_t;
+
+#define bcScanLoad(p) _mm_load_si128((const __m128i*) (p))
+#define bcScanSet(c) _mm_set1_epi8((char) (c))
+#define bcScanEq(a, b) _mm_cmpeq_epi8((a), (b))
+#define bcScanGt(a, b) _mm_cmpgt_epi8((a), (b))
+#define bcScanOr(a, b) _mm_or_si128((a), (b))
+#define bcScanAnd(a, b) _mm_and_si128((a), (b))
+#define bcScanMask(a) ((uint32_t) _mm_movemask_epi8(a))
+
+#endif
+
+#define BC_SCAN_ALL ((uint32_t) ((1ull << BC_SCAN_BLOCK) - 1))
+
+static int bcScanAligned(const char* head)
+{
+  return ((uintptr_t) head & (BC_SCAN_BLOCK - 1)) == 0;
+}
+
+#endif
+
+static int bcScanIsSpace(char c)
+{
+  return (c == ' ') || (c == '\t');
+}
+
+static int bcScanIsId(char c)
+{
+  return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || ((c >= '0') && (c <= '9')) || (c == '_');
+}
+
+#if defined(BC_SCAN_AVX2) || defined(BC_SCAN_SSE2)
+
+BC_SCAN_NO_SANITIZE
+const char* bcScanSpaces(const char* head)
+{
+  for (; !bcScanAligned(head); ++head)
+  {
+    if (!bcScanIsSpace(*head))
+    {
+      return head;
+    }
+  }
+
+  const bcScanBlock_t space = bcScanSet(' ');
+  const bcScanBlock_t tab = bcScanSet('\t');
+  for (;; head += BC_SCAN_BLOCK)
+  {
+    bcScanBlock_t block = bcScanLoad(head);
+    uint32_t other = ~bcScanMask(bcScanOr(bcScanEq(block, space), bcScanEq(block, tab))) & BC_SCAN_ALL;
+    if (other != 0)
+    {
+      return head + bcScanFirst(other);
+    }
+  }
+}
+
+BC_SCAN_NO_SANITIZE
+const char* bcScanId(const char* head)
+{
+  for (; !bcScanAligned(head); ++head)
+  {
+    if (!bcScanIsId(*head))
+    {
+      return head;
+    }
+  }
+
+  // Comparisons are signed, so characters above 0x7f are never in ranges.
+  // Setting 0x20 bit folds upper case letters into lower case and moves
+  // other characters out of letter range.
+  const bcScanBlock_t lowerBit = bcScanSet(0x20);
+  const bcScanBlock_t beforeA = bcScanSet('a' - 1);
+  const bcScanBlock_t afterZ = bcScanSet('z' + 1);
+  const bcScanBlock_t before0 = bcScanSet('0' - 1);
+  const bcScanBlock_t after9 = bcScanSet('9' + 1);
+  const bcScanBlock_t underscore = bcScanSet('_');
+  for (;; head += BC_SCAN_BLOCK)
+  {
+    bcScanBlock_t block = bcScanLoad(head);
+    bcScanBlock_t lower = bcScanOr(block, lowerBit);
+    bcScanBlock_t letter = bcScanAnd(bcScanGt(lower, beforeA), bcScanGt(afterZ, lower));
+    bcScanBlock_t digit = bcScanAnd(bcScanGt(block, before0), bcScanGt(after9, block));
+    bcScanBlock_t id = bcScanOr(bcScanOr(letter, digit), bcScanEq(block, underscore));
+
+    uint32_t other = ~bcScanMask(id) & BC_SCAN_ALL;
+    if (other != 0)
+    {
+      return head + bcScanFirst(other);
+    }
+  }
+}
+
+BC_SCAN_NO_SANITIZE
+const char* bcScanQuote(const char* head)
+{
+  for (; !bcScanAligned(head); ++head)
+  {
+    if ((*head == '"') || (*head == '\0'))
+    {
+      return head;
+    }
+  }
+
+  const bcScanBlock_t quote = bcScanSet('"');
+  const bcScanBlock_t zero = bcScanSet('\0');
+  for (;; head += BC_SCAN_BLOCK)
+  {
+    bcScanBlock_t block = bcScanLoad(head);
+    uint32_t found = bcScanMask(bcScanOr(bcScanEq(block, quote), bcScanEq(block, zero)));
+    if (found != 0)
+    {
+      return head + bcScanFirst(found);
+    }
+  }
+}
+
+#else
+
+const char* bcScanSpaces(const char* head)
+{
+  while (bcScanIsSpace(*head))
+  {
+    ++head;
+  }
+  return head;
+}
+
+const char* bcScanId(const char* head)
+{
+  while (bcScanIsId(*head))
+  {
+    ++head;
+  }
+  return head;
+}
+
+const char* bcScanQuote(const char* head)
+{
+  while ((*head != '"') && (*head != '\0'))
+  {
+    ++head;
+  }
+  return head;
+}
+
+#endif
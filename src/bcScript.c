@@ -0,0 +1,328 @@
+/**
+ * Reloadable scripts.
+ *
+ * Script source is split into top-level statements by lines, and every
+ * statement is compiled into its own code stream. On reload, statements of
+ * new source are looked up among previous ones by their text, and found
+ * code streams are moved to new statement list.
+ */
+#include <bcPrivate.h>
+#include <badcode.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t bcScriptHash(const char* code, size_t len)
+{ // FNV-1a
+  uint64_t hash = UINT64_C(0xcbf29ce484222325);
+  for (size_t i = 0; i < len; ++i)
+  {
+    hash ^= (uint8_t) code[i];
+    hash *= UINT64_C(0x100000001b3);
+  }
+  return hash;
+}
+
+/**
+ * Find end of top-level statement. Statement continues on indented lines
+ * and after line continuation, empty line ends it.
+ */
+static const char* bcScriptStatementEnd(const char* head)
+{
+  const char* line = head;
+  for (;;)
+  {
+    const char* newline = strchr(line, '\n');
+    if (newline == NULL)
+    {
+      return line + strlen(line);
+    }
+
+    const char* last = newline;
+    while ((last > line) && ((last[-1] == ' ') || (last[-1] == '\t')))
+    {
+      --last;
+    }
+
+    int continued = (last > line) && (last[-1] == '\\');
+    line = newline + 1;
+    if (!continued && (*line != ' ') && (*line != '\t'))
+    {
+      return line;
+    }
+  }
+}
+
+/**
+ * Compile statement, which is NUL-terminated in place.
+ */
+static bcStatus_t bcScriptStatementCompile(const char* code, bcCodeStream_t* cs)
+{
+  bcTree_t* tree = NULL;
+  bcStatus_t status = bcParseProgram(code, &tree);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  status = bcCodeStreamInit(cs);
+  if (status == BC_OK)
+  {
+    status = bcCodeStreamCompile(cs, tree);
+    if (status != BC_OK)
+    {
+      bcCodeStreamCleanup(cs);
+    }
+  }
+
+  bcTreeCleanup(tree);
+  return status;
+}
+
+static void bcScriptStatementsCleanup(bcScriptStatement_t* statements, size_t count)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    bcCodeStreamCleanup(&statements[i].code);
+  }
+  free(statements);
+}
+
+/**
+ * Split source into statements and compile them. Statements, which are
+ * found in previous script, are not compiled and get no code yet.
+ *
+ * @param[in] script previous script
+ * @param[in,out] source new source copy, it is modified while statements are compiled
+ * @param[out] pStatements new statements
+ * @param[out] pCount number of new statements
+ * @param[out] pReused for every new statement index of previous one, or SIZE_MAX
+ * @param[out] pCompiled number of compiled statements
+ */
+static bcStatus_t bcScriptSplit(
+  const bcScript_t* script,
+  char* source,
+  bcScriptStatement_t** pStatements,
+  size_t* pCount,
+  size_t** pReused,
+  size_t* pCompiled
+)
+{
+  //
+  // Previous statements are indexed by open addressing hash table of
+  // statement index + 1. Statements with the same source can repeat, so
+  // every previous statement can be reused only once.
+  //
+  size_t tableSize = 1;
+  while (tableSize < script->count*2)
+  {
+    tableSize *= 2;
+  }
+
+  size_t* table = (size_t*) calloc(tableSize, sizeof(size_t));
+  uint8_t* taken = (uint8_t*) calloc(script->count + 1, sizeof(uint8_t));
+  if ((table == NULL) || (taken == NULL))
+  {
+    free(table);
+    free(taken);
+    return BC_NO_MEMORY;
+  }
+
+  for (size_t i = 0; i < script->count; ++i)
+  {
+    size_t slot = (size_t) script->statements[i].hash & (tableSize - 1);
+    while (table[slot] != 0)
+    {
+      slot = (slot + 1) & (tableSize - 1);
+    }
+    table[slot] = i + 1;
+  }
+
+  bcStatus_t status = BC_OK;
+  bcScriptStatement_t* statements = NULL;
+  size_t* reused = NULL;
+  size_t count = 0;
+  size_t cap = 0;
+  size_t compiled = 0;
+
+  for (char* head = source; *head != '\0';)
+  {
+    char* end = (char*) bcScriptStatementEnd(head);
+    size_t len = (size_t) (end - head);
+    uint64_t hash = bcScriptHash(head, len);
+
+    size_t found = SIZE_MAX;
+    for (size_t slot = (size_t) hash & (tableSize - 1); table[slot] != 0; slot = (slot + 1) & (tableSize - 1))
+    {
+      const bcScriptStatement_t* statement = &script->statements[table[slot] - 1];
+      if (!taken[table[slot] - 1]
+        && (statement->hash == hash)
+        && (statement->len == len)
+        && (memcmp(script->source + statement->offset, head, len) == 0))
+      {
+        found = table[slot] - 1;
+        taken[found] = 1;
+        break;
+      }
+    }
+
+    bcCodeStream_t code;
+    memset(&code, 0, sizeof(bcCodeStream_t));
+    if (found == SIZE_MAX)
+    {
+      char next = *end;
+      *end = '\0';
+      status = bcScriptStatementCompile(head, &code);
+      *end = next;
+
+      if (status == BC_EMPTY_EXPR)
+      { // empty lines are not kept
+        status = BC_OK;
+        head = end;
+        continue;
+      }
+
+      if (status != BC_OK)
+      {
+        break;
+      }
+      ++compiled;
+    }
+
+    if (count == cap)
+    {
+      cap = (cap == 0)? 16 : cap*2;
+      bcScriptStatement_t* grown = (bcScriptStatement_t*) realloc(statements, cap*sizeof(bcScriptStatement_t));
+      size_t* grownReused = (grown != NULL)? (size_t*) realloc(reused, cap*sizeof(size_t)) : NULL;
+      if (grown != NULL)
+      {
+        statements = grown;
+      }
+      if (grownReused != NULL)
+      {
+        reused = grownReused;
+      }
+
+      if ((grown == NULL) || (grownReused == NULL))
+      {
+        bcCodeStreamCleanup(&code);
+        status = BC_NO_MEMORY;
+        break;
+      }
+    }
+
+    statements[count].hash = hash;
+    statements[count].offset = (size_t) (head - source);
+    statements[count].len = len;
+    statements[count].code = code;
+    reused[count] = found;
+    ++count;
+
+    head = end;
+  }
+
+  free(table);
+  free(taken);
+
+  if (status != BC_OK)
+  {
+    bcScriptStatementsCleanup(statements, count);
+    free(reused);
+    return status;
+  }
+
+  *pStatements = statements;
+  *pCount = count;
+  *pReused = reused;
+  *pCompiled = compiled;
+  return BC_OK;
+}
+
+BCAPI bcStatus_t bcScriptReload(BC_SCRIPT script, const char* code, size_t* pCompiled)
+{
+  if ((script == NULL) || (code == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  size_t size = strlen(code) + 1;
+  char* source = (char*) malloc(size);
+  if (source == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+  memcpy(source, code, size);
+
+  bcScriptStatement_t* statements = NULL;
+  size_t count = 0;
+  size_t* reused = NULL;
+  size_t compiled = 0;
+  bcStatus_t status = bcScriptSplit(script, source, &statements, &count, &reused, &compiled);
+  if (status != BC_OK)
+  {
+    free(source);
+    return status;
+  }
+
+  // code of reused statements is moved, the rest is freed with old list
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (reused[i] != SIZE_MAX)
+    {
+      statements[i].code = script->statements[reused[i]].code;
+      memset(&script->statements[reused[i]].code, 0, sizeof(bcCodeStream_t));
+    }
+  }
+  free(reused);
+
+  bcScriptStatementsCleanup(script->statements, script->count);
+  free(script->source);
+
+  script->source = source;
+  script->count = count;
+  script->statements = statements;
+
+  if (pCompiled != NULL)
+  {
+    *pCompiled = compiled;
+  }
+  return BC_OK;
+}
+
+BCAPI bcStatus_t bcScriptCompile(const char* code, BC_SCRIPT* pScript)
+{
+  if ((code == NULL) || (pScript == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  bcScript_t* script = (bcScript_t*) malloc(sizeof(bcScript_t));
+  if (script == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  script->source = NULL;
+  script->count = 0;
+  script->statements = NULL;
+
+  bcStatus_t status = bcScriptReload(script, code, NULL);
+  if (status != BC_OK)
+  {
+    free(script);
+    return status;
+  }
+
+  *pScript = script;
+  return BC_OK;
+}
+
+BCAPI void bcScriptDelete(BC_SCRIPT script)
+{
+  if (script != NULL)
+  {
+    bcScriptStatementsCleanup(script->statements, script->count);
+    free(script->source);
+    free(script);
+  }
+}
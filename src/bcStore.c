@@ -0,0 +1,398 @@
+/**
+ * Global variables shared by processes.
+ *
+ * Store is named POSIX shared memory segment, which is written by single
+ * process and read by any number of others. Segment layout:
+ *
+ *   header:   bcStoreHeader_t
+ *   table:    bcStoreEntry_t[tableSize], open addressing by name hash
+ *   heap:     names and values, appended by writer
+ *
+ * Values are kept as complete value structures with BC_REF_STATIC counter.
+ * They have no pointers, so every process maps segment at any address and
+ * uses values in place, without copying them. Heap is never reused, so
+ * value read by process stays valid, while segment is mapped.
+ *
+ * Writer publishes new value by atomic store of its offset to entry, and
+ * new entry by atomic store of name offset after value, so readers take no
+ * locks and never see partially written data.
+ */
+#include <bcPrivate.h>
+#include <bcSync.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Version of segment layout, bumped on every incompatible change.
+ */
+#define BC_STORE_VERSION (1)
+
+/**
+ * Heap allocation alignment.
+ */
+#define BC_STORE_ALIGN (16)
+
+typedef struct bcStoreHeader_t
+{
+  char magic[4];      /**< "BCSM" */
+  uint32_t version;   /**< BC_STORE_VERSION */
+  uint64_t size;      /**< Segment size */
+  uint64_t tableSize; /**< Number of table entries, power of two */
+  uint64_t count;     /**< Used table entries, updated by writer only */
+  uint64_t used;      /**< Heap end offset, updated by writer only */
+} bcStoreHeader_t;
+
+typedef struct bcStoreEntry_t
+{
+  uint64_t hash;  /**< Name hash */
+  uint64_t name;  /**< Name offset, 0 for free entry */
+  uint64_t value; /**< Value offset */
+} bcStoreEntry_t;
+
+/**
+ * Mapped store.
+ */
+typedef struct bcStore_t
+{
+  uint8_t* data;  /**< Segment mapping */
+  size_t size;    /**< Segment size */
+  int writer;     /**< Not 0 if store was created by this process */
+} bcStore_t;
+
+static uint64_t bcStoreHash(const char* name)
+{ // FNV-1a
+  uint64_t hash = UINT64_C(0xcbf29ce484222325);
+  for (; *name != '\0'; ++name)
+  {
+    hash ^= (uint8_t) *name;
+    hash *= UINT64_C(0x100000001b3);
+  }
+  return hash;
+}
+
+static bcStoreHeader_t* bcStoreHeader(const BC_STORE store)
+{
+  return (bcStoreHeader_t*) store->data;
+}
+
+static bcStoreEntry_t* bcStoreTable(const BC_STORE store)
+{
+  return (bcStoreEntry_t*) (store->data + sizeof(bcStoreHeader_t));
+}
+
+/**
+ * Find entry of name, or free entry, where it is added.
+ *
+ * @return entry, or NULL if table of malformed segment has no free entries
+ */
+static bcStoreEntry_t* bcStoreFind(const BC_STORE store, const char* name, uint64_t hash)
+{
+  uint64_t mask = bcStoreHeader(store)->tableSize - 1;
+  bcStoreEntry_t* table = bcStoreTable(store);
+  for (uint64_t n = 0, i = hash & mask; n <= mask; ++n, i = (i + 1) & mask)
+  {
+    uint64_t nameOffset = bcAtomicLoad64(&table[i].name);
+    if (nameOffset == 0)
+    {
+      return &table[i];
+    }
+
+    if ((table[i].hash == hash)
+      && (nameOffset < store->size)
+      && (strncmp((const char*) store->data + nameOffset, name, store->size - nameOffset) == 0))
+    {
+      return &table[i];
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Get size of value structure, or 0 for values, which can't be stored.
+ */
+static size_t bcStoreValueSize(const BC_VALUE value)
+{
+  switch (value->type)
+  {
+  case BC_INTEGER:
+    return sizeof(bcInteger_t);
+  case BC_NUMBER:
+    return sizeof(bcNumber_t);
+  case BC_STRING:
+    return sizeof(bcString_t) + ((const bcString_t*) value)->len;
+  default:
+    // other values refer to process memory
+    return 0;
+  }
+}
+
+/**
+ * Allocate heap space. Only writer calls it.
+ */
+static bcStatus_t bcStoreAlloc(BC_STORE store, size_t size, uint64_t* pOffset)
+{
+  bcStoreHeader_t* header = bcStoreHeader(store);
+  uint64_t offset = (header->used + BC_STORE_ALIGN - 1) & ~(uint64_t) (BC_STORE_ALIGN - 1);
+  if ((offset > store->size) || (size > store->size - offset))
+  {
+    return BC_OVERFLOW;
+  }
+
+  header->used = offset + size;
+  *pOffset = offset;
+  return BC_OK;
+}
+
+#ifndef _WIN32
+
+/**
+ * Map segment and check its layout.
+ */
+static bcStatus_t bcStoreMap(int fd, int writer, BC_STORE* pStore)
+{
+  struct stat info;
+  if ((fstat(fd, &info) != 0) || ((size_t) info.st_size < sizeof(bcStoreHeader_t)))
+  {
+    return BC_MALFORMED_CODE;
+  }
+
+  bcStore_t* store = (bcStore_t*) malloc(sizeof(bcStore_t));
+  if (store == NULL)
+  {
+    return BC_NO_MEMORY;
+  }
+
+  int protection = writer ? (PROT_READ | PROT_WRITE) : PROT_READ;
+  void* data = mmap(NULL, (size_t) info.st_size, protection, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED)
+  {
+    free(store);
+    return BC_IO_ERROR;
+  }
+
+  store->data = (uint8_t*) data;
+  store->size = (size_t) info.st_size;
+  store->writer = writer;
+
+  const bcStoreHeader_t* header = bcStoreHeader(store);
+  if (!writer
+    && ((memcmp(header->magic, "BCSM", 4) != 0)
+      || (header->version != BC_STORE_VERSION)
+      || (header->size != store->size)
+      || (header->tableSize == 0)
+      || ((header->tableSize & (header->tableSize - 1)) != 0)
+      || (header->tableSize > (store->size - sizeof(bcStoreHeader_t)) / sizeof(bcStoreEntry_t))))
+  {
+    bcStoreDelete(store);
+    return BC_MALFORMED_CODE;
+  }
+
+  *pStore = store;
+  return BC_OK;
+}
+
+#endif
+
+BCAPI bcStatus_t bcStoreCreate(const char* name, size_t size, BC_STORE* pStore)
+{
+  if ((name == NULL) || (pStore == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+#ifndef _WIN32
+  // table takes about sixteenth of segment
+  uint64_t tableSize = 16;
+  while (tableSize * sizeof(bcStoreEntry_t) * 16 <= size)
+  {
+    tableSize *= 2;
+  }
+
+  size_t heapStart = sizeof(bcStoreHeader_t) + (size_t) tableSize * sizeof(bcStoreEntry_t);
+  if (size <= heapStart)
+  {
+    return BC_INVALID_ARG;
+  }
+
+  int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+  if (fd < 0)
+  {
+    return BC_IO_ERROR;
+  }
+
+  // new segment is zero-filled, so all entries are free
+  if (ftruncate(fd, (off_t) size) != 0)
+  {
+    close(fd);
+    shm_unlink(name);
+    return BC_IO_ERROR;
+  }
+
+  BC_STORE store = NULL;
+  bcStatus_t status = bcStoreMap(fd, 1, &store);
+  close(fd);
+  if (status != BC_OK)
+  {
+    shm_unlink(name);
+    return status;
+  }
+
+  bcStoreHeader_t* header = bcStoreHeader(store);
+  header->size = size;
+  header->tableSize = tableSize;
+  header->count = 0;
+  header->used = heapStart;
+  header->version = BC_STORE_VERSION;
+  memcpy(header->magic, "BCSM", 4);
+
+  *pStore = store;
+  return BC_OK;
+#else
+  (void) size;
+  return BC_NOT_IMPLEMENTED;
+#endif
+}
+
+BCAPI bcStatus_t bcStoreOpen(const char* name, BC_STORE* pStore)
+{
+  if ((name == NULL) || (pStore == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+#ifndef _WIN32
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0)
+  {
+    return BC_IO_ERROR;
+  }
+
+  bcStatus_t status = bcStoreMap(fd, 0, pStore);
+  close(fd);
+  return status;
+#else
+  return BC_NOT_IMPLEMENTED;
+#endif
+}
+
+BCAPI void bcStoreDelete(BC_STORE store)
+{
+  if (store != NULL)
+  {
+#ifndef _WIN32
+    munmap(store->data, store->size);
+#endif
+    free(store);
+  }
+}
+
+BCAPI bcStatus_t bcStoreUnlink(const char* name)
+{
+  if (name == NULL)
+  {
+    return BC_INVALID_ARG;
+  }
+
+#ifndef _WIN32
+  return (shm_unlink(name) == 0) ? BC_OK : BC_IO_ERROR;
+#else
+  return BC_NOT_IMPLEMENTED;
+#endif
+}
+
+BCAPI bcStatus_t bcStoreSet(BC_STORE store, const char* name, const BC_VALUE value)
+{
+  if ((store == NULL) || (name == NULL) || (value == NULL))
+  {
+    return BC_INVALID_ARG;
+  }
+
+  if (!store->writer)
+  {
+    return BC_NOT_IMPLEMENTED;
+  }
+
+  size_t valueSize = bcStoreValueSize(value);
+  if (valueSize == 0)
+  {
+    return BC_NOT_IMPLEMENTED;
+  }
+
+  bcStoreHeader_t* header = bcStoreHeader(store);
+  uint64_t hash = bcStoreHash(name);
+  bcStoreEntry_t* entry = bcStoreFind(store, name, hash);
+  if ((entry == NULL) || ((entry->name == 0) && ((header->count + 1) * 4 > header->tableSize * 3)))
+  {
+    return BC_OVERFLOW;
+  }
+
+  uint64_t valueOffset;
+  bcStatus_t status = bcStoreAlloc(store, valueSize, &valueOffset);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+
+  uint64_t nameOffset = 0;
+  if (entry->name == 0)
+  {
+    size_t nameSize = strlen(name) + 1;
+    status = bcStoreAlloc(store, nameSize, &nameOffset);
+    if (status != BC_OK)
+    {
+      header->used = valueOffset;
+      return status;
+    }
+    memcpy(store->data + nameOffset, name, nameSize);
+  }
+
+  BC_VALUE stored = (BC_VALUE) (store->data + valueOffset);
+  memcpy(stored, value, valueSize);
+  stored->refCount = BC_REF_STATIC;
+
+  bcAtomicStore64(&entry->value, valueOffset);
+  if (nameOffset != 0)
+  {
+    entry->hash = hash;
+    bcAtomicStore64(&entry->name, nameOffset);
+    ++header->count;
+  }
+  return BC_OK;
+}
+
+BCAPI BC_VALUE bcStoreGet(const BC_STORE store, const char* name)
+{
+  if ((store == NULL) || (name == NULL))
+  {
+    return NULL;
+  }
+
+  bcStoreEntry_t* entry = bcStoreFind(store, name, bcStoreHash(name));
+  if ((entry == NULL) || (bcAtomicLoad64(&entry->name) == 0))
+  {
+    return NULL;
+  }
+
+  // string length is read only after whole structure is known to fit
+  uint64_t valueOffset = bcAtomicLoad64(&entry->value);
+  if ((valueOffset % BC_STORE_ALIGN != 0) || (valueOffset > store->size) || (store->size - valueOffset < sizeof(bcString_t)))
+  {
+    return NULL;
+  }
+
+  BC_VALUE value = (BC_VALUE) (store->data + valueOffset);
+  size_t valueSize = bcStoreValueSize(value);
+  if ((valueSize == 0) || (valueSize > store->size - valueOffset) || (value->refCount != BC_REF_STATIC))
+  {
+    return NULL;
+  }
+  return value;
+}
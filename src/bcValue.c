@@ -1,4 +1,5 @@
 #include <bcPrivate.h>
+#include <bcSync.h>
 
 #include <stdlib.h>
 #include <string.h>
@@ -12,7 +13,25 @@ BCAPI bcStatus_t bcValueCleanup(BC_VALUE value)
     return BC_INVALID_ARG;
   }
 
-  --value->refCount;
+  int32_t refCount = bcAtomicLoadRelaxed32(&value->refCount);
+  if (refCount == BC_REF_STATIC)
+  {
+    return BC_OK;
+  }
+
+  if (refCount < 0)
+  { // shared value, sign never changes after value was published
+    if (bcAtomicAdd32(&value->refCount, -1) != BC_REF_SHARED)
+    {
+      return BC_OK;
+    }
+    value->refCount = 0;
+  }
+  else
+  {
+    --value->refCount;
+  }
+
   if (value->refCount == 0)
   {
     switch (value->type)
@@ -25,10 +44,25 @@ BCAPI bcStatus_t bcValueCleanup(BC_VALUE value)
     case BC_CODE:
       {
         bcCode_t* code = (bcCode_t*) value;
+        if (code->tree != NULL)
+        {
+          bcTreeCleanup(code->tree);
+        }
         bcCodeStreamCleanup(&code->code);
         free(code);
       }
       return BC_OK;
+    case BC_FUNC:
+      {
+        bcFunc_t* func = (bcFunc_t*) value;
+        if (func->finalize != NULL)
+        {
+          func->finalize(func);
+        }
+        bcCodeStreamCleanup(&func->code);
+        free(func);
+      }
+      return BC_OK;
     default:
       return BC_NOT_IMPLEMENTED;
     }
@@ -44,10 +78,31 @@ BCAPI BC_VALUE bcValueCopy(const BC_VALUE val)
   }
 
   BC_VALUE result = (BC_VALUE) val;
-  ++result->refCount;
+  int32_t refCount = bcAtomicLoadRelaxed32(&result->refCount);
+  if (refCount == BC_REF_STATIC)
+  {
+    return result;
+  }
+
+  if (refCount < 0)
+  {
+    bcAtomicAdd32(&result->refCount, 1);
+  }
+  else
+  {
+    ++result->refCount;
+  }
   return result;
 }
 
+void bcValueShare(BC_VALUE value)
+{
+  if (value->refCount > 0)
+  {
+    value->refCount += BC_REF_SHARED;
+  }
+}
+
 BCAPI BC_VALUE bcValueInteger(int64_t val)
 {
   bcInteger_t* result = (bcInteger_t*) malloc(sizeof(bcInteger_t));
@@ -80,8 +135,12 @@ BCAPI BC_VALUE bcValueNumber(double val)
 
 BCAPI BC_VALUE bcValueString(const char* str)
 {
-  size_t len = strlen(str) + 1;
-  bcString_t* result = (bcString_t*) malloc(sizeof(bcString_t) + len);
+  return bcValueStringSlice(str, strlen(str));
+}
+
+BC_VALUE bcValueStringSlice(const char* str, size_t len)
+{
+  bcString_t* result = (bcString_t*) malloc(sizeof(bcString_t) + len + 1);
   if (result == NULL)
   {
     return NULL;
@@ -89,8 +148,9 @@ BCAPI BC_VALUE bcValueString(const char* str)
 
   result->head.type = BC_STRING;
   result->head.refCount = 1;
-  result->len = len;
+  result->len = len + 1;
   memcpy(result->data, str, len);
+  result->data[len] = '\0';
 
   return &result->head;
 }
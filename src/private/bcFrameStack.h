@@ -0,0 +1,73 @@
+
+#pragma once
+#ifndef DECI_SPACE_BADCODE_FRAME_STACK_HEADER
+#define DECI_SPACE_BADCODE_FRAME_STACK_HEADER
+
+/**
+ * Saved interpreter state to continue from, when called code ends.
+ */
+typedef struct bcFrame_t
+{
+  const struct bcCodeStream_t* code; /**< Code stream to continue */
+  const uint8_t* cursor;             /**< Last executed opcode in code */
+  BC_VALUE* base;                    /**< First frame slot of code */
+  int call;                          /**< Not 0 if frame made by function call, 0 for if-statement body */
+} bcFrame_t;
+
+/**
+ * Simple stack for bcFrame_t.
+ */
+typedef struct bcFrameStack_t
+{
+  size_t total;       /**< Maximum stack size */
+  bcFrame_t* bottom;  /**< First element in stack */
+  bcFrame_t* top;     /**< Stack top */
+} bcFrameStack_t;
+
+/**
+ * Initialize stack with of given size.
+ * 
+ * @param[in] pStack pointer to stack structure to initialize
+ * @param[in] total total size of stack
+ * 
+ * @return
+ *    BC_INVALID_ARG - (pStack == NULL) or (total == NULL)
+ *    BC_NO_MEMORY - if memory allocation failed
+ *    BC_OK - stack allocated.
+ */
+bcStatus_t bcFrameStackInit(bcFrameStack_t* pStack, size_t total);
+
+/**
+ * Cleanup given stack.
+ * 
+ * @param[in] pStack pointer to stack to cleanup.
+ * 
+ * @return 
+ *    BC_INVALID_ARG - if (pStack == NULL)
+ *    BC_OK - stack memory cleaned.
+ */
+bcStatus_t bcFrameStackCleanup(bcFrameStack_t* pStack);
+
+/**
+ * Push frame on stack.
+ * 
+ * @param[in] pStack pointer to valid stack
+ * @param[in] frame frame to copy on stack
+ * 
+ * @return
+ *    BC_INVALID_ARG - if (pStack == NULL) || (frame == NULL)
+ *    BC_OVERFLOW - if total stack size exceeded.
+ *    BC_OK - new frame added to stack
+ */
+bcStatus_t bcFrameStackPush(bcFrameStack_t* pStack, const bcFrame_t* frame);
+
+/**
+ * Pop frame from stack.
+ * 
+ * @param[in] pStack pointer to valid stack
+ * 
+ * @return BC_OK if no erros, error code otherwise
+ */
+bcStatus_t bcFrameStackPop(bcFrameStack_t* pStack);
+
+#endif /* DECI_SPACE_BADCODE_FRAME_STACK_HEADER */
@@ -10,62 +10,150 @@ typedef enum bcTreeItemType_t
   TIT_BIN_OP,
   TIT_UN_OP,
   TIT_CONSTANT,
-  TIT_IF_STATEMENT
+  TIT_IF_STATEMENT,
+  TIT_FUNCTION,
+  TIT_CALL
 } bcTreeItemType_t;
 
+/**
+ * Index of item in its arena.
+ */
+typedef uint32_t bcTreeRef_t;
+
+/**
+ * No item, first arena item is never used.
+ */
+#define BC_TREE_NONE ((bcTreeRef_t) 0)
+
+/**
+ * Parse tree item.
+ * 
+ * Items refer to each other by arena indices, so whole tree lies in one
+ * contiguous array.
+ */
 typedef struct bcTreeItem_t
 {
   bcTreeItemType_t type;
-  struct bcTreeItem_t* next;
+  bcTreeRef_t next; /**< Next item in list */
+
+  union
+  {
+    struct
+    {
+      int tag;
+      bcTreeRef_t lbr;
+      bcTreeRef_t rbr;
+    } binOp;
+
+    struct
+    {
+      int tag;
+      bcTreeRef_t br;
+    } unOp;
+
+    struct
+    {
+      uint32_t value; /**< Index in arena values */
+    } constant;
+
+    struct
+    {
+      bcTreeRef_t cond;
+      bcTreeRef_t body; /**< List of body statements */
+    } ifStatement;
+
+    struct
+    {
+      uint32_t name;      /**< Index in arena values */
+      bcTreeRef_t params; /**< List of parameter name constants */
+      bcTreeRef_t body;   /**< List of body statements */
+    } function;
+
+    struct
+    {
+      bcTreeRef_t func;
+      bcTreeRef_t args; /**< List of argument expressions */
+    } call;
+  } as;
 } bcTreeItem_t;
 
-typedef struct bcBinOp_t
+/**
+ * Storage of parse tree items.
+ * 
+ * Items are never freed one by one, arena is released as whole, when last 
+ * tree referring it is cleaned up.
+ */
+typedef struct bcTreeArena_t
 {
-  bcTreeItem_t head;
-  int tag;
-  bcTreeItem_t* lbr;
-  bcTreeItem_t* rbr;
-} bcBinOp_t;
-
-typedef struct bcUnOp_t
-{
-  bcTreeItem_t head;
-  int tag;
-  bcTreeItem_t* br;
-} bcUnOp_t;
-
-typedef struct bcConstant_t
-{
-  bcTreeItem_t head;
-  BC_VALUE constVal;
-} bcConstant_t;
-
+  int32_t refCount;     /**< Trees and parsers referring arena */
+  uint32_t size;        /**< Items used, including unused first one */
+  uint32_t cap;         /**< Items capacity */
+  bcTreeItem_t* items;  /**< Items */
+  uint32_t valueSize;   /**< Values used */
+  uint32_t valueCap;    /**< Values capacity */
+  BC_VALUE* values;     /**< Constant values and function names, owned by arena */
+} bcTreeArena_t;
+
+/**
+ * Parse tree, or its part, which is compiled separately.
+ */
 typedef struct bcTree_t
 {
-  bcTreeItem_t* root;
+  bcTreeArena_t* arena; /**< Referenced arena */
+  bcTreeRef_t root;     /**< First statement, or BC_TREE_NONE */
 } bcTree_t;
 
-typedef struct bcIfStatement_t
+/**
+ * Create empty arena.
+ * 
+ * @return NULL on errors, new arena referenced once otherwise
+ */
+bcTreeArena_t* bcTreeArenaNew(void);
+
+/**
+ * Drop arena reference, arena is freed with all its items and values, 
+ * when no references left.
+ * 
+ * @param arena[in] valid arena or NULL
+ */
+void bcTreeArenaRelease(bcTreeArena_t* arena);
+
+static inline bcTreeItem_t* bcTreeItem(const bcTreeArena_t* arena, bcTreeRef_t ref)
 {
-  bcTreeItem_t head;
-  bcTreeItem_t* cond;
-  bcTree_t* body;
-} bcIfStatement_t;
+  return &arena->items[ref];
+}
 
-bcStatus_t bcTreeItemCleanup(bcTreeItem_t* treeItem);
+static inline BC_VALUE bcTreeValue(const bcTreeArena_t* arena, uint32_t index)
+{
+  return arena->values[index];
+}
 
 bcStatus_t bcTreeCleanup(bcTree_t* tree);
 
-bcTreeItem_t* bcBinOp(bcTreeItem_t* lbr, bcTreeItem_t* rbr, int tag);
+//
+// Item constructors return BC_TREE_NONE on errors. Arena may be moved by
+// them, so item pointers must not be kept across calls.
+//
+
+bcTreeRef_t bcBinOp(bcTreeArena_t* arena, bcTreeRef_t lbr, bcTreeRef_t rbr, int tag);
+
+bcTreeRef_t bcUnOp(bcTreeArena_t* arena, bcTreeRef_t br, int tag);
+
+bcTreeRef_t bcConstant(bcTreeArena_t* arena, const BC_VALUE value);
 
-bcTreeItem_t* bcUnOp(bcTreeItem_t* br, int tag);
+bcTreeRef_t bcIfStatement(bcTreeArena_t* arena, bcTreeRef_t cond, bcTreeRef_t body);
 
-bcTreeItem_t* bcConstant(const BC_VALUE value);
+bcTreeRef_t bcFunction(bcTreeArena_t* arena, const BC_VALUE name, bcTreeRef_t params, bcTreeRef_t body);
 
-bcTreeItem_t* bcIfStatement(bcTreeItem_t* cond, bcTreeItem_t* body);
+bcTreeRef_t bcCall(bcTreeArena_t* arena, bcTreeRef_t func, bcTreeRef_t args);
 
-bcTreeItem_t* bcAppend(bcTreeItem_t* head, bcTreeItem_t* tail);
+bcTreeRef_t bcAppend(bcTreeArena_t* arena, bcTreeRef_t head, bcTreeRef_t tail);
 
-bcTree_t* bcTree(bcTreeItem_t* root);
+/**
+ * Create tree of arena items, starting from root. Tree references arena.
+ * 
+ * @return NULL on errors, new tree otherwise
+ */
+bcTree_t* bcTree(bcTreeArena_t* arena, bcTreeRef_t root);
 
 #endif /* DECI_SPACE_BADCODE_PRIVATE_PARSE_TREE_HEADER */
@@ -11,6 +11,7 @@
 #include <badcode.h>
 #include "bcValue.h"
 #include "bcValueStack.h"
+#include "bcFrameStack.h"
 #include "bcParseTree.h"
 
 /**
@@ -19,6 +20,12 @@
  */
 #define BC_CORE_VALUE_STACK_SIZE (4096)
 
+/**
+ * Maximum frame stack size. Interpreter exits with BC_OVERFLOW if nested 
+ * function calls and if-statement bodies exceed this size.
+ */
+#define BC_CORE_FRAME_STACK_SIZE (256)
+
 /**
  * Initial code stream opcode capacity. It increases using CAP1 = CAP*3/2
  * formula when actual size exceeds current capacity, where CAP1 - new capacity,
@@ -40,12 +47,74 @@
  */
 #define BC_CORE_GLOBAL_INITIAL_CAP (2)
 
+/**
+ * Initial size of global variables hash table, must be power of two. It is
+ * doubled to keep at least half of slots free.
+ */
+#define BC_CORE_GLOBAL_TABLE_INITIAL_SIZE (16)
+
+/**
+ * Bits of global slot in slot cache entry of code stream, other bits keep
+ * tag of core, which filled the entry. Slots, which don't fit, aren't cached.
+ */
+#define BC_GLOBAL_SLOT_BITS (24)
+
+/**
+ * Mask of global slot in slot cache entry.
+ */
+#define BC_GLOBAL_SLOT_MASK ((UINT64_C(1) << BC_GLOBAL_SLOT_BITS) - 1)
+
+/**
+ * Initial parse tree arena capacity, in items. It increases using 
+ * CAP1 = CAP*3/2 formula when actual size exceeds current capacity, where 
+ * CAP1 - new capacity, CAP - old capacity.
+ */
+#define BC_TREE_ARENA_INITIAL_CAP (32)
+
+/**
+ * Default memory limit of compiled code cache in bytes, cache is off until
+ * enabled with bcCacheSetLimit.
+ */
+#define BC_CACHE_DEFAULT_LIMIT (0)
+
+/**
+ * Number of compiled code cache buckets, must be power of two.
+ */
+#define BC_CACHE_BUCKETS (1024)
+
+/**
+ * Evicted compiled code cache entries are released in batches of this many
+ * entries, so one grace period covers whole batch.
+ */
+#define BC_CACHE_RETIRE_BATCH (64)
+
+/**
+ * Number of compiled code cache stripes, threads are spread over them, so
+ * lookups from different threads don't update same counters.
+ */
+#define BC_CACHE_STRIPES (16)
+
+/**
+ * Initial size of streamed source line buffer, see bcCoreFeed.
+ */
+#define BC_CORE_FEED_INITIAL_CAP (256)
+
+/**
+ * Number of integer and number boxes, which are kept by core for reuse by 
+ * host push functions, see bcCorePushInteger.
+ */
+#define BC_CORE_SPARE_BOXES (8)
+
 /**
  * Interpreter bytecodes.
  * 
  * Only few bytecodes has additional arguments passed after it.
  * 
  * As an example: after BC_PSH follows byte encoding constant ID to push.
+ * 
+ * BC_CLL and BC_TCL are followed by argument count, BC_LDL and BC_STL are 
+ * followed by frame slot index. BC_LDG and BC_STG are followed by constant ID
+ * of global variable name, which is resolved to global slot at compile time.
  */
 typedef enum bcOp_t
 {
@@ -87,6 +156,12 @@ typedef enum bcOp_t
   BC_CLL, /**< A() */
   BC_LST, /**< toList(A) */
   BC_DCT, /**< toDict(A) */
+  BC_LDL, /**< push(local[A]) */
+  BC_STL, /**< local[A] <- B */
+  BC_TCL, /**< Tail call A() */
+  BC_RTN, /**< Return from function */
+  BC_LDG, /**< push(global[A]) */
+  BC_STG, /**< global[A] <- B */
   BC_OP_LAST, /**< Last valid opcode */
   BC_OP_TOTAL = 0xFF
 } bcOp_t;
@@ -104,14 +179,117 @@ typedef struct bcCodeStream_t
   size_t    conSize; /**< Total consts size     */
   BC_VALUE* cons;    /**< Constants             */
 
+  const struct bcImage_t* image; /**< Loaded image, opcodes are borrowed from, or NULL */
+  uint32_t imageOffset;          /**< Offset of code stream in image */
+
+  size_t slotSize; /**< Constants with slot cache entries */
+  uint64_t* slots; /**< Core tag and global slot of every name constant, or 0, accessed atomically */
 } bcCodeStream_t;
 
+/**
+ * Serialized program or core, loaded from file.
+ */
+typedef struct bcImage_t
+{
+  const uint8_t* data; /**< Image bytes */
+  size_t size;         /**< Image size */
+  int mapped;          /**< Not 0, when data is memory mapped file */
+  int32_t refCount;    /**< Program and not yet loaded globals, updated atomically */
+} bcImage_t;
+
+/**
+ * Compiled program, which can be executed many times on any core.
+ */
+typedef struct bcProgram_t
+{
+  bcCodeStream_t code; /**< Top-level code, HALT terminated */
+  bcImage_t* image;    /**< Image program was loaded from, or NULL */
+  int shared;          /**< Not 0 if code is shared by threads, see bcCodeStreamShare */
+} bcProgram_t;
+
+/**
+ * Top-level statement of script.
+ */
+typedef struct bcScriptStatement_t
+{
+  uint64_t hash;       /**< Hash of statement source */
+  size_t offset;       /**< Statement source offset in script source */
+  size_t len;          /**< Statement source length */
+  bcCodeStream_t code; /**< Statement code, HALT terminated */
+} bcScriptStatement_t;
+
+/**
+ * Program compiled by top-level statements, which can be reloaded.
+ * 
+ * Statements are separate code streams executed in order, so code of
+ * statements, which are not changed, is kept on reload.
+ */
+typedef struct bcScript_t
+{
+  char* source;                    /**< Copy of script source */
+  size_t count;                    /**< Number of statements */
+  bcScriptStatement_t* statements; /**< Statements in source order */
+} bcScript_t;
+
+/**
+ * Storage of global variable value.
+ */
+typedef enum bcGlobalBind_t
+{
+  BC_BIND_NONE = 0,  /**< Value is kept by global */
+  BC_BIND_INTEGER,   /**< Host int64_t */
+  BC_BIND_NUMBER,    /**< Host double */
+  BC_BIND_ACCESSORS, /**< Host getter and setter */
+  BC_BIND_IMAGE      /**< Value is not yet loaded from core image */
+} bcGlobalBind_t;
+
 typedef struct bcGlobalVar_t
 {
-  BC_VALUE value;
+  BC_VALUE value;      /**< Value, or box reused for host integer or number, NULL for other bindings */
+  bcGlobalBind_t bind; /**< Value storage */
+  union
+  {
+    int64_t* integer;
+    double* number;
+    struct
+    {
+      bcGetter_t get;
+      bcSetter_t set;
+      void* user;
+    } accessors;
+    struct
+    {
+      bcImage_t* image;
+      uint32_t offset;
+    } image;
+  } as;                /**< Host storage of bound global */
+  int frozen;          /**< Not 0 if global belongs to environment and never changes */
+  uint64_t hash;       /**< Name hash */
   char name[];
 } bcGlobalVar_t ,*BC_GLOBAL;
 
+/**
+ * Lexer token data.
+ * 
+ * Token is a slice of parsed source, so no memory is allocated by lexer.
+ * Values are created by bcTokenValue only for tokens, which parser keeps.
+ * 
+ * Parser can hold tokens, until statement is finished, so slice is given by
+ * offset in source chunk, see bcParseContext_t.
+ */
+typedef struct bcToken_t
+{
+  uint32_t chunk;    /**< Source chunk of statement */
+  size_t offset;     /**< Offset of first character in source chunk */
+  size_t len;        /**< Token text length */
+  bcDataType_t type; /**< Constant type, BC_NULL for tokens without value */
+  union
+  {
+    int64_t integer; /**< BC_INTEGER value */
+    double number;   /**< BC_NUMBER value */
+  } as;
+} bcToken_t;
+
 typedef struct bcParseContext_t
 {
   void* context;
@@ -119,27 +297,129 @@ typedef struct bcParseContext_t
 
   uint8_t indentStack[64];
   uint8_t* indentTop;
+
+  const char* source;   /**< Source chunk being parsed */
+  uint32_t chunk;       /**< Number of source chunk being parsed, counted from statement start */
+  char** chunks;        /**< Copies of previous source chunks of unfinished statement */
+
+  bcTreeArena_t* arena; /**< Arena of statement parse tree, created on first tree item */
+  bcTree_t* tree;       /**< Parse tree, set when program is reduced in parse tree mode */
+  int compile;          /**< Not 0, when top-level statements are compiled into code directly */
+  bcCodeStream_t code;  /**< Code top-level statements are compiled into, valid if compile is not 0 */
+  int depth;            /**< Blocks open, their statements are always built into parse tree */
+  bcStatus_t status;    /**< First error found by parser */
 } bcParseContext_t;
 
+/**
+ * Compiled code cache entry.
+ * 
+ * Entry is found by source text and lexer state, in which source was parsed.
+ */
+typedef struct bcCacheEntry_t
+{
+  struct bcCacheEntry_t* next; /**< Next entry in bucket, updated atomically */
+  struct bcCacheEntry_t* clockPrev; /**< Previous entry in CLOCK ring, guarded by cache lock */
+  struct bcCacheEntry_t* clockNext; /**< Next entry in CLOCK ring, or in retired list */
+  uint64_t hash;               /**< Hash of source and lexer state */
+  int32_t referenced;          /**< Not 0 if entry was hit since CLOCK hand passed it, updated atomically */
+  int32_t refCount;            /**< Cache and running cores references, updated atomically */
+  int newline;                 /**< Lexer newline flag before parsing */
+  int newlineAfter;            /**< Lexer newline flag after parsing */
+  size_t consumed;             /**< Bytes of source consumed by parser */
+  size_t size;                 /**< Approximate memory used by entry */
+  bcCodeStream_t code;         /**< Shared code stream, see bcCodeStreamShare */
+  size_t sourceLen;            /**< Source length */
+  char source[];               /**< Source text */
+} bcCacheEntry_t;
+
 typedef struct bcCode_t
 {
   bcValue_t head;
   bcCodeStream_t code;
+  bcTree_t* tree; /**< Parse tree to compile on first use, NULL when code is compiled */
 } bcCode_t;
 
+/**
+ * BC_FUNC.
+ * 
+ * Function arguments occupy first frame slots, other slots are used by 
+ * local variables.
+ */
+typedef struct bcFunc_t
+{
+  bcValue_t head;
+  size_t argCount;  /**< Number of arguments */
+  size_t slotCount; /**< Number of frame slots, including arguments */
+  bcCodeStream_t code;
+  int (*native)(BC_CORE core, BC_VALUE* base); /**< Ahead-of-time compiled body, or NULL */
+  void (*finalize)(struct bcFunc_t* func);      /**< Releases data of native function, or NULL */
+} bcFunc_t;
+
+/**
+ * Frozen global environment, see bcCoreFreeze.
+ * 
+ * Environment never changes after it was created, so it is read by cores on
+ * any thread without locks.
+ */
+struct bcEnv_t
+{
+  int32_t refCount;       /**< Host and core references, updated atomically */
+  BC_ENV base;            /**< Environment frozen before, or NULL */
+  size_t globalSize;
+  BC_GLOBAL* globals;     /**< Globals frozen into environment */
+  size_t globalTableSize; /**< Hash table size, power of two */
+  size_t* globalTable;    /**< Hash table of global indices + 1, 0 for free slots */
+};
+
+/**
+ * Global variable name used by compiled code of core, see bcCoreGlobalSlot.
+ */
+typedef struct bcGlobalSlot_t
+{
+  uint64_t hash;    /**< Name hash */
+  char* name;       /**< Variable name */
+  BC_GLOBAL global; /**< Variable, or NULL if it is not found yet */
+} bcGlobalSlot_t;
+
 /**
  * Interprerer evaluation core.
  */
 struct bcCore_t
 {
   bcValueStack_t stack;
+  bcFrameStack_t frames;
 
   size_t globalCap;
   size_t globalSize;
-  BC_GLOBAL* globals;
+  BC_GLOBAL* globals;       /**< Globals in order of definition */
+  size_t globalTableSize;   /**< Hash table size, power of two or 0 */
+  size_t* globalTable;      /**< Hash table of global indices + 1, 0 for free slots */
+
+  uint64_t slotTag;         /**< Tag of slot cache entries filled by core, never 0 */
+  uint32_t slotSize;
+  uint32_t slotCap;
+  bcGlobalSlot_t* slots;    /**< Global variable names by slot */
+  size_t slotTableSize;     /**< Hash table size, power of two or 0 */
+  uint32_t* slotTable;      /**< Hash table of slot + 1, 0 for free entries */
 
   bcParseContext_t parseContext;
   BC_VALUE result;
+
+  char* feed;      /**< Incomplete line of streamed source, see bcCoreFeed */
+  size_t feedSize; /**< Characters in incomplete line */
+  size_t feedCap;  /**< Line buffer size */
+
+  BC_ENV env; /**< Frozen base environment, or NULL */
+  BC_STORE store; /**< Shared store, or NULL */
+
+  BC_POOL pool;      /**< Pool, which has jobs of core, or NULL, claimed atomically */
+  BC_JOB poolHead;   /**< Running or oldest pending job, guarded by lock of pool */
+  BC_JOB poolTail;   /**< Newest pending job */
+  BC_POOL poolLast;  /**< Pool, which executed core last, or NULL */
+  size_t poolWorker; /**< Worker of poolLast, which executed core last */
+
+  size_t spareSize;                      /**< Spare boxes kept */
+  BC_VALUE spare[BC_CORE_SPARE_BOXES];   /**< Integer and number boxes released by host pops */
 };
 
 bcStatus_t bcCoreSetGlobal(
@@ -215,7 +495,64 @@ bcStatus_t bcCodeStreamAppendOpcode(bcCodeStream_t* cs, uint8_t opcode);
  */
 bcStatus_t bcCodeStreamAppendConstant(bcCodeStream_t* cs, const BC_VALUE con, uint8_t* pCon);
 
-bcStatus_t bcCodeStreamCompile(bcCodeStream_t* cs, const bcTree_t* tree);
+/**
+ * Appends opcode with one byte argument.
+ * 
+ * @param cs[in] - valid code stream
+ * @param opcode[in] - opcode to append
+ * @param arg[in] - opcode argument
+ * 
+ * @return BC_OK if appended successfully, error code otherwise
+ */
+bcStatus_t bcCodeStreamAppendOpcodeArg(bcCodeStream_t* cs, uint8_t opcode, uint8_t arg);
+
+/**
+ * Appends constant and PSH opcode, which pushes it.
+ * 
+ * @param cs[in] - valid code stream
+ * @param con[in] - constant to push, copied into code stream
+ * 
+ * @return BC_OK if appended successfully, error code otherwise
+ */
+bcStatus_t bcCodeStreamAppendPush(bcCodeStream_t* cs, const BC_VALUE con);
+
+/**
+ * Appends name constant and BC_LDG or BC_STG opcode, which accesses global
+ * variable. Name gets empty slot cache entry, see bcCoreGlobalSlot.
+ * 
+ * @param cs[in] - valid code stream
+ * @param opcode[in] - BC_LDG or BC_STG
+ * @param name[in] - variable name, BC_STRING
+ * 
+ * @return BC_OK if appended successfully, error code otherwise
+ */
+bcStatus_t bcCodeStreamAppendGlobal(bcCodeStream_t* cs, uint8_t opcode, const BC_VALUE name);
+
+/**
+ * Compile top-level statement parse tree and append it to code stream.
+ * 
+ * Unlike bcCodeStreamCompile, no HALT opcode is appended.
+ * 
+ * @param cs[in] - valid code stream
+ * @param arena[in] - arena of statement items, lazy if-statement bodies keep reference to it
+ * @param item[in] - statement item
+ * 
+ * @return BC_OK if compilation completed successfully, error code otherwise
+ */
+bcStatus_t bcCodeStreamAppendStatement(bcCodeStream_t* cs, bcTreeArena_t* arena, bcTreeRef_t item);
+
+/**
+ * Compile parse tree into code stream.
+ * 
+ * If-statement bodies are not compiled here. They become BC_CODE constants,
+ * which reference tree arena and are compiled when branch is taken first time.
+ * 
+ * @param cs[in] - valid code stream
+ * @param tree[in] - parse tree to compile
+ * 
+ * @return BC_OK if compilation completed successfully, error code otherwise
+ */
+bcStatus_t bcCodeStreamCompile(bcCodeStream_t* cs, bcTree_t* tree);
 
 /**
  * Interface function to re2c generated lexer.
@@ -224,12 +561,55 @@ bcStatus_t bcCodeStreamCompile(bcCodeStream_t* cs, const bcTree_t* tree);
  * 
  * @param[in] head - first character in stream
  * @param[out] tail - pointer is set to character after last processed
- * @param[out] pData - pointer is set to new allocated BC_VALUE, if any.
+ * @param[out] pToken - token data, referring to stream
  * @param[in,out] parseContext - pointer to parsing context
  * 
  * @return 0 if string ended and no tokens are found, one of TOK_ constants otherwise
  */
-int bcGetToken(const char* head, const char** tail, BC_VALUE* pData, bcParseContext_t* parseContext);
+int bcGetToken(const char* head, const char** tail, bcToken_t* pToken, bcParseContext_t* parseContext);
+
+/**
+ * Skip spaces and tabs.
+ * 
+ * Scanners are used by lexer for long runs of characters, they process
+ * aligned blocks of 16 (SSE2) or 32 (AVX2) characters at once, when
+ * compiler targets them, and fall back to scalar loop otherwise or when
+ * BC_SCAN_SCALAR is defined. Blocks never cross the page of terminating
+ * '\0', so string must be NUL-terminated.
+ * 
+ * @param[in] head - first character
+ * 
+ * @return first character, which is not space or tab
+ */
+const char* bcScanSpaces(const char* head);
+
+/**
+ * Find end of identifier.
+ * 
+ * @param[in] head - first character
+ * 
+ * @return first character not in [a-zA-Z_0-9]
+ */
+const char* bcScanId(const char* head);
+
+/**
+ * Find closing quote of string literal.
+ * 
+ * @param[in] head - first character after opening quote
+ * 
+ * @return first '"' or terminating '\0'
+ */
+const char* bcScanQuote(const char* head);
+
+/**
+ * Create value of CONSTANT or ID token.
+ * 
+ * @param[in] token - token data
+ * @param[in] parseContext - parsing context, which token was produced in
+ * 
+ * @return NULL on errors, new value otherwise
+ */
+BC_VALUE bcTokenValue(const bcToken_t* token, const bcParseContext_t* parseContext);
 
 /**
  * Interface function to LEMON generated parser.
@@ -253,18 +633,279 @@ int bcGetToken(const char* head, const char** tail, BC_VALUE* pData, bcParseCont
 bcStatus_t bcParseString(const char* str, bcTree_t** parseTree, char** endp, bcParseContext_t* parseContext);
 
 /**
- * Compile code stream to value.
+ * Interface function to LEMON generated parser.
+ * 
+ * Compile code stream from given character string in single pass. Parser 
+ * actions append code of top-level statements to code stream, as soon as 
+ * statement parts are reduced, so no parse tree is built for them. Only block
+ * bodies are built into parse trees, because if-statement bodies are compiled
+ * lazily, and function locals are not known until whole body is parsed.
+ * 
+ * Parsing context must not be shared with bcParseString calls, until 
+ * statement is finished.
+ * 
+ * @param[in] str - string to parse into code stream
+ * @param[out] cs - pointer to uninitialized code stream, HALT terminated code is stored there, if BC_OK is returned
+ * @param[out] endp - pointer in str to last processed character without error.
+ * @param[in,out] parseContext - parsing context, keeps partial code, if BC_PARSE_NOT_FINISHED is returned
+ * 
+ * @return 
+ *    BC_PARSE_NOT_FINISHED - more data expected
+ *    BC_EMPTY_EXPR - no statements were parsed
+ *    BC_MALFORMED_CODE - syntax error
+ *    BC_OK - if compilation completed successfully
+ *    error code otherwise
+ */
+bcStatus_t bcParseCompile(const char* str, bcCodeStream_t* cs, char** endp, bcParseContext_t* parseContext);
+
+/**
+ * Free parser state left in parsing context, when more input was expected.
+ * 
+ * @param[in,out] parseContext - pointer to parsing context
+ */
+void bcParseContextCleanup(bcParseContext_t* parseContext);
+
+/**
+ * Box parse tree into code value.
+ * 
+ * Parse tree is not compiled until bcCodeCompile is called. Code value owns
+ * passed parse tree, if function call completed successfully.
+ * 
+ * @param[in] parseTree - valid parse tree
+ * 
+ * @return NULL on errors, new value otherwise
+ */
+BC_VALUE bcValueCode(bcTree_t* parseTree);
+
+/**
+ * Get code stream constant.
+ * 
+ * Constants of code streams loaded from image are materialized on first use.
+ * 
+ * @param[in] cs - valid code stream
+ * @param[in] conID - constant index
+ * @param[out] pCon - pointer to store constant, owned by code stream
+ * 
+ * @return BC_OK if completed successfully, error code otherwise
+ */
+bcStatus_t bcCodeStreamConstant(const bcCodeStream_t* cs, uint8_t conID, BC_VALUE* pCon);
+
+/**
+ * Materialize constant of code stream, loaded from image.
+ * 
+ * @param[in,out] cs - code stream with image
+ * @param[in] conID - constant index
+ * 
+ * @return BC_OK if completed successfully, error code otherwise
+ */
+bcStatus_t bcImageConstant(bcCodeStream_t* cs, uint8_t conID);
+
+/**
+ * Release loaded image, which is freed with last reference.
+ * 
+ * @param[in] image - image or NULL
+ */
+void bcImageRelease(bcImage_t* image);
+
+/**
+ * Add reference to loaded image.
+ */
+void bcImageRetain(bcImage_t* image);
+
+/**
+ * Materialize value of global variable saved in core image.
+ * 
+ * Value doesn't refer to image.
+ * 
+ * @param[in] image - loaded core image
+ * @param[in] offset - value offset
+ * @param[out] pValue - pointer to store new value
+ * 
+ * @return BC_OK if completed successfully, error code otherwise
+ */
+bcStatus_t bcImageGlobalValue(const bcImage_t* image, uint32_t offset, BC_VALUE* pValue);
+
+/**
+ * Define global variable, which value is loaded from core image on first
+ * use. Variable keeps reference to image until then.
+ */
+bcStatus_t bcCoreBindImage(BC_CORE core, const char* name, bcImage_t* image, uint32_t offset);
+
+/**
+ * Create string value from characters, which are not NUL-terminated.
+ * 
+ * @param[in] str - first character
+ * @param[in] len - number of characters
+ * 
+ * @return NULL on errors, new value otherwise
+ */
+BC_VALUE bcValueStringSlice(const char* str, size_t len);
+
+/**
+ * Make reference counter of value thread-safe.
+ * 
+ * Must be called before value is visible to other threads. Nested values
+ * are not changed.
+ * 
+ * @param[in] value - valid value
+ */
+void bcValueShare(BC_VALUE value);
+
+/**
+ * Prepare compiled code stream to be executed by several threads at once.
+ * 
+ * All lazy if-statement bodies are compiled, constants of loaded code are
+ * materialized, and reference counters of constants are
+ * made thread-safe, for code stream and every nested code stream.
+ * 
+ * @param[in,out] cs - compiled code stream, not yet visible to other threads
+ * @param[out] pSize - approximate memory used by code stream and its constants
+ * 
+ * @return BC_OK if completed successfully, error code otherwise
+ */
+bcStatus_t bcCodeStreamShare(bcCodeStream_t* cs, size_t* pSize);
+
+/**
+ * Prepare value to be used by several threads at once.
+ * 
+ * Code streams of functions and code blocks are prepared with 
+ * bcCodeStreamShare.
+ * 
+ * @param[in,out] value - value, not yet visible to other threads
+ * @param[out] pSize - approximate memory used by value
+ * 
+ * @return BC_OK if completed successfully, error code otherwise
+ */
+bcStatus_t bcValueShareDeep(BC_VALUE value, size_t* pSize);
+
+/**
+ * Find compiled code in cache.
+ * 
+ * Only statements parsed without unfinished statement in parsing context 
+ * can be cached. Found entry is kept alive until bcCacheRelease is called.
+ * 
+ * @param[in] code - source text
+ * @param[in] newline - lexer newline flag before parsing
+ * 
+ * @return cache entry, or NULL if code is not cached
+ */
+bcCacheEntry_t* bcCacheAcquire(const char* code, int newline);
+
+/**
+ * Put compiled code in cache.
+ * 
+ * On success code stream is prepared with bcCodeStreamShare and owned by 
+ * returned entry, which is kept alive until bcCacheRelease is called.
+ * 
+ * @param[in] code - source text
+ * @param[in] consumed - bytes of source consumed by parser
+ * @param[in] newline - lexer newline flag before parsing
+ * @param[in] newlineAfter - lexer newline flag after parsing
+ * @param[in,out] codeStream - compiled code, becomes empty on success
+ * 
+ * @return cache entry, or NULL if code can't be cached
+ */
+bcCacheEntry_t* bcCacheInsert(const char* code, size_t consumed, int newline, int newlineAfter, bcCodeStream_t* codeStream);
+
+/**
+ * Release cache entry returned by bcCacheAcquire or bcCacheInsert.
+ */
+void bcCacheRelease(bcCacheEntry_t* entry);
+
+/**
+ * Compile code value parse tree, if it is not compiled yet.
+ * 
+ * Parse tree is freed after successful compilation.
+ * 
+ * @param[in] code - valid code value
+ * 
+ * @return BC_OK if code is compiled, error code otherwise
  */
-BC_VALUE bcValueCode(const bcTree_t* parseTree);
+bcStatus_t bcCodeCompile(bcCode_t* code);
 
 BC_GLOBAL bcGlobalNew(const char* name, const BC_VALUE value);
 
 void bcGlobalDelete(BC_GLOBAL global);
 
+/**
+ * Find global variable by name.
+ * 
+ * @return NULL if variable is not defined, variable otherwise
+ */
+BC_GLOBAL bcCoreFindGlobal(BC_CORE core, const char* name);
+
+/**
+ * Make new tag for slot cache entries of core.
+ * 
+ * Tags are unique, until 2^(64 - BC_GLOBAL_SLOT_BITS) cores are created.
+ * 
+ * @return tag, never 0
+ */
+uint64_t bcCoreSlotTag(void);
+
+/**
+ * Get slot of variable name constant in core.
+ * 
+ * Every core numbers names, which its code loads and stores. Code stream
+ * caches slot of every name constant together with tag of core, which 
+ * found it, so following accesses from that core take no name lookup.
+ * 
+ * @param[in] core valid core
+ * @param[in] cs code stream, which is executed by core
+ * @param[in] conID constant ID of variable name
+ * @param[out] pSlot pointer to store slot
+ * 
+ * @return BC_OK if completed successfully, error code otherwise
+ */
+bcStatus_t bcCoreGlobalSlot(BC_CORE core, const bcCodeStream_t* cs, uint8_t conID, uint32_t* pSlot);
+
+/**
+ * Get global variable of core slot.
+ * 
+ * @param[in] core valid core
+ * @param[in] slot slot from bcCoreGlobalSlot
+ * 
+ * @return NULL if variable is not defined, variable otherwise
+ */
+BC_GLOBAL bcCoreSlotGlobal(BC_CORE core, uint32_t slot);
+
 bcStatus_t bcCoreSetGlobal(BC_CORE core, const char* name, const BC_VALUE value);
 
 BC_VALUE bcCoreGetGlobal(BC_CORE core, const char* name);
 
+/**
+ * Share global variables of parent core with new child core.
+ * 
+ * Own variables of parent are frozen into its base environment, which 
+ * becomes base environment of child, see bcCoreFreeze.
+ */
+bcStatus_t bcCoreForkGlobals(BC_CORE parent, BC_CORE child);
+
+/**
+ * Get value of global variable, reading host storage of bound variable.
+ * 
+ * @param[in] global valid global
+ * @param[out] pValue pointer to store new reference to value
+ */
+bcStatus_t bcGlobalLoad(const BC_GLOBAL global, BC_VALUE* pValue);
+
+/**
+ * Replace value of global variable, writing host storage of bound variable.
+ */
+bcStatus_t bcGlobalStore(BC_GLOBAL global, const BC_VALUE value);
+
+/**
+ * Push value of global variable on core stack.
+ */
+bcStatus_t bcCorePushGlobal(BC_CORE core, const BC_GLOBAL global);
+
+/**
+ * Push value of store variable, which core doesn't define, on core stack.
+ * 
+ * @return BC_OK if variable is found, BC_NOT_DEFINED otherwise
+ */
+bcStatus_t bcCorePushStoreGlobal(BC_CORE core, const char* name);
+
 bcStatus_t bcValueBinaryOperatorAlgebra(const BC_VALUE a, const BC_VALUE b, uint8_t binop, BC_VALUE* result);
 
 bcStatus_t bcValueBinaryOperatorCompare(const BC_VALUE a, const BC_VALUE b, uint8_t binop, BC_VALUE* result);
@@ -277,4 +918,79 @@ bcStatus_t bcValueUnaryOperator(const BC_VALUE a, uint8_t unop, BC_VALUE* result
 
 const char* bcOpcodeString(uint8_t opcode);
 
+/**
+ * Check if opcode is followed by argument byte.
+ * 
+ * @return not 0 if opcode has argument
+ */
+int bcOpcodeHasArg(uint8_t opcode);
+
+/**
+ * Interpreter operations.
+ * 
+ * Each function executes one opcode, which doesn't change control flow.
+ * They are shared by interpreter and ahead-of-time compiled native code.
+ */
+bcStatus_t bcCoreOpPush(BC_CORE core, const bcCodeStream_t* codeStream, uint8_t conID);
+
+bcStatus_t bcCoreOpPop(BC_CORE core);
+
+bcStatus_t bcCoreOpBinary(BC_CORE core, uint8_t opcode);
+
+bcStatus_t bcCoreOpSet(BC_CORE core);
+
+bcStatus_t bcCoreOpUnary(BC_CORE core, uint8_t opcode);
+
+bcStatus_t bcCoreOpValue(BC_CORE core);
+
+bcStatus_t bcCoreOpResult(BC_CORE core);
+
+bcStatus_t bcCoreOpCondition(BC_CORE core, int64_t* pValue);
+
+bcStatus_t bcCoreOpLoadLocal(BC_CORE core, BC_VALUE* base, uint8_t slot);
+
+bcStatus_t bcCoreOpStoreLocal(BC_CORE core, BC_VALUE* base, uint8_t slot);
+
+bcStatus_t bcCoreOpLoadGlobal(BC_CORE core, const bcCodeStream_t* codeStream, uint8_t conID);
+
+bcStatus_t bcCoreOpStoreGlobal(BC_CORE core, const bcCodeStream_t* codeStream, uint8_t conID);
+
+/**
+ * Call function on stack with given number of arguments.
+ * 
+ * Function is expected on stack right before its arguments. When function 
+ * returns, its result replaces function and arguments on stack.
+ * 
+ * @param core[in] valid core
+ * @param argCount[in] number of arguments on stack
+ * 
+ * @return BC_OK if function completed successfully, error code otherwise
+ */
+bcStatus_t bcCoreCall(BC_CORE core, uint8_t argCount);
+
+/**
+ * Restore frame and value stacks after failed execution.
+ * 
+ * @param core[in] valid core
+ * @param frames[in] frame stack top before execution
+ * @param values[in] value stack top before execution
+ */
+void bcCoreUnwind(BC_CORE core, bcFrame_t* frames, BC_VALUE* values);
+
+/**
+ * Parse whole program text.
+ * 
+ * Unlike bcParseString, blocks left open at end of text are closed, and
+ * parsing context is not shared with any core.
+ * 
+ * @param code[in] program text
+ * @param pTree[out] pointer to store parse tree
+ * 
+ * @return 
+ *    BC_OK - program parsed
+ *    BC_EMPTY_EXPR - program has no statements
+ *    error code otherwise
+ */
+bcStatus_t bcParseProgram(const char* code, bcTree_t** pTree);
+
 #endif /* DECI_SPACE_BADCODE_PRIVATE_HEADER */
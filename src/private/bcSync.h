@@ -0,0 +1,331 @@
+/**
+ * @file bcSync.h
+ *
+ * Atomic operations and locks for state shared between threads.
+ *
+ * All atomic operations are sequentially consistent, unless named relaxed.
+ */
+#pragma once
+#ifndef DECI_SPACE_BADCODE_SYNC_HEADER
+#define DECI_SPACE_BADCODE_SYNC_HEADER
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+typedef SRWLOCK bcMutex_t;
+typedef CONDITION_VARIABLE bcCond_t;
+
+#define BC_MUTEX_INIT SRWLOCK_INIT
+
+static inline void bcMutexInit(bcMutex_t* mutex)
+{
+  InitializeSRWLock(mutex);
+}
+
+static inline void bcMutexDestroy(bcMutex_t* mutex)
+{
+  (void) mutex;
+}
+
+static inline void bcMutexLock(bcMutex_t* mutex)
+{
+  AcquireSRWLockExclusive(mutex);
+}
+
+static inline void bcMutexUnlock(bcMutex_t* mutex)
+{
+  ReleaseSRWLockExclusive(mutex);
+}
+
+static inline void bcCondInit(bcCond_t* cond)
+{
+  InitializeConditionVariable(cond);
+}
+
+static inline void bcCondDestroy(bcCond_t* cond)
+{
+  (void) cond;
+}
+
+static inline void bcCondWait(bcCond_t* cond, bcMutex_t* mutex)
+{
+  SleepConditionVariableSRW(cond, mutex, INFINITE, 0);
+}
+
+static inline void bcCondSignal(bcCond_t* cond)
+{
+  WakeConditionVariable(cond);
+}
+
+static inline void bcCondBroadcast(bcCond_t* cond)
+{
+  WakeAllConditionVariable(cond);
+}
+
+static inline void bcThreadYield(void)
+{
+  SwitchToThread();
+}
+
+typedef HANDLE bcThread_t;
+
+#define BC_THREAD_MAIN(name, arg) DWORD WINAPI name(LPVOID arg)
+#define BC_THREAD_RETURN return 0
+#define BC_THREAD_LOCAL __declspec(thread)
+
+static inline int bcThreadCreate(bcThread_t* thread, LPTHREAD_START_ROUTINE main, void* arg)
+{
+  *thread = CreateThread(NULL, 0, main, arg, 0, NULL);
+  return *thread != NULL;
+}
+
+static inline void bcThreadJoin(bcThread_t thread)
+{
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
+
+static inline size_t bcThreadCount(void)
+{
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  return (info.dwNumberOfProcessors > 0) ? (size_t) info.dwNumberOfProcessors : 1;
+}
+
+#else
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+typedef pthread_mutex_t bcMutex_t;
+typedef pthread_cond_t bcCond_t;
+
+#define BC_MUTEX_INIT PTHREAD_MUTEX_INITIALIZER
+
+static inline void bcMutexInit(bcMutex_t* mutex)
+{
+  pthread_mutex_init(mutex, NULL);
+}
+
+static inline void bcMutexDestroy(bcMutex_t* mutex)
+{
+  pthread_mutex_destroy(mutex);
+}
+
+static inline void bcMutexLock(bcMutex_t* mutex)
+{
+  pthread_mutex_lock(mutex);
+}
+
+static inline void bcMutexUnlock(bcMutex_t* mutex)
+{
+  pthread_mutex_unlock(mutex);
+}
+
+static inline void bcCondInit(bcCond_t* cond)
+{
+  pthread_cond_init(cond, NULL);
+}
+
+static inline void bcCondDestroy(bcCond_t* cond)
+{
+  pthread_cond_destroy(cond);
+}
+
+static inline void bcCondWait(bcCond_t* cond, bcMutex_t* mutex)
+{
+  pthread_cond_wait(cond, mutex);
+}
+
+static inline void bcCondSignal(bcCond_t* cond)
+{
+  pthread_cond_signal(cond);
+}
+
+static inline void bcCondBroadcast(bcCond_t* cond)
+{
+  pthread_cond_broadcast(cond);
+}
+
+static inline void bcThreadYield(void)
+{
+  sched_yield();
+}
+
+typedef pthread_t bcThread_t;
+
+#define BC_THREAD_MAIN(name, arg) void* name(void* arg)
+#define BC_THREAD_RETURN return NULL
+#define BC_THREAD_LOCAL __thread
+
+static inline int bcThreadCreate(bcThread_t* thread, void* (*main)(void*), void* arg)
+{
+  return pthread_create(thread, NULL, main, arg) == 0;
+}
+
+static inline void bcThreadJoin(bcThread_t thread)
+{
+  pthread_join(thread, NULL);
+}
+
+static inline size_t bcThreadCount(void)
+{
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+  return (count > 0) ? (size_t) count : 1;
+}
+
+#endif
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+#include <intrin.h>
+
+static inline int32_t bcAtomicLoad32(volatile int32_t* ptr)
+{
+  return (int32_t) _InterlockedCompareExchange((volatile long*) ptr, 0, 0);
+}
+
+static inline int32_t bcAtomicLoadRelaxed32(volatile int32_t* ptr)
+{
+  return *ptr;
+}
+
+static inline void bcAtomicStoreRelaxed32(volatile int32_t* ptr, int32_t value)
+{
+  *ptr = value;
+}
+
+static inline int32_t bcAtomicAdd32(volatile int32_t* ptr, int32_t value)
+{
+  return (int32_t) _InterlockedExchangeAdd((volatile long*) ptr, (long) value) + value;
+}
+
+static inline uint64_t bcAtomicLoad64(volatile uint64_t* ptr)
+{
+  return (uint64_t) _InterlockedCompareExchange64((volatile __int64*) ptr, 0, 0);
+}
+
+static inline void bcAtomicStore64(volatile uint64_t* ptr, uint64_t value)
+{
+  _InterlockedExchange64((volatile __int64*) ptr, (__int64) value);
+}
+
+static inline uint64_t bcAtomicLoadRelaxed64(volatile uint64_t* ptr)
+{
+#if defined(_M_X64) || defined(_M_ARM64)
+  return *ptr;
+#else
+  return bcAtomicLoad64(ptr);
+#endif
+}
+
+static inline void bcAtomicStoreRelaxed64(volatile uint64_t* ptr, uint64_t value)
+{
+#if defined(_M_X64) || defined(_M_ARM64)
+  *ptr = value;
+#else
+  bcAtomicStore64(ptr, value);
+#endif
+}
+
+static inline uint64_t bcAtomicAdd64(volatile uint64_t* ptr, uint64_t value)
+{
+  return (uint64_t) _InterlockedExchangeAdd64((volatile __int64*) ptr, (__int64) value) + value;
+}
+
+static inline void bcAtomicAddRelaxed64(volatile uint64_t* ptr, uint64_t value)
+{
+  bcAtomicAdd64(ptr, value);
+}
+
+static inline void* bcAtomicLoadPtr(void* volatile* ptr)
+{
+  return _InterlockedCompareExchangePointer(ptr, NULL, NULL);
+}
+
+static inline void bcAtomicStorePtr(void* volatile* ptr, void* value)
+{
+  _InterlockedExchangePointer(ptr, value);
+}
+
+static inline int bcAtomicCasPtr(void* volatile* ptr, void* expected, void* value)
+{
+  return _InterlockedCompareExchangePointer(ptr, value, expected) == expected;
+}
+
+#else
+
+static inline int32_t bcAtomicLoad32(volatile int32_t* ptr)
+{
+  return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline int32_t bcAtomicLoadRelaxed32(volatile int32_t* ptr)
+{
+  return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+}
+
+static inline void bcAtomicStoreRelaxed32(volatile int32_t* ptr, int32_t value)
+{
+  __atomic_store_n(ptr, value, __ATOMIC_RELAXED);
+}
+
+static inline int32_t bcAtomicAdd32(volatile int32_t* ptr, int32_t value)
+{
+  return __atomic_add_fetch(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+static inline uint64_t bcAtomicLoad64(volatile uint64_t* ptr)
+{
+  return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline void bcAtomicStore64(volatile uint64_t* ptr, uint64_t value)
+{
+  __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+static inline uint64_t bcAtomicLoadRelaxed64(volatile uint64_t* ptr)
+{
+  return __atomic_load_n(ptr, __ATOMIC_RELAXED);
+}
+
+static inline void bcAtomicStoreRelaxed64(volatile uint64_t* ptr, uint64_t value)
+{
+  __atomic_store_n(ptr, value, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t bcAtomicAdd64(volatile uint64_t* ptr, uint64_t value)
+{
+  return __atomic_add_fetch(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+static inline void bcAtomicAddRelaxed64(volatile uint64_t* ptr, uint64_t value)
+{
+  __atomic_add_fetch(ptr, value, __ATOMIC_RELAXED);
+}
+
+static inline void* bcAtomicLoadPtr(void* volatile* ptr)
+{
+  return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+}
+
+static inline void bcAtomicStorePtr(void* volatile* ptr, void* value)
+{
+  __atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+}
+
+static inline int bcAtomicCasPtr(void* volatile* ptr, void* expected, void* value)
+{
+  return __atomic_compare_exchange_n(ptr, &expected, value, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+#endif
+
+#endif /* DECI_SPACE_BADCODE_SYNC_HEADER */
@@ -35,6 +35,22 @@ typedef struct bcValue_t
   int32_t refCount; /**< reference counter */
 } bcValue_t;
 
+/**
+ * Bias of reference counter of values shared between threads.
+ * 
+ * Negative counters are updated atomically, see bcValueShare.
+ */
+#define BC_REF_SHARED (INT32_MIN)
+
+/**
+ * Counter of static values, which are never freed or written, e.g. values
+ * in read-only shared memory or values frozen as immortal.
+ * 
+ * Shared value with BC_REF_SHARED counter has no references and is never 
+ * seen by holders, so the same counter marks static values.
+ */
+#define BC_REF_STATIC (BC_REF_SHARED)
+
 /**
  * BC_INTEGER.
  */
@@ -0,0 +1,120 @@
+#include <bcPrivate.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void usage(const char* name)
+{
+  fprintf(stderr, "Usage: %s <file> [<iterations>]\n", name);
+}
+
+static char* readFile(const char* path, size_t* pSize)
+{
+  FILE* input = fopen(path, "rb");
+  if (input == NULL)
+  {
+    perror("fopen");
+    return NULL;
+  }
+
+  char* text = NULL;
+  size_t size = 0;
+  size_t total = 0;
+  for (;;)
+  {
+    if (total - size < 4096)
+    {
+      total += 4096;
+      char* grown = (char*) realloc(text, total + 1);
+      if (grown == NULL)
+      {
+        free(text);
+        fclose(input);
+        return NULL;
+      }
+      text = grown;
+    }
+
+    size_t nread = fread(text + size, 1, total - size, input);
+    size += nread;
+    if (nread == 0)
+    {
+      break;
+    }
+  }
+
+  text[size] = '\0';
+  fclose(input);
+
+  *pSize = size;
+  return text;
+}
+
+/**
+ * Split whole text into tokens, like parser does, without parsing them.
+ */
+static size_t tokenize(const char* text)
+{
+  bcParseContext_t parseContext;
+  memset(&parseContext, 0, sizeof(parseContext));
+  parseContext.newline = 1;
+  parseContext.indentTop = parseContext.indentStack;
+  parseContext.source = text;
+
+  bcToken_t token;
+  size_t count = 0;
+  const char* cursor = text;
+  while (*cursor != '\0')
+  {
+    int tok = bcGetToken(cursor, &cursor, &token, &parseContext);
+    if ((tok == 0) || (tok == -1))
+    {
+      break;
+    }
+    ++count;
+  }
+  return count;
+}
+
+int main(int argc, char* argv[])
+{
+  if ((argc < 2) || (argc > 3))
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  long iterations = (argc == 3)? strtol(argv[2], NULL, 10) : 100;
+  if (iterations <= 0)
+  {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  size_t size = 0;
+  char* text = readFile(argv[1], &size);
+  if (text == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+
+  size_t count = 0;
+  clock_t start = clock();
+  for (long i = 0; i < iterations; ++i)
+  {
+    count = tokenize(text);
+  }
+  double seconds = (double) (clock() - start)/CLOCKS_PER_SEC;
+
+  double megabytes = (double) size*(double) iterations/(1024.0*1024.0);
+  fprintf(stdout, "%zu bytes, %zu tokens, %ld iterations\n", size, count, iterations);
+  if (seconds > 0.0)
+  {
+    fprintf(stdout, "%.3f s, %.1f MB/s\n", seconds, megabytes/seconds);
+  }
+
+  free(text);
+  return EXIT_SUCCESS;
+}
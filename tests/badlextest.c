@@ -0,0 +1,211 @@
+#include <bcParser.h>
+#include <bcPrivate.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(expr) \
+  do \
+  { \
+    if (!(expr)) \
+    { \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+      return EXIT_FAILURE; \
+    } \
+  } while (0)
+
+typedef int (*bcTestFunc_t)(void);
+
+typedef struct bcTest_t
+{
+  const char* name;
+  bcTestFunc_t func;
+} bcTest_t;
+
+static void initContext(bcParseContext_t* parseContext, const char* source)
+{
+  memset(parseContext, 0, sizeof(bcParseContext_t));
+  parseContext->newline = 1;
+  parseContext->indentTop = parseContext->indentStack;
+  parseContext->source = source;
+}
+
+/**
+ * Check that token is slice of source with given text.
+ */
+static int isSlice(const bcToken_t* token, const bcParseContext_t* parseContext, const char* text)
+{
+  size_t len = strlen(text);
+  return (token->chunk == parseContext->chunk)
+    && (token->len == len)
+    && (memcmp(parseContext->source + token->offset, text, len) == 0);
+}
+
+/**
+ * Tokens refer to source by offset and length, and values are created from
+ * them only on request.
+ */
+static int testTokens(void)
+{
+  const char* source =
+    "total <- price*2 + 1.5\n"
+    "If iffy > 99999999999999999999:\n"
+    "  name <- \"long string literal\"\n";
+
+  bcParseContext_t parseContext;
+  initContext(&parseContext, source);
+
+  bcToken_t token;
+  const char* cursor = source;
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_ID);
+  CHECK(isSlice(&token, &parseContext, "total"));
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_SET);
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_ID);
+  CHECK(isSlice(&token, &parseContext, "price"));
+
+  BC_VALUE value = bcTokenValue(&token, &parseContext);
+  char* text = NULL;
+  CHECK(value != NULL);
+  CHECK((bcValueAsString(value, &text, 0) == BC_OK) && (strcmp(text, "price") == 0));
+  free(text);
+  text = NULL;
+  bcValueCleanup(value);
+
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_MUL);
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_CONSTANT);
+  CHECK((token.type == BC_INTEGER) && (token.as.integer == 2));
+  CHECK(isSlice(&token, &parseContext, "2"));
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_ADD);
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_CONSTANT);
+  CHECK((token.type == BC_NUMBER) && (token.as.number == 1.5));
+  CHECK(isSlice(&token, &parseContext, "1.5"));
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_EXPR_END);
+
+  // keywords are case insensitive, but identifiers starting with them are not keywords
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_IF);
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_ID);
+  CHECK(isSlice(&token, &parseContext, "iffy"));
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_GR);
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_CONSTANT);
+  CHECK((token.type == BC_INTEGER) && (token.as.integer == INT64_MAX));
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_BLOCK);
+
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_INDENT);
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_ID);
+  CHECK(isSlice(&token, &parseContext, "name"));
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_SET);
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_CONSTANT);
+  CHECK(token.type == BC_STRING);
+  CHECK(isSlice(&token, &parseContext, "long string literal"));
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_EXPR_END);
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == TOK_DEDENT);
+  CHECK(*cursor == '\0');
+
+  // token of previous chunk is read from its copy
+  char* chunks[1] = { (char*) source };
+  const char* next = "x\n";
+  initContext(&parseContext, next);
+  parseContext.chunk = 1;
+  parseContext.chunks = chunks;
+  token.chunk = 0;
+  token.offset = 9;
+  token.len = 5;
+  token.type = BC_STRING;
+  value = bcTokenValue(&token, &parseContext);
+  CHECK(value != NULL);
+  CHECK((bcValueAsString(value, &text, 0) == BC_OK) && (strcmp(text, "price") == 0));
+  free(text);
+  bcValueCleanup(value);
+
+  // unterminated string is not token
+  const char* broken = "\"open\n";
+  initContext(&parseContext, broken);
+  cursor = broken;
+  CHECK(bcGetToken(cursor, &cursor, &token, &parseContext) == 0);
+  CHECK(cursor == broken);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Vector scanners stop at the same character as plain loop, for any run
+ * length, alignment and stop character.
+ */
+static int testScan(void)
+{
+  // characters next to ranges, which scanners compare with
+  static const char stops[] = { '\0', '\n', '"', '/', ':', '@', '[', '`', '{', '-', '\x80', '\xff' };
+  static const char fills[] = { ' ', '\t', 'a', 'Z', '0', '9', '_' };
+
+  char buffer[256];
+  for (size_t offset = 0; offset < 64; ++offset)
+  {
+    for (size_t len = 0; len < 96; ++len)
+    {
+      for (size_t s = 0; s < sizeof(stops); ++s)
+      {
+        char* head = buffer + offset;
+        for (size_t i = 0; i < len; ++i)
+        {
+          head[i] = fills[(i + offset) % sizeof(fills)];
+        }
+        head[len] = stops[s];
+        memset(head + len + 1, ' ', sizeof(buffer) - offset - len - 2);
+        buffer[sizeof(buffer) - 1] = '\0';
+
+        // runs of one class only
+        memset(head, ' ', len);
+        CHECK(bcScanSpaces(head) == head + len);
+        memset(head, '\t', len);
+        CHECK(bcScanSpaces(head) == head + len);
+
+        for (size_t i = 0; i < len; ++i)
+        {
+          head[i] = fills[2 + (i + offset) % (sizeof(fills) - 2)];
+        }
+        CHECK(bcScanId(head) == head + len);
+
+        for (size_t i = 0; i < len; ++i)
+        {
+          head[i] = fills[(i + offset) % sizeof(fills)];
+        }
+        const char* quote = ((stops[s] == '"') || (stops[s] == '\0'))? head + len : buffer + sizeof(buffer) - 1;
+        CHECK(bcScanQuote(head) == quote);
+      }
+    }
+  }
+  return EXIT_SUCCESS;
+}
+
+static const bcTest_t tests[] = {
+  { "tokens", testTokens },
+  { "scan", testScan },
+};
+
+int main(int argc, char* argv[])
+{
+  size_t total = sizeof(tests)/sizeof(tests[0]);
+  int result = EXIT_SUCCESS;
+  int found = 0;
+  for (size_t i = 0; i < total; ++i)
+  {
+    if ((argc > 1) && (strcmp(argv[1], tests[i].name) != 0))
+    {
+      continue;
+    }
+    found = 1;
+    if (tests[i].func() != EXIT_SUCCESS)
+    {
+      fprintf(stderr, "%s: FAILED\n", tests[i].name);
+      result = EXIT_FAILURE;
+    }
+  }
+
+  if (!found)
+  {
+    fprintf(stderr, "Usage: %s [<test>]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  return result;
+}
@@ -2,6 +2,370 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static void usage(const char* name)
+{
+  fprintf(stderr, "Usage: %s [<file>]\n", name);
+  fprintf(stderr, "       %s --aot <file> <output.c>\n", name);
+  fprintf(stderr, "       %s --native <library>\n", name);
+  fprintf(stderr, "       %s --save <file> <image>\n", name);
+  fprintf(stderr, "       %s --load <image>\n", name);
+  fprintf(stderr, "       %s --run <file>\n", name);
+  fprintf(stderr, "       %s --snapshot <file> <image>\n", name);
+  fprintf(stderr, "       %s --restore <image> [<file>]\n", name);
+}
+
+static void printResult(BC_CORE core)
+{
+  BC_VALUE result = NULL;
+  if (bcCoreResult(core, &result) == BC_OK)
+  {
+    if (result != NULL)
+    {
+      fprintf(stdout, "= ");
+      bcValuePrint(stdout, result);
+      fprintf(stdout, "\n");
+    }
+  }
+}
+
+static char* readFile(const char* path)
+{
+  FILE* input = fopen(path, "rb");
+  if (input == NULL)
+  {
+    perror("fopen");
+    return NULL;
+  }
+
+  char* text = NULL;
+  size_t size = 0;
+  size_t total = 0;
+  for (;;)
+  {
+    if (total - size < 4096)
+    {
+      total += 4096;
+      char* grown = (char*) realloc(text, total + 1);
+      if (grown == NULL)
+      {
+        free(text);
+        fclose(input);
+        return NULL;
+      }
+      text = grown;
+    }
+
+    size_t nread = fread(text + size, 1, total - size, input);
+    size += nread;
+    if (nread == 0)
+    {
+      break;
+    }
+  }
+
+  text[size] = '\0';
+  fclose(input);
+  return text;
+}
+
+static int compileToC(const char* path, const char* outputPath)
+{
+  char* text = readFile(path);
+  if (text == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+
+  FILE* output = fopen(outputPath, "w");
+  if (output == NULL)
+  {
+    perror("fopen");
+    free(text);
+    return EXIT_FAILURE;
+  }
+
+  bcStatus_t status = bcCompileToC(text, output);
+  fclose(output);
+  free(text);
+
+  if (status != BC_OK)
+  {
+    fprintf(stderr, "! %s (%d)\n", bcStatusString(status), status);
+    remove(outputPath);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+static int executeNative(const char* path)
+{
+  BC_NATIVE_PROGRAM program = NULL;
+  bcStatus_t status = bcNativeProgramLoad(path, &program);
+  if (status != BC_OK)
+  {
+    fprintf(stderr, "bcNativeProgramLoad failed: %s (%d)\n", bcStatusString(status), status);
+    return EXIT_FAILURE;
+  }
+
+  BC_CORE core = NULL;
+  status = bcCoreNew(&core);
+  if (status != BC_OK)
+  {
+    fprintf(stderr, "bcCoreNew failed: %d\n", status);
+    bcNativeProgramDelete(program);
+    return EXIT_FAILURE;
+  }
+
+  status = bcCoreExecuteNative(core, program);
+  if (status == BC_OK)
+  {
+    printResult(core);
+  }
+  else
+  {
+    fprintf(stderr, "! %s (%d)\n", bcStatusString(status), status);
+  }
+
+  bcCoreDelete(core);
+  bcNativeProgramDelete(program);
+  return (status == BC_OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int saveImage(const char* path, const char* imagePath)
+{
+  char* text = readFile(path);
+  if (text == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+
+  BC_PROGRAM program = NULL;
+  bcStatus_t status = bcProgramCompile(text, &program);
+  free(text);
+
+  if (status == BC_OK)
+  {
+    status = bcProgramSave(program, imagePath);
+    bcProgramDelete(program);
+  }
+
+  if (status != BC_OK)
+  {
+    fprintf(stderr, "! %s (%d)\n", bcStatusString(status), status);
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+static int executeImage(const char* imagePath)
+{
+  BC_PROGRAM program = NULL;
+  bcStatus_t status = bcProgramLoad(imagePath, &program);
+  if (status != BC_OK)
+  {
+    fprintf(stderr, "bcProgramLoad failed: %s (%d)\n", bcStatusString(status), status);
+    return EXIT_FAILURE;
+  }
+
+  BC_CORE core = NULL;
+  status = bcCoreNew(&core);
+  if (status != BC_OK)
+  {
+    fprintf(stderr, "bcCoreNew failed: %d\n", status);
+    bcProgramDelete(program);
+    return EXIT_FAILURE;
+  }
+
+  status = bcCoreExecuteProgram(core, program);
+  if (status == BC_OK)
+  {
+    printResult(core);
+  }
+  else
+  {
+    fprintf(stderr, "! %s (%d)\n", bcStatusString(status), status);
+  }
+
+  bcCoreDelete(core);
+  bcProgramDelete(program);
+  return (status == BC_OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int snapshotCore(const char* path, const char* imagePath)
+{
+  FILE* input = fopen(path, "rb");
+  if (input == NULL)
+  {
+    perror("fopen");
+    return EXIT_FAILURE;
+  }
+
+  BC_CORE core = NULL;
+  bcStatus_t status = bcCoreNew(&core);
+  if (status != BC_OK)
+  {
+    fprintf(stderr, "bcCoreNew failed: %d\n", status);
+    fclose(input);
+    return EXIT_FAILURE;
+  }
+
+  // script is fed in chunks, so it isn't held in memory whole
+  char chunk[4096];
+  size_t nread;
+  while ((status == BC_OK) && ((nread = fread(chunk, 1, sizeof(chunk), input)) != 0))
+  {
+    status = bcCoreFeed(core, chunk, nread, NULL);
+  }
+  fclose(input);
+
+  if (status == BC_OK)
+  {
+    status = bcCoreFeedEnd(core);
+  }
+
+  if (status == BC_OK)
+  {
+    status = bcCoreSave(core, imagePath);
+  }
+
+  if (status != BC_OK)
+  {
+    fprintf(stderr, "! %s (%d)\n", bcStatusString(status), status);
+  }
+
+  bcCoreDelete(core);
+  return (status == BC_OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static double elapsed(const struct timespec* start)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (double) (now.tv_sec - start->tv_sec)*1000.0 + (double) (now.tv_nsec - start->tv_nsec)/1000000.0;
+}
+
+/**
+ * Map whole file as NUL-terminated text. Pages are zero-filled after end of 
+ * file, so only file, which fills whole pages, must be read instead.
+ */
+static char* mapFile(const char* path, size_t* pMapped)
+{
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+  {
+    perror("open");
+    return NULL;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == -1)
+  {
+    perror("fstat");
+    close(fd);
+    return NULL;
+  }
+
+  size_t size = (size_t) st.st_size;
+  long pageSize = sysconf(_SC_PAGESIZE);
+  if ((size == 0) || (pageSize <= 0) || (size % (size_t) pageSize == 0))
+  {
+    close(fd);
+    *pMapped = 0;
+    return readFile(path);
+  }
+
+  void* text = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (text == MAP_FAILED)
+  {
+    perror("mmap");
+    return NULL;
+  }
+
+  *pMapped = size;
+  return (char*) text;
+}
+
+static int runBatch(const char* path)
+{
+  static char buffer[64*1024];
+  setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  size_t mapped = 0;
+  char* text = mapFile(path, &mapped);
+  if (text == NULL)
+  {
+    return EXIT_FAILURE;
+  }
+  double loadTime = elapsed(&start);
+
+  BC_PROGRAM program = NULL;
+  bcStatus_t status = bcProgramCompile(text, &program);
+  double compileTime = elapsed(&start) - loadTime;
+
+  if (mapped != 0)
+  {
+    munmap(text, mapped);
+  }
+  else
+  {
+    free(text);
+  }
+
+  if (status == BC_EMPTY_EXPR)
+  { // nothing to execute
+    return EXIT_SUCCESS;
+  }
+
+  if (status != BC_OK)
+  {
+    fprintf(stderr, "! %s (%d)\n", bcStatusString(status), status);
+    return EXIT_FAILURE;
+  }
+
+  BC_CORE core = NULL;
+  status = bcCoreNew(&core);
+  if (status != BC_OK)
+  {
+    fprintf(stderr, "bcCoreNew failed: %d\n", status);
+    bcProgramDelete(program);
+    return EXIT_FAILURE;
+  }
+
+  double executeStart = elapsed(&start);
+  status = bcCoreExecuteProgram(core, program);
+  double executeTime = elapsed(&start) - executeStart;
+
+  if (status == BC_OK)
+  {
+    printResult(core);
+  }
+  else
+  {
+    fprintf(stderr, "! %s (%d)\n", bcStatusString(status), status);
+  }
+
+  bcCoreDelete(core);
+  bcProgramDelete(program);
+  fflush(stdout);
+
+  fprintf(stderr, "load:    %10.3f ms\n", loadTime);
+  fprintf(stderr, "compile: %10.3f ms\n", compileTime);
+  fprintf(stderr, "execute: %10.3f ms\n", executeTime);
+  fprintf(stderr, "total:   %10.3f ms\n", elapsed(&start));
+  return (status == BC_OK) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
 int main(int argc, char* argv[])
 {
@@ -9,6 +373,44 @@ int main(int argc, char* argv[])
   char *line = NULL;
   size_t len = 0;
   ssize_t nread;
+  const char* corePath = NULL;
+
+  if ((argc == 4) && (strcmp(argv[1], "--aot") == 0))
+  {
+    return compileToC(argv[2], argv[3]);
+  }
+
+  if ((argc == 3) && (strcmp(argv[1], "--native") == 0))
+  {
+    return executeNative(argv[2]);
+  }
+
+  if ((argc == 4) && (strcmp(argv[1], "--save") == 0))
+  {
+    return saveImage(argv[2], argv[3]);
+  }
+
+  if ((argc == 3) && (strcmp(argv[1], "--load") == 0))
+  {
+    return executeImage(argv[2]);
+  }
+
+  if ((argc == 3) && (strcmp(argv[1], "--run") == 0))
+  {
+    return runBatch(argv[2]);
+  }
+
+  if ((argc == 4) && (strcmp(argv[1], "--snapshot") == 0))
+  {
+    return snapshotCore(argv[2], argv[3]);
+  }
+
+  if ((argc >= 3) && (argc <= 4) && (strcmp(argv[1], "--restore") == 0))
+  { // REPL starts with restored globals
+    corePath = argv[2];
+    argv += 2;
+    argc -= 2;
+  }
 
   switch (argc)
   {
@@ -24,7 +426,7 @@ int main(int argc, char* argv[])
     }
     break;
   default:
-    fprintf(stderr, "Usage: %s [<file>]\n", argv[0]);
+    usage(argv[0]);
     return EXIT_FAILURE;
   }
 
@@ -35,6 +437,21 @@ int main(int argc, char* argv[])
     fprintf(stderr, "bcCoreNew failed: %d\n", status);
     return EXIT_FAILURE;
   }
+
+  if (corePath != NULL)
+  {
+    status = bcCoreLoad(core, corePath);
+    if (status != BC_OK)
+    {
+      fprintf(stderr, "bcCoreLoad failed: %s (%d)\n", bcStatusString(status), status);
+      bcCoreDelete(core);
+      if (input != stdin)
+      {
+        fclose(input);
+      }
+      return EXIT_FAILURE;
+    }
+  }
   
   if (input == stdin)
   {
@@ -64,16 +481,7 @@ int main(int argc, char* argv[])
       continue;
     }
 
-    BC_VALUE result = NULL;
-    if (bcCoreResult(core, &result) == BC_OK)
-    {
-      if (result != NULL)
-      {
-        fprintf(stdout, "= ");
-        bcValuePrint(stdout, result);
-        fprintf(stdout, "\n");
-      }
-    }
+    printResult(core);
 
     fprintf(stdout, "%s", "? ");
     fflush(stdout);
@@ -0,0 +1,1048 @@
+#include <badcode.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(expr) \
+  do \
+  { \
+    if (!(expr)) \
+    { \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+      return EXIT_FAILURE; \
+    } \
+  } while (0)
+
+typedef int (*bcTestFunc_t)(void);
+
+typedef struct bcTest_t
+{
+  const char* name;
+  bcTestFunc_t func;
+} bcTest_t;
+
+/**
+ * Compile program and execute it on core.
+ */
+static bcStatus_t executeProgram(BC_CORE core, const char* code)
+{
+  BC_PROGRAM program = NULL;
+  bcStatus_t status = bcProgramCompile(code, &program);
+  if (status != BC_OK)
+  {
+    return status;
+  }
+  status = bcCoreExecuteProgram(core, program);
+  bcProgramDelete(program);
+  return status;
+}
+
+/**
+ * Arguments pushed by host reach script function, and its result is popped.
+ */
+static int testCall(void)
+{
+  BC_CORE core = NULL;
+  CHECK(bcCoreNew(&core) == BC_OK);
+  CHECK(executeProgram(core,
+    "func mix(a, b):\n"
+    "  return a*10 + b\n"
+    "func echo(s):\n"
+    "  return s\n"
+  ) == BC_OK);
+
+  CHECK(bcCorePushInteger(core, 4) == BC_OK);
+  CHECK(bcCorePushInteger(core, 2) == BC_OK);
+  CHECK(bcCoreCallFunction(core, "mix", 2) == BC_OK);
+
+  int64_t result = 0;
+  CHECK(bcCoreResultInteger(core, &result) == BC_OK);
+  CHECK(result == 42);
+  result = 0;
+  CHECK(bcCorePopInteger(core, &result) == BC_OK);
+  CHECK(result == 42);
+
+  const char* data = NULL;
+  size_t len = 0;
+  CHECK(bcCorePushString(core, "text", 4) == BC_OK);
+  CHECK(bcCoreCallFunction(core, "echo", 1) == BC_OK);
+  CHECK(bcCoreTopString(core, &data, &len) == BC_OK);
+  CHECK((len == 4) && (memcmp(data, "text", 4) == 0));
+  CHECK(bcCorePop(core) == BC_OK);
+
+  // failed calls remove arguments too
+  CHECK(bcCorePushInteger(core, 1) == BC_OK);
+  CHECK(bcCoreCallFunction(core, "mix", 1) == BC_INVALID_ARG);
+  CHECK(bcCorePushInteger(core, 1) == BC_OK);
+  CHECK(bcCoreCallFunction(core, "missing", 1) == BC_NOT_DEFINED);
+  CHECK(bcCorePop(core) == BC_UNDERFLOW);
+  CHECK(bcCoreCallFunction(core, "mix", 2) == BC_UNDERFLOW);
+
+  bcCoreDelete(core);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Strings with NULs are kept by core images.
+ */
+static int testStrings(void)
+{
+  const char* path = "badtest-strings.bci";
+  BC_CORE core = NULL;
+  BC_CHANNEL channel = NULL;
+  CHECK(bcCoreNew(&core) == BC_OK);
+  CHECK(bcChannelNew(1, &channel) == BC_OK);
+  CHECK(bcCoreBindChannel(core, NULL, "get", channel) == BC_OK);
+
+  BC_VALUE value = NULL;
+  CHECK(bcCorePushString(core, "a\0b", 3) == BC_OK);
+  CHECK(bcCoreTop(core, &value) == BC_OK);
+  CHECK(bcChannelSend(channel, bcValueCopy(value)) == BC_OK);
+  CHECK(bcCorePop(core) == BC_OK);
+  CHECK(executeProgram(core, "text <- get()\n") == BC_OK);
+  CHECK(bcCoreSave(core, path) == BC_OK);
+  bcCoreDelete(core);
+  bcChannelDelete(channel);
+
+  const char* data = NULL;
+  size_t len = 0;
+  CHECK(bcCoreNew(&core) == BC_OK);
+  CHECK(bcCoreLoad(core, path) == BC_OK);
+  CHECK(executeProgram(core, "text\n") == BC_OK);
+  CHECK(bcCoreResultString(core, &data, &len) == BC_OK);
+  CHECK((len == 3) && (memcmp(data, "a\0b", 3) == 0));
+  bcCoreDelete(core);
+
+  remove(path);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Globals keep their values, while thousands of other names are defined.
+ */
+static int testGlobals(void)
+{
+  BC_CORE core = NULL;
+  char code[64];
+  int64_t result = 0;
+  CHECK(bcCoreNew(&core) == BC_OK);
+  for (int i = 0; i < 3000; ++i)
+  {
+    snprintf(code, sizeof(code), "v%d <- %d\n", i, i*2);
+    CHECK(executeProgram(core, code) == BC_OK);
+  }
+
+  CHECK(executeProgram(core, "v0 + v1 + v1234 + v2999\n") == BC_OK);
+  CHECK(bcCoreResultInteger(core, &result) == BC_OK);
+  CHECK(result == 2 + 2468 + 5998);
+
+  // redefinition changes variable in place
+  CHECK(executeProgram(core, "v1234 <- \"text\"\nv1 <- v1 + 1\n") == BC_OK);
+  const char* data = NULL;
+  size_t len = 0;
+  CHECK(executeProgram(core, "v1234\n") == BC_OK);
+  CHECK(bcCoreResultString(core, &data, &len) == BC_OK);
+  CHECK((len == 4) && (memcmp(data, "text", 4) == 0));
+  CHECK(executeProgram(core, "v1 + v2998\n") == BC_OK);
+  CHECK(bcCoreResultInteger(core, &result) == BC_OK);
+  CHECK(result == 3 + 5996);
+  CHECK(executeProgram(core, "v3000\n") == BC_NOT_DEFINED);
+
+  bcCoreDelete(core);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Program compiled once reads and writes own globals of every core, which
+ * executes it, including names defined after its first run.
+ */
+static int testSlots(void)
+{
+  BC_PROGRAM program = NULL;
+  BC_CORE first = NULL;
+  BC_CORE second = NULL;
+  BC_CORE late = NULL;
+  int64_t result = 0;
+  CHECK(bcProgramCompile("count <- count + step\ncount\n", &program) == BC_OK);
+  CHECK(bcCoreNew(&first) == BC_OK);
+  CHECK(bcCoreNew(&second) == BC_OK);
+  CHECK(bcCoreNew(&late) == BC_OK);
+  CHECK(executeProgram(first, "count <- 0\nstep <- 1\nbase <- 1000\n") == BC_OK);
+  CHECK(executeProgram(second, "count <- 100\nstep <- 10\n") == BC_OK);
+
+  for (int i = 0; i < 3; ++i)
+  {
+    CHECK(bcCoreExecuteProgram(first, program) == BC_OK);
+    CHECK(bcCoreExecuteProgram(second, program) == BC_OK);
+  }
+  CHECK(bcCoreResultInteger(first, &result) == BC_OK);
+  CHECK(result == 3);
+  CHECK(bcCoreResultInteger(second, &result) == BC_OK);
+  CHECK(result == 130);
+
+  CHECK(bcCoreExecuteProgram(late, program) == BC_NOT_DEFINED);
+  CHECK(executeProgram(late, "count <- 5\nstep <- 5\n") == BC_OK);
+  CHECK(bcCoreExecuteProgram(late, program) == BC_OK);
+  CHECK(bcCoreResultInteger(late, &result) == BC_OK);
+  CHECK(result == 10);
+
+  // write to frozen variable defines own one, which hides it
+  BC_ENV env = NULL;
+  CHECK(executeProgram(late, "count + base\n") == BC_NOT_DEFINED);
+  CHECK(bcCoreFreeze(first, &env) == BC_OK);
+  CHECK(bcCoreSetEnv(late, env) == BC_OK);
+  CHECK(bcCoreExecuteProgram(late, program) == BC_OK);
+  CHECK(bcCoreResultInteger(late, &result) == BC_OK);
+  CHECK(result == 15);
+  CHECK(executeProgram(late, "count + base\n") == BC_OK);
+  CHECK(bcCoreResultInteger(late, &result) == BC_OK);
+  CHECK(result == 1015);
+  CHECK(bcCoreSetEnv(late, NULL) == BC_OK);
+  CHECK(executeProgram(late, "count + base\n") == BC_NOT_DEFINED);
+  CHECK(bcCoreSetEnv(late, env) == BC_OK);
+  CHECK(executeProgram(late, "step <- 2\n") == BC_OK);
+  CHECK(bcCoreExecuteProgram(first, program) == BC_OK);
+  CHECK(bcCoreExecuteProgram(first, program) == BC_OK);
+  CHECK(bcCoreResultInteger(first, &result) == BC_OK);
+  CHECK(result == 5);
+  CHECK(bcCoreExecuteProgram(late, program) == BC_OK);
+  CHECK(bcCoreResultInteger(late, &result) == BC_OK);
+  CHECK(result == 17);
+
+  bcEnvDelete(env);
+  bcCoreDelete(late);
+  bcCoreDelete(second);
+  bcCoreDelete(first);
+  bcProgramDelete(program);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Globals bound to host storage follow every change of it, even when value
+ * read earlier is still held by script.
+ */
+static int testBindings(void)
+{
+  BC_PROGRAM program = NULL;
+  BC_CORE core = NULL;
+  int64_t ticks = 0;
+  double scale = 0.5;
+  int64_t result = 0;
+  double number = 0.0;
+  CHECK(bcProgramCompile("ticks + 1\n", &program) == BC_OK);
+  CHECK(bcCoreNew(&core) == BC_OK);
+  CHECK(bcCoreBindInteger(core, "ticks", &ticks) == BC_OK);
+  CHECK(bcCoreBindNumber(core, "scale", &scale) == BC_OK);
+
+  for (ticks = 0; ticks < 5; ++ticks)
+  {
+    CHECK(bcCoreExecuteProgram(core, program) == BC_OK);
+    CHECK(bcCoreResultInteger(core, &result) == BC_OK);
+    CHECK(result == ticks + 1);
+  }
+
+  CHECK(executeProgram(core, "held <- ticks\n") == BC_OK);
+  ticks = 100;
+  CHECK(executeProgram(core, "ticks + held\n") == BC_OK);
+  CHECK(bcCoreResultInteger(core, &result) == BC_OK);
+  CHECK(result == 105);
+
+  CHECK(executeProgram(core, "scale * 4\n") == BC_OK);
+  CHECK(bcCoreResultNumber(core, &number) == BC_OK);
+  CHECK(number == 2.0);
+  scale = 1.5;
+  CHECK(executeProgram(core, "scale * 4\n") == BC_OK);
+  CHECK(bcCoreResultNumber(core, &number) == BC_OK);
+  CHECK(number == 6.0);
+
+  // unbound variable keeps last value
+  CHECK(executeProgram(core, "ticks <- 7\n") == BC_OK);
+  CHECK(ticks == 7);
+  CHECK(bcCoreUnbind(core, "ticks") == BC_OK);
+  ticks = 50;
+  CHECK(bcCoreExecuteProgram(core, program) == BC_OK);
+  CHECK(bcCoreResultInteger(core, &result) == BC_OK);
+  CHECK(result == 8);
+
+  bcCoreDelete(core);
+  bcProgramDelete(program);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Source fed in small chunks runs as whole program. Blocks end with next
+ * statement, blank line or end of stream, and errors don't stop feeding.
+ */
+static int testFeed(void)
+{
+  const char* source =
+    "func twice(x):\n"
+    "  return x*2\n"
+    "a <- twice(4)\n"
+    "if a > 5:\n"
+    "  a <- a + 1\n"
+    "\n"
+    "b <- a\n"
+    "func half(x):\n"
+    "  return x/2\n";
+
+  BC_CORE core = NULL;
+  int64_t result = 0;
+  size_t used = 0;
+  bcCacheStats_t before;
+  bcCacheStats_t after;
+  CHECK(bcCacheSetLimit(1 << 20) == BC_OK);
+  CHECK(bcCacheStatistics(&before) == BC_OK);
+  CHECK(bcCoreNew(&core) == BC_OK);
+  for (size_t offset = 0, len = strlen(source); offset < len; offset += 3)
+  {
+    size_t size = (len - offset < 3)? len - offset : 3;
+    CHECK(bcCoreFeed(core, source + offset, size, &used) == BC_OK);
+    CHECK(used == size);
+  }
+  CHECK(bcCoreFeedEnd(core) == BC_OK);
+
+  // streamed lines skip code cache
+  CHECK(bcCacheStatistics(&after) == BC_OK);
+  CHECK((after.hits == before.hits) && (after.misses == before.misses));
+  CHECK(bcCacheSetLimit(0) == BC_OK);
+  CHECK(executeProgram(core, "b*100 + half(10)\n") == BC_OK);
+  CHECK(bcCoreResultInteger(core, &result) == BC_OK);
+  CHECK(result == 905);
+
+  // feeding stops after failed line, rest is fed again
+  const char* tail = "c <- missing\nc <- 1\n";
+  CHECK(bcCoreFeed(core, tail, strlen(tail), &used) == BC_NOT_DEFINED);
+  CHECK(used == 13);
+  CHECK(bcCoreFeed(core, tail + used, strlen(tail + used), NULL) == BC_OK);
+  CHECK(bcCoreFeed(core, "c <- c + 1\nd <- 7", 17, NULL) == BC_OK);
+  CHECK(bcCoreFeedEnd(core) == BC_OK);
+  CHECK(executeProgram(core, "d*10 + c\n") == BC_OK);
+  CHECK(bcCoreResultInteger(core, &result) == BC_OK);
+  CHECK(result == 72);
+
+  bcCoreDelete(core);
+  return EXIT_SUCCESS;
+}
+
+#define POOL_CORES (8)
+#define POOL_RUNS (4)
+
+static const char* fibSource =
+  "func fib(n):\n"
+  "  if n < 2:\n"
+  "    return n\n"
+  "  return fib(n - 1) + fib(n - 2)\n";
+
+/**
+ * Store result of job, which is executed on worker thread.
+ */
+static void storeResult(void* user, BC_CORE core, bcStatus_t status)
+{
+  int64_t* result = (int64_t*) user;
+  if ((status != BC_OK) || (bcCoreResultInteger(core, result) != BC_OK))
+  {
+    *result = -1;
+  }
+}
+
+/**
+ * The same program is executed by pool on many cores in parallel.
+ */
+static int testPool(void)
+{
+  BC_PROGRAM init = NULL;
+  BC_PROGRAM run = NULL;
+  CHECK(bcProgramCompile(fibSource, &init) == BC_OK);
+  CHECK(bcProgramCompile("fib(15)\n", &run) == BC_OK);
+
+  BC_POOL pool = NULL;
+  CHECK(bcPoolNew(4, &pool) == BC_OK);
+
+  BC_CORE cores[POOL_CORES];
+  int64_t results[POOL_CORES];
+  BC_JOB last[POOL_CORES];
+  for (size_t i = 0; i < POOL_CORES; ++i)
+  {
+    results[i] = 0;
+    CHECK(bcCoreNew(&cores[i]) == BC_OK);
+    CHECK(bcPoolSubmit(pool, cores[i], init, NULL, NULL, NULL) == BC_OK);
+  }
+
+  for (size_t pass = 0; pass < POOL_RUNS; ++pass)
+  {
+    for (size_t i = 0; i < POOL_CORES; ++i)
+    {
+      BC_JOB* pJob = (pass + 1 == POOL_RUNS)? &last[i] : NULL;
+      CHECK(bcPoolSubmit(pool, cores[i], run, storeResult, &results[i], pJob) == BC_OK);
+    }
+  }
+
+  for (size_t i = 0; i < POOL_CORES; ++i)
+  {
+    CHECK(bcJobWait(last[i]) == BC_OK);
+    bcJobDelete(last[i]);
+    CHECK(results[i] == 610);
+
+    int64_t result = 0;
+    CHECK(bcCoreResultInteger(cores[i], &result) == BC_OK);
+    CHECK(result == 610);
+  }
+
+  bcPoolDelete(pool);
+  for (size_t i = 0; i < POOL_CORES; ++i)
+  {
+    bcCoreDelete(cores[i]);
+  }
+  bcProgramDelete(run);
+  bcProgramDelete(init);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Cores on pool threads read frozen environment at once, and their writes
+ * stay in own globals.
+ */
+static int testEnv(void)
+{
+  BC_PROGRAM run = NULL;
+  BC_CORE base = NULL;
+  BC_ENV env = NULL;
+  CHECK(bcProgramCompile("own <- offset + fib(12)\nown\n", &run) == BC_OK);
+  CHECK(bcCoreNew(&base) == BC_OK);
+  CHECK(executeProgram(base, fibSource) == BC_OK);
+  CHECK(executeProgram(base, "offset <- 1000\n") == BC_OK);
+  CHECK(bcCoreFreeze(base, &env) == BC_OK);
+
+  BC_POOL pool = NULL;
+  CHECK(bcPoolNew(4, &pool) == BC_OK);
+
+  BC_CORE cores[POOL_CORES];
+  int64_t results[POOL_CORES];
+  BC_JOB last[POOL_CORES];
+  char code[64];
+  for (size_t i = 0; i < POOL_CORES; ++i)
+  {
+    results[i] = 0;
+    CHECK(bcCoreNew(&cores[i]) == BC_OK);
+    CHECK(bcCoreSetEnv(cores[i], env) == BC_OK);
+    if (i % 2 == 1)
+    { // write hides frozen variable
+      snprintf(code, sizeof(code), "offset <- %d\n", (int) i);
+      CHECK(executeProgram(cores[i], code) == BC_OK);
+    }
+  }
+
+  // cores keep environment alive
+  bcEnvDelete(env);
+  CHECK(executeProgram(base, "offset <- 0\n") == BC_OK);
+
+  for (size_t pass = 0; pass < POOL_RUNS; ++pass)
+  {
+    for (size_t i = 0; i < POOL_CORES; ++i)
+    {
+      BC_JOB* pJob = (pass + 1 == POOL_RUNS)? &last[i] : NULL;
+      CHECK(bcPoolSubmit(pool, cores[i], run, storeResult, &results[i], pJob) == BC_OK);
+    }
+  }
+
+  for (size_t i = 0; i < POOL_CORES; ++i)
+  {
+    CHECK(bcJobWait(last[i]) == BC_OK);
+    bcJobDelete(last[i]);
+    CHECK(results[i] == ((i % 2 == 1)? (int64_t) i : 1000) + 144);
+  }
+  bcPoolDelete(pool);
+
+  int64_t result = 0;
+  CHECK(executeProgram(base, "offset + fib(10)\n") == BC_OK);
+  CHECK((bcCoreResultInteger(base, &result) == BC_OK) && (result == 55));
+  CHECK(executeProgram(base, "own\n") == BC_NOT_DEFINED);
+
+  bcCoreDelete(base);
+  for (size_t i = 0; i < POOL_CORES; ++i)
+  {
+    bcCoreDelete(cores[i]);
+  }
+  bcProgramDelete(run);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Immortal value, it is kept until process exits.
+ */
+static BC_VALUE forever = NULL;
+
+/**
+ * Give copy of frozen value to script.
+ */
+static bcStatus_t getFrozen(void* user, BC_VALUE* pValue)
+{
+  *pValue = bcValueCopy((BC_VALUE) user);
+  return BC_OK;
+}
+
+/**
+ * Frozen function is called by cores on pool threads at once, and frozen
+ * values live while any thread refers to them, or forever if immortal.
+ */
+static int testFreeze(void)
+{
+  BC_PROGRAM run = NULL;
+  BC_CORE maker = NULL;
+  BC_VALUE fib = NULL;
+  CHECK(bcProgramCompile("fib(12)\n", &run) == BC_OK);
+  CHECK(bcCoreNew(&maker) == BC_OK);
+  CHECK(executeProgram(maker, fibSource) == BC_OK);
+  CHECK(executeProgram(maker, "fib\n") == BC_OK);
+  CHECK(bcCoreResult(maker, &fib) == BC_OK);
+  fib = bcValueCopy(fib);
+  CHECK(bcValueFreeze(fib, BC_FREEZE_SHARED) == BC_OK);
+  CHECK(bcValueFreeze(fib, BC_FREEZE_SHARED) == BC_OK);
+  bcCoreDelete(maker);
+
+  BC_POOL pool = NULL;
+  CHECK(bcPoolNew(4, &pool) == BC_OK);
+
+  BC_CORE cores[POOL_CORES];
+  int64_t results[POOL_CORES];
+  BC_JOB last[POOL_CORES];
+  for (size_t i = 0; i < POOL_CORES; ++i)
+  {
+    results[i] = 0;
+    CHECK(bcCoreNew(&cores[i]) == BC_OK);
+    CHECK(bcCoreBindAccessors(cores[i], "fib", getFrozen, NULL, fib) == BC_OK);
+  }
+
+  for (size_t pass = 0; pass < POOL_RUNS; ++pass)
+  {
+    for (size_t i = 0; i < POOL_CORES; ++i)
+    {
+      BC_JOB* pJob = (pass + 1 == POOL_RUNS)? &last[i] : NULL;
+      CHECK(bcPoolSubmit(pool, cores[i], run, storeResult, &results[i], pJob) == BC_OK);
+    }
+  }
+
+  for (size_t i = 0; i < POOL_CORES; ++i)
+  {
+    CHECK(bcJobWait(last[i]) == BC_OK);
+    bcJobDelete(last[i]);
+    CHECK(results[i] == 144);
+  }
+  bcPoolDelete(pool);
+
+  // function is released with last core, which refers to it
+  bcValueCleanup(fib);
+  for (size_t i = 0; i < POOL_CORES; ++i)
+  {
+    bcCoreDelete(cores[i]);
+  }
+  bcProgramDelete(run);
+
+  char* text = NULL;
+  forever = bcValueString("forever");
+  CHECK(forever != NULL);
+  CHECK(bcValueFreeze(forever, BC_FREEZE_IMMORTAL) == BC_OK);
+  bcValueCleanup(forever);
+  bcValueCleanup(forever);
+  CHECK((bcValueAsString(forever, &text, 0) == BC_OK) && (strcmp(text, "forever") == 0));
+  free(text);
+
+  CHECK(bcValueFreeze(NULL, BC_FREEZE_SHARED) == BC_INVALID_ARG);
+  CHECK(bcValueFreeze(forever, (bcFreezeMode_t) 7) == BC_INVALID_ARG);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Store written by one side is read in place by other one, which opened it
+ * like other process does, and by its cores.
+ */
+static int testStore(void)
+{
+  const char* name = "/badtest-store";
+  BC_STORE writer = NULL;
+  BC_STORE reader = NULL;
+  bcStoreUnlink(name);
+  bcStatus_t status = bcStoreCreate(name, 64*1024, &writer);
+  if (status == BC_NOT_IMPLEMENTED)
+  {
+    fprintf(stderr, "store: skipped, no shared memory\n");
+    return EXIT_SUCCESS;
+  }
+  CHECK(status == BC_OK);
+  CHECK(bcStoreCreate(name, 64*1024, &reader) == BC_IO_ERROR);
+
+  BC_VALUE value = bcValueInteger(10);
+  CHECK(bcStoreSet(writer, "limit", value) == BC_OK);
+  bcValueCleanup(value);
+  value = bcValueString("hello");
+  CHECK(bcStoreSet(writer, "greeting", value) == BC_OK);
+  CHECK(bcStoreOpen(name, &reader) == BC_OK);
+  CHECK(bcStoreSet(reader, "greeting", value) == BC_NOT_IMPLEMENTED);
+  bcValueCleanup(value);
+
+  // values read before update stay valid
+  int64_t result = 0;
+  BC_VALUE before = bcStoreGet(reader, "limit");
+  CHECK((bcValueAsInteger(before, &result) == BC_OK) && (result == 10));
+  value = bcValueNumber(2.5);
+  CHECK(bcStoreSet(writer, "limit", value) == BC_OK);
+  bcValueCleanup(value);
+  CHECK((bcValueAsInteger(before, &result) == BC_OK) && (result == 10));
+  bcValueCleanup(before);
+  CHECK(bcStoreGet(reader, "missing") == NULL);
+
+  const char* data = NULL;
+  size_t len = 0;
+  double number = 0.0;
+  BC_CORE core = NULL;
+  CHECK(bcCoreNew(&core) == BC_OK);
+  CHECK(bcCoreSetStore(core, reader) == BC_OK);
+  CHECK(executeProgram(core, "limit*2\n") == BC_OK);
+  CHECK((bcCoreResultNumber(core, &number) == BC_OK) && (number == 5.0));
+  CHECK(executeProgram(core, "greeting\n") == BC_OK);
+  CHECK(bcCoreResultString(core, &data, &len) == BC_OK);
+  CHECK((len == 5) && (memcmp(data, "hello", 5) == 0));
+
+  // core writes stay in core
+  CHECK(executeProgram(core, "limit <- 1\nlimit\n") == BC_OK);
+  CHECK((bcCoreResultInteger(core, &result) == BC_OK) && (result == 1));
+  CHECK((bcValueAsNumber(bcStoreGet(reader, "limit"), &number) == BC_OK) && (number == 2.5));
+  bcCoreDelete(core);
+
+  // written data is never freed, so updates fill store
+  bcStoreDelete(reader);
+  bcStoreDelete(writer);
+  CHECK(bcStoreUnlink(name) == BC_OK);
+  CHECK(bcStoreOpen(name, &reader) == BC_IO_ERROR);
+  CHECK(bcStoreCreate(name, 4096, &writer) == BC_OK);
+  value = bcValueString("some text, which takes space");
+  do
+  {
+    status = bcStoreSet(writer, "text", value);
+  } while (status == BC_OK);
+  CHECK(status == BC_OVERFLOW);
+  bcValueCleanup(value);
+  bcStoreDelete(writer);
+  CHECK(bcStoreUnlink(name) == BC_OK);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Values pass between host and script, and between threads, until channel
+ * is closed.
+ */
+static int testChannel(void)
+{
+  BC_CHANNEL channel = NULL;
+  BC_CORE core = NULL;
+  CHECK(bcChannelNew(1, &channel) == BC_OK);
+  CHECK(bcCoreNew(&core) == BC_OK);
+  CHECK(bcCoreBindChannel(core, "put", "get", channel) == BC_OK);
+
+  int64_t result = 0;
+  BC_VALUE value = NULL;
+  CHECK(bcChannelSend(channel, bcValueInteger(7)) == BC_OK);
+  CHECK(executeProgram(core, "get()*6\n") == BC_OK);
+  CHECK(bcCoreResultInteger(core, &result) == BC_OK);
+  CHECK(result == 42);
+
+  CHECK(executeProgram(core, "put(\"text\")\n") == BC_OK);
+  CHECK(bcChannelReceive(channel, &value) == BC_OK);
+  char buffer[8];
+  char* text = buffer;
+  CHECK(bcValueAsString(value, &text, sizeof(buffer)) == BC_OK);
+  CHECK(strcmp(text, "text") == 0);
+  bcValueCleanup(value);
+
+  // sender waits on full channel, while receiver is on other thread
+  BC_PROGRAM producer = NULL;
+  BC_POOL pool = NULL;
+  BC_JOB job = NULL;
+  CHECK(bcProgramCompile("put(1)\nput(2)\nput(3)\n", &producer) == BC_OK);
+  CHECK(bcPoolNew(1, &pool) == BC_OK);
+  CHECK(bcPoolSubmit(pool, core, producer, NULL, NULL, &job) == BC_OK);
+  for (int64_t expected = 1; expected <= 3; ++expected)
+  {
+    CHECK(bcChannelReceive(channel, &value) == BC_OK);
+    CHECK((bcValueAsInteger(value, &result) == BC_OK) && (result == expected));
+    bcValueCleanup(value);
+  }
+  CHECK(bcJobWait(job) == BC_OK);
+  bcJobDelete(job);
+  bcPoolDelete(pool);
+  bcProgramDelete(producer);
+
+  // values left are received after close
+  CHECK(executeProgram(core, "put(4)\n") == BC_OK);
+  bcChannelClose(channel);
+  CHECK(bcChannelReceive(channel, &value) == BC_OK);
+  CHECK((bcValueAsInteger(value, &result) == BC_OK) && (result == 4));
+  bcValueCleanup(value);
+  CHECK(bcChannelReceive(channel, &value) == BC_CLOSED);
+  CHECK(executeProgram(core, "get()\n") == BC_CLOSED);
+  CHECK(executeProgram(core, "put(5)\n") == BC_CLOSED);
+
+  value = bcValueInteger(6);
+  CHECK(bcChannelSend(channel, value) == BC_CLOSED);
+  bcValueCleanup(value);
+
+  bcChannelDelete(channel);
+  bcCoreDelete(core);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Parent and child see own writes only after fork.
+ */
+static int testFork(void)
+{
+  BC_CORE parent = NULL;
+  BC_CORE child = NULL;
+  int64_t result = 0;
+  CHECK(bcCoreNew(&parent) == BC_OK);
+  CHECK(executeProgram(parent, "x <- 1\ny <- 10\n") == BC_OK);
+  CHECK(bcCoreFork(parent, &child) == BC_OK);
+
+  CHECK(executeProgram(child, "x <- x + 1\n") == BC_OK);
+  CHECK(executeProgram(parent, "y <- y + 10\nz <- 100\n") == BC_OK);
+
+  CHECK(executeProgram(parent, "x*1000 + y\n") == BC_OK);
+  CHECK(bcCoreResultInteger(parent, &result) == BC_OK);
+  CHECK(result == 1020);
+  CHECK(executeProgram(child, "x*1000 + y\n") == BC_OK);
+  CHECK(bcCoreResultInteger(child, &result) == BC_OK);
+  CHECK(result == 2010);
+  CHECK(executeProgram(child, "z\n") == BC_NOT_DEFINED);
+
+  // child outlives parent
+  bcCoreDelete(parent);
+  CHECK(executeProgram(child, "x + y\n") == BC_OK);
+  CHECK(bcCoreResultInteger(child, &result) == BC_OK);
+  CHECK(result == 12);
+  bcCoreDelete(child);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Saved program and core behave as original ones after load.
+ */
+static int testImage(void)
+{
+  const char* programPath = "badtest-image.bcp";
+  const char* corePath = "badtest-image.bci";
+  BC_PROGRAM program = NULL;
+  BC_CORE core = NULL;
+  int64_t result = 0;
+  CHECK(bcProgramCompile(
+    "func twice(n):\n"
+    "  return n*2\n"
+    "name <- \"saved\"\n"
+    "half <- 10.5\n"
+    "twice(21)\n", &program) == BC_OK);
+  CHECK(bcProgramSave(program, programPath) == BC_OK);
+  bcProgramDelete(program);
+
+  CHECK(bcProgramLoad(programPath, &program) == BC_OK);
+  CHECK(bcCoreNew(&core) == BC_OK);
+  CHECK(bcCoreExecuteProgram(core, program) == BC_OK);
+  CHECK(bcCoreResultInteger(core, &result) == BC_OK);
+  CHECK(result == 42);
+  CHECK(bcCoreSave(core, corePath) == BC_OK);
+  bcCoreDelete(core);
+  bcProgramDelete(program);
+
+  const char* data = NULL;
+  size_t len = 0;
+  double number = 0.0;
+  CHECK(bcCoreNew(&core) == BC_OK);
+  CHECK(bcCoreLoad(core, corePath) == BC_OK);
+  CHECK(bcCorePushInteger(core, 5) == BC_OK);
+  CHECK(bcCoreCallFunction(core, "twice", 1) == BC_OK);
+  CHECK((bcCorePopInteger(core, &result) == BC_OK) && (result == 10));
+  CHECK(executeProgram(core, "name\n") == BC_OK);
+  CHECK(bcCoreResultString(core, &data, &len) == BC_OK);
+  CHECK((len == 5) && (memcmp(data, "saved", 5) == 0));
+  CHECK(executeProgram(core, "half\n") == BC_OK);
+  CHECK((bcCoreResultNumber(core, &number) == BC_OK) && (number == 10.5));
+  bcCoreDelete(core);
+
+  remove(corePath);
+  remove(programPath);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Script compiled to C and built as shared library runs as interpreted one,
+ * and its functions outlive program.
+ */
+static int testAot(void)
+{
+#if defined(_WIN32) || !defined(BC_TEST_CC)
+  fprintf(stderr, "aot: skipped, no C compiler\n");
+  return EXIT_SUCCESS;
+#else
+  const char* sourcePath = "badtest-aot.c";
+  const char* libraryPath = "./badtest-aot.so";
+  FILE* output = fopen(sourcePath, "w");
+  CHECK(output != NULL);
+  CHECK(bcCompileToC(
+    "func fact(n):\n"
+    "  if n < 2:\n"
+    "    return 1\n"
+    "  return n*fact(n - 1)\n"
+    "scale <- 1.5\n"
+    "fact(5) + base\n", output) == BC_OK);
+  fclose(output);
+  CHECK(system(BC_TEST_CC " -shared -fPIC -o badtest-aot.so badtest-aot.c") == 0);
+
+  BC_NATIVE_PROGRAM program = NULL;
+  BC_CORE core = NULL;
+  int64_t result = 0;
+  double number = 0.0;
+  CHECK(bcNativeProgramLoad(libraryPath, &program) == BC_OK);
+  CHECK(bcCoreNew(&core) == BC_OK);
+  CHECK(bcCoreExecuteNative(core, program) == BC_NOT_DEFINED);
+  CHECK(executeProgram(core, "base <- 1000\n") == BC_OK);
+  CHECK(bcCoreExecuteNative(core, program) == BC_OK);
+  CHECK(bcCoreResultInteger(core, &result) == BC_OK);
+  CHECK(result == 1120);
+  CHECK(executeProgram(core, "scale*2\n") == BC_OK);
+  CHECK((bcCoreResultNumber(core, &number) == BC_OK) && (number == 3.0));
+
+  // library stays loaded, while core keeps its function
+  bcNativeProgramDelete(program);
+  CHECK(bcCorePushInteger(core, 6) == BC_OK);
+  CHECK(bcCoreCallFunction(core, "fact", 1) == BC_OK);
+  CHECK((bcCorePopInteger(core, &result) == BC_OK) && (result == 720));
+  CHECK(executeProgram(core, "fact(3)\n") == BC_OK);
+  CHECK((bcCoreResultInteger(core, &result) == BC_OK) && (result == 6));
+  bcCoreDelete(core);
+
+  CHECK(bcNativeProgramLoad("./badtest-missing.so", &program) == BC_INVALID_ARG);
+  remove(libraryPath);
+  remove(sourcePath);
+  return EXIT_SUCCESS;
+#endif
+}
+
+/**
+ * Body of if statement is compiled on first run and then reused, by every
+ * core, which executes program, including nested bodies and bodies inside
+ * functions.
+ */
+static int testIf(void)
+{
+  BC_PROGRAM program = NULL;
+  BC_CORE first = NULL;
+  BC_CORE second = NULL;
+  int64_t result = 0;
+  CHECK(bcProgramCompile(
+    "if flag:\n"
+    "  hits <- hits + 1\n"
+    "  if flag > 1:\n"
+    "    deep <- deep + clamp(flag)\n"
+    "hits*100 + deep\n",
+    &program) == BC_OK);
+  CHECK(bcCoreNew(&first) == BC_OK);
+  CHECK(bcCoreNew(&second) == BC_OK);
+  CHECK(executeProgram(first,
+    "func clamp(x):\n"
+    "  if x > 3:\n"
+    "    return 3\n"
+    "  return x\n"
+    "hits <- 0\n"
+    "deep <- 0\n"
+    "flag <- 0\n"
+  ) == BC_OK);
+  CHECK(executeProgram(second, "func clamp(x):\n  return 0\nhits <- 10\ndeep <- 0\nflag <- 5\n") == BC_OK);
+
+  CHECK(bcCoreExecuteProgram(first, program) == BC_OK);
+  CHECK(bcCoreResultInteger(first, &result) == BC_OK);
+  CHECK(result == 0);
+
+  CHECK(executeProgram(first, "flag <- 1\n") == BC_OK);
+  CHECK(bcCoreExecuteProgram(first, program) == BC_OK);
+  CHECK(bcCoreResultInteger(first, &result) == BC_OK);
+  CHECK(result == 100);
+
+  CHECK(executeProgram(first, "flag <- 2\n") == BC_OK);
+  CHECK(bcCoreExecuteProgram(first, program) == BC_OK);
+  CHECK(executeProgram(first, "flag <- 7\n") == BC_OK);
+  CHECK(bcCoreExecuteProgram(first, program) == BC_OK);
+  CHECK(bcCoreResultInteger(first, &result) == BC_OK);
+  CHECK(result == 305);
+
+  // bodies compiled by first core use globals of second one
+  CHECK(bcCoreExecuteProgram(second, program) == BC_OK);
+  CHECK(bcCoreResultInteger(second, &result) == BC_OK);
+  CHECK(result == 1100);
+
+  // error in body is reported only when body runs
+  bcProgramDelete(program);
+  program = NULL;
+  CHECK(bcProgramCompile("if flag > 100:\n  missing + 1\nflag\n", &program) == BC_OK);
+  CHECK(bcCoreExecuteProgram(first, program) == BC_OK);
+  CHECK(bcCoreResultInteger(first, &result) == BC_OK);
+  CHECK(result == 7);
+  CHECK(executeProgram(first, "flag <- 101\n") == BC_OK);
+  CHECK(bcCoreExecuteProgram(first, program) == BC_NOT_DEFINED);
+
+  bcCoreDelete(second);
+  bcCoreDelete(first);
+  bcProgramDelete(program);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Reloaded script compiles only new and edited statements, and keeps old
+ * code, when new source is broken.
+ */
+static int testScript(void)
+{
+  BC_SCRIPT script = NULL;
+  BC_CORE core = NULL;
+  size_t compiled = 0;
+  int64_t result = 0;
+  CHECK(bcScriptCompile(
+    "func area(w, h):\n"
+    "  return w*h\n"
+    "scale <- 2\n"
+    "area(3, 4)*scale\n", &script) == BC_OK);
+  CHECK(bcCoreNew(&core) == BC_OK);
+  CHECK(bcCoreExecuteScript(core, script) == BC_OK);
+  CHECK((bcCoreResultInteger(core, &result) == BC_OK) && (result == 24));
+
+  CHECK(bcScriptReload(script,
+    "func area(w, h):\n"
+    "  return w*h\n"
+    "scale <- 3\n"
+    "area(3, 4)*scale\n", &compiled) == BC_OK);
+  CHECK(compiled == 1);
+  CHECK(bcCoreExecuteScript(core, script) == BC_OK);
+  CHECK((bcCoreResultInteger(core, &result) == BC_OK) && (result == 36));
+
+  // moved statements are found by text
+  CHECK(bcScriptReload(script,
+    "scale <- 3\n"
+    "func area(w, h):\n"
+    "  return w*h\n"
+    "area(3, 4)*scale\n", &compiled) == BC_OK);
+  CHECK(compiled == 0);
+  CHECK(bcCoreExecuteScript(core, script) == BC_OK);
+  CHECK((bcCoreResultInteger(core, &result) == BC_OK) && (result == 36));
+
+  CHECK(bcScriptReload(script,
+    "scale <- 3\n"
+    "func area(w, h):\n"
+    "  return w + h\n"
+    "area(3, 4)*scale\n", &compiled) == BC_OK);
+  CHECK(compiled == 1);
+  CHECK(bcCoreExecuteScript(core, script) == BC_OK);
+  CHECK((bcCoreResultInteger(core, &result) == BC_OK) && (result == 21));
+
+  CHECK(bcScriptReload(script, "scale <- 4\narea(3, 4\n", &compiled) != BC_OK);
+  CHECK(bcCoreExecuteScript(core, script) == BC_OK);
+  CHECK((bcCoreResultInteger(core, &result) == BC_OK) && (result == 21));
+
+  // execution stops on failed statement
+  CHECK(bcScriptReload(script, "scale <- 5\nmissing\nscale <- 6\n", &compiled) == BC_OK);
+  CHECK(compiled == 3);
+  CHECK(bcCoreExecuteScript(core, script) == BC_NOT_DEFINED);
+  CHECK(executeProgram(core, "scale\n") == BC_OK);
+  CHECK((bcCoreResultInteger(core, &result) == BC_OK) && (result == 5));
+
+  bcCoreDelete(core);
+  bcScriptDelete(script);
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Statement compiled for one core is taken from cache by other one.
+ */
+static int testCache(void)
+{
+  const char* code = "40 + 2\n";
+  bcCacheStats_t before;
+  bcCacheStats_t after;
+
+  CHECK(bcCacheStatistics(&before) == BC_OK);
+  CHECK(before.limit == 0); // off by default
+
+  bcCacheClear();
+  CHECK(bcCacheSetLimit(1024*1024) == BC_OK);
+  CHECK(bcCacheStatistics(&before) == BC_OK);
+
+  BC_CORE first = NULL;
+  BC_CORE second = NULL;
+  int64_t result = 0;
+  CHECK(bcCoreNew(&first) == BC_OK);
+  CHECK(bcCoreNew(&second) == BC_OK);
+  CHECK(bcCoreExecute(first, code, NULL) == BC_OK);
+  CHECK(bcCoreExecute(second, code, NULL) == BC_OK);
+  CHECK(bcCoreResultInteger(second, &result) == BC_OK);
+  CHECK(result == 42);
+
+  CHECK(bcCacheStatistics(&after) == BC_OK);
+  CHECK(after.misses == before.misses + 1);
+  CHECK(after.hits == before.hits + 1);
+  CHECK(after.entries == 1);
+
+  // entry is still used after core, which compiled it, is deleted
+  bcCoreDelete(first);
+  CHECK(bcCoreExecute(second, code, NULL) == BC_OK);
+  CHECK(bcCacheStatistics(&after) == BC_OK);
+  CHECK(after.hits == before.hits + 2);
+  bcCoreDelete(second);
+
+  CHECK(bcCacheSetLimit(0) == BC_OK);
+  return EXIT_SUCCESS;
+}
+
+static const bcTest_t tests[] = {
+  { "call", testCall },
+  { "strings", testStrings },
+  { "globals", testGlobals },
+  { "slots", testSlots },
+  { "bindings", testBindings },
+  { "feed", testFeed },
+  { "pool", testPool },
+  { "env", testEnv },
+  { "freeze", testFreeze },
+  { "store", testStore },
+  { "channel", testChannel },
+  { "fork", testFork },
+  { "image", testImage },
+  { "aot", testAot },
+  { "script", testScript },
+  { "if", testIf },
+  { "cache", testCache },
+};
+
+int main(int argc, char* argv[])
+{
+  size_t total = sizeof(tests)/sizeof(tests[0]);
+  int result = EXIT_SUCCESS;
+  int found = 0;
+  for (size_t i = 0; i < total; ++i)
+  {
+    if ((argc > 1) && (strcmp(argv[1], tests[i].name) != 0))
+    {
+      continue;
+    }
+    found = 1;
+    if (tests[i].func() != EXIT_SUCCESS)
+    {
+      fprintf(stderr, "%s: FAILED\n", tests[i].name);
+      result = EXIT_FAILURE;
+    }
+  }
+
+  if (!found)
+  {
+    fprintf(stderr, "Usage: %s [<test>]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  return result;
+}